@@ -19,7 +19,7 @@ sasTCLTools.depends = sasCore
 sasClient.depends = sasCore sasTCLTools sasBasics
 sasBypass.depends = sasCore
 sasSQL.depends = sasCore
-test.depends = sasCore sasBasics sasSQL
+test.depends = sasCore sasBasics sasSQL sasBypass
 
 CONFIG(SAS_ALL) {
     CONFIG += \
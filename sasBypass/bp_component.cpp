@@ -25,6 +25,7 @@
 #include "loopbackconnector.h"
 #include "loopbackconnectorfactory.h"
 #include "bypassmodule.h"
+#include "cachingmodule.h"
 
 namespace SAS {
 
@@ -109,6 +110,33 @@ public:
 			}
         }
 
+        //creating caching modules
+		{
+			std::vector<std::string> names;
+			if (app->configReader()->getStringListEntry("SAS/BYPASS/CACHING_MODULES", names, names, ec) && names.size())
+			{
+				bool has_error(false);
+				for (size_t i(0), l(names.size()); i < l; ++i)
+				{
+					auto mod = new CachingModule(app, names[i]);
+					if (!mod->init("SAS/BYPASS/" + names[i], ec))
+					{
+						has_error = true;
+						delete mod;
+					}
+					else
+						objects.push_back(mod);
+				}
+
+				if (has_error)
+					return false;
+			}
+			else
+			{
+				SAS_LOG_INFO(logger, "no caching modules are set");
+			}
+		}
+
         return app->objectRegistry()->registerObjects(objects, ec);
 	}
 
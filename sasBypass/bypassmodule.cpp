@@ -16,8 +16,12 @@
  */
 
 #include "bypassmodule.h"
+#include "singleflight.h"
+#include "connectionpool.h"
+#include "loopbackconnector.h"
 
 #include <sasCore/session.h>
+#include <sasCore/module.h>
 #include <sasCore/invoker.h>
 #include <sasCore/logging.h>
 #include <sasCore/configreader.h>
@@ -26,40 +30,370 @@
 #include <sasCore/errorcollector.h>
 #include <sasCore/connector.h>
 #include <sasCore/errorcodes.h>
+#include <sasCore/timerthread.h>
+#include <sasCore/threadpool.h>
 
 #include <map>
+#include <list>
 #include <mutex>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cstdlib>
+#include <condition_variable>
 
 namespace SAS {
 
+	// a destination of the bypass module, it has its own connection pool
+	struct BypassBackend
+	{
+		BypassBackend(Application * app_, const std::string & module_name, Connector * connector_, long weight_) :
+			app(app_), connector(connector_), weight(weight_), local(nullptr), pool(app_, module_name + "." + connector_->name()),
+			outstanding(0), latency(0), failures(0), ejected_until(0), current_weight(0)
+		{ }
+
+		std::string name() const
+		{
+			return connector->name();
+		}
+
+		Application * app;
+		Connector * connector;
+		long weight;
+		Module * local; // the destination module is in this process (loopback connector)
+		BypassConnectionPool pool;
+
+		std::atomic<long> outstanding;
+		std::atomic<long> latency; // moving average, microseconds
+		std::atomic<long> failures; // consecutive fatal errors
+		std::atomic<long long> ejected_until; // steady clock, microseconds
+		long current_weight; // smooth weighted round-robin, guarded by the router
+	};
+
+	// selects the backend of the new sessions, the sessions are sticky to their backends
+	class BypassRouter
+	{
+		SAS_COPY_PROTECTOR(BypassRouter)
+	public:
+		enum class Mode { LeastOutstanding, WeightedRoundRobin };
+
+		BypassRouter(const std::string & name) :
+			mode(Mode::LeastOutstanding), ejection_failures(0), ejection_latency(0), ejection_time(0),
+			logger(Logging::getLogger("SAS.BypassRouter." + name))
+		{ }
+
+		static long long now()
+		{
+			return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		bool isEjected(const BypassBackend * backend) const
+		{
+			return backend->ejected_until.load() > now();
+		}
+
+		// nullptr if there is no backend other than 'exclude'
+		BypassBackend * select(const BypassBackend * exclude = nullptr)
+		{
+			std::vector<BypassBackend*> candidates;
+			candidates.reserve(backends.size());
+			for (auto & b : backends)
+				if (b.get() != exclude && !isEjected(b.get()))
+					candidates.push_back(b.get());
+			if (!candidates.size())
+			{
+				// rather an unhealthy backend than none
+				for (auto & b : backends)
+					if (b.get() != exclude)
+						candidates.push_back(b.get());
+			}
+			if (!candidates.size())
+				return nullptr;
+			if (candidates.size() == 1)
+				return candidates.front();
+
+			switch (mode)
+			{
+			case Mode::WeightedRoundRobin:
+				{
+					std::unique_lock<std::mutex> __locker(mut);
+					long total = 0;
+					BypassBackend * ret = nullptr;
+					for (auto b : candidates)
+					{
+						b->current_weight += b->weight;
+						total += b->weight;
+						if (!ret || b->current_weight > ret->current_weight)
+							ret = b;
+					}
+					ret->current_weight -= total;
+					return ret;
+				}
+			case Mode::LeastOutstanding:
+				break;
+			}
+
+			// the slower backends are loaded less
+			BypassBackend * ret = nullptr;
+			double ret_cost = 0;
+			for (auto b : candidates)
+			{
+				double cost = static_cast<double>(b->outstanding.load() + 1) * static_cast<double>(std::max(b->latency.load(), 1L)) / static_cast<double>(b->weight);
+				if (!ret || cost < ret_cost)
+				{
+					ret = b;
+					ret_cost = cost;
+				}
+			}
+			return ret;
+		}
+
+		void begin(BypassBackend * backend)
+		{
+			++backend->outstanding;
+		}
+
+		void end(BypassBackend * backend, Invoker::Status status, std::chrono::microseconds elapsed)
+		{
+			--backend->outstanding;
+
+			long l = backend->latency.load();
+			l = l ? l + (static_cast<long>(elapsed.count()) - l) / 8 : static_cast<long>(elapsed.count());
+			backend->latency = l;
+
+			if (status == Invoker::Status::FatalError)
+				failed(backend);
+			else
+				backend->failures = 0;
+
+			if (ejection_latency > 0 && l > ejection_latency)
+				eject(backend, "average latency is " + std::to_string(l / 1000) + " ms");
+		}
+
+		void failed(BypassBackend * backend)
+		{
+			if (ejection_failures > 0 && ++backend->failures >= ejection_failures)
+				eject(backend, std::to_string(ejection_failures) + " consecutive fatal errors");
+		}
+
+		std::vector<std::unique_ptr<BypassBackend>> backends;
+		Mode mode;
+		long ejection_failures;
+		long ejection_latency; // microseconds
+		long long ejection_time; // microseconds
+
+	private:
+		void eject(BypassBackend * backend, const std::string & reason)
+		{
+			if (!ejection_time || isEjected(backend) || backends.size() < 2)
+				return;
+			SAS_LOG_WARN(logger, "backend '" + backend->name() + "' is ejected for " + std::to_string(ejection_time / 1000000) + " secs: " + reason);
+			backend->ejected_until = now() + ejection_time;
+			backend->failures = 0;
+			// it is probed again with a clean history
+			backend->latency = 0;
+		}
+
+		std::mutex mut;
+		Logging::LoggerPtr logger;
+	};
+
+	// latency based hedging: if the backend of the session has not answered within the configured percentile of the latencies
+	// of the invoker, the call is sent to another backend too, the first answer is used
+	class BypassHedging
+	{
+		SAS_COPY_PROTECTOR(BypassHedging)
+	public:
+		// the latest latencies of an invoker
+		struct Latencies
+		{
+			Latencies() : count(0), delay(-1)
+			{ }
+
+			std::mutex mut;
+			std::vector<long> samples; // ring buffer, microseconds
+			size_t count;
+			std::atomic<long> delay; // microseconds, -1: not enough samples yet
+		};
+
+		BypassHedging() : percentile(95), min_delay(0), budget(0), tokens(0), running(0), hedged(0)
+		{ }
+
+		~BypassHedging()
+		{
+			wait();
+		}
+
+		void init(const std::vector<std::string> & invokers, long percentile_, std::chrono::microseconds min_delay_, double budget_)
+		{
+			for (auto & i : invokers)
+				latencies[i].reset(new Latencies());
+			percentile = percentile_;
+			min_delay = min_delay_.count();
+			budget = budget_;
+		}
+
+		// nullptr if the invoker is not hedged
+		Latencies * invoker(const std::string & invoker_name)
+		{
+			auto it = latencies.find(invoker_name);
+			return it == latencies.end() ? nullptr : it->second.get();
+		}
+
+		void record(Latencies * l, std::chrono::microseconds elapsed)
+		{
+			std::unique_lock<std::mutex> __locker(l->mut);
+			if (l->samples.size() < sample_num)
+				l->samples.push_back(static_cast<long>(elapsed.count()));
+			else
+				l->samples[l->count % sample_num] = static_cast<long>(elapsed.count());
+			// the percentile is recalculated only periodically
+			if (++l->count % recalc_interval == 0)
+			{
+				std::vector<long> tmp(l->samples);
+				auto nth = tmp.begin() + static_cast<std::ptrdiff_t>((tmp.size() - 1) * static_cast<size_t>(percentile) / 100);
+				std::nth_element(tmp.begin(), nth, tmp.end());
+				l->delay = std::max(*nth, min_delay);
+			}
+		}
+
+		long delay(Latencies * l) const
+		{
+			return l->delay;
+		}
+
+		// every call adds 'budget' token, a hedge costs one token
+		void earn()
+		{
+			// the unused budget can be saved up to a burst of 10 hedges
+			const double max_tokens = 10;
+			std::unique_lock<std::mutex> __locker(mut);
+			tokens = std::min(tokens + budget, max_tokens);
+		}
+
+		bool spend()
+		{
+			std::unique_lock<std::mutex> __locker(mut);
+			if (tokens < 1)
+				return false;
+			tokens -= 1;
+			++hedged;
+			return true;
+		}
+
+		// the calls are run in threads of the pool, the losing ones are let to finish in the background
+		void begin()
+		{
+			std::unique_lock<std::mutex> __locker(mut);
+			++running;
+		}
+
+		void end()
+		{
+			std::unique_lock<std::mutex> __locker(mut);
+			if (!--running)
+				cv.notify_all();
+		}
+
+		void wait()
+		{
+			std::unique_lock<std::mutex> __locker(mut);
+			cv.wait(__locker, [this]() { return running == 0; });
+		}
+
+		unsigned long long hedgedCalls()
+		{
+			std::unique_lock<std::mutex> __locker(mut);
+			return hedged;
+		}
+
+	private:
+		static const size_t sample_num = 256;
+		static const size_t recalc_interval = 16;
+
+		std::map<std::string, std::unique_ptr<Latencies>> latencies; // it is not modified after the initialization
+		long percentile;
+		long min_delay; // microseconds
+		double budget;
+
+		std::mutex mut;
+		std::condition_variable cv;
+		double tokens;
+		long running;
+		unsigned long long hedged;
+	};
+
+	// state of a hedged call, it is shared by the caller and the attempts
+	struct BypassHedgedCall
+	{
+		BypassHedgedCall(const std::string & invoker_name_, const std::vector<char> & input_) :
+			invoker_name(invoker_name_), input(input_), pending(0), done(false),
+			status(Invoker::Status::Error), sid(0), primary_won(false)
+		{ }
+
+		std::string invoker_name;
+		std::vector<char> input;
+
+		std::mutex mut;
+		std::condition_variable cv;
+		int pending;
+		bool done;
+		Invoker::Status status;
+		std::vector<char> output;
+		std::vector<std::pair<long, std::string>> errors;
+		SessionID sid; // remote session of the primary attempt
+		bool primary_won;
+	};
+
+	class BypassSession;
+
 	class BypassInvoker : public Invoker
 	{
 		SAS_COPY_PROTECTOR(BypassInvoker)
 	public:
-		inline BypassInvoker(Connection * conn_) : Invoker(), conn(conn_)
-		{ }
+		inline BypassInvoker(BypassSession * session_, BypassRouter * router_, SingleFlight * single_flight_, BypassHedging * hedging_, ThreadPool * thread_pool_, const std::string & name_) : Invoker(),
+			session(session_), router(router_), single_flight(single_flight_), hedging(hedging_), thread_pool(thread_pool_), name(name_), dedicated(nullptr), dedicated_backend(nullptr),
+			local_invoker(nullptr), local_target(nullptr), local_backend(nullptr)
+		{
+			latencies = hedging->invoker(name);
+		}
 		
 		virtual inline ~BypassInvoker()
 		{
-			delete conn;
+			if (dedicated)
+				delete dedicated;
 		}
 
-		virtual Status invoke(const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec) final
-		{
-			SAS_LOG_NDC();
-			return conn->invoke(input, output, ec);
-		}
+		virtual Status invoke(const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec) final;
 
 	private:
-		Connection * conn;
+		Status call(const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec);
+		Status localCall(BypassBackend * backend, const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec);
+		Status invoke(BypassBackend * backend, Connection * conn, const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec);
+		bool hedgedCall(BypassBackend * backend, SessionID sid, const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec, Status & status);
+		bool startAttempt(const std::shared_ptr<BypassHedgedCall> & call, BypassBackend * backend, SessionID sid, bool primary);
+
+		BypassSession * session;
+		BypassRouter * router;
+		SingleFlight * single_flight; // null if the calls of the invoker are not coalesced
+		BypassHedging * hedging;
+		BypassHedging::Latencies * latencies; // null if the invoker is not hedged
+		ThreadPool * thread_pool;
+		std::string name;
+		Connection * dedicated; // the connector cannot switch the remote session, the connection is kept by the session
+		BypassBackend * dedicated_backend;
+		Invoker * local_invoker; // invoker of the pinned session of a local backend
+		Session * local_target;
+		BypassBackend * local_backend;
 	};
 
 	class BypassSession : public Session
 	{
 		SAS_COPY_PROTECTOR(BypassSession)
 	public:
-		BypassSession(SessionID sid, const std::string & module_name_, Connector * connector_) 
-			: Session(sid), module_name(module_name_), connector(connector_), logger(Logging::getLogger("SAS.BypassSession." + module_name_))
+		BypassSession(SessionID sid, const std::string & module_name_, BypassRouter * router_, SingleFlight * single_flight_, BypassHedging * hedging_, ThreadPool * thread_pool_) 
+			: Session(sid), module_name(module_name_), router(router_), single_flight(single_flight_), hedging(hedging_), thread_pool(thread_pool_), remote_sid(0), backend(nullptr), local_session(nullptr), logger(Logging::getLogger("SAS.BypassSession." + module_name_))
 		{ }
 
 		virtual ~BypassSession()
@@ -67,50 +401,418 @@ namespace SAS {
 			for (auto inv : invokers)
 				if (inv.second)
 					delete inv.second;
+
+			if (local_session || retired_sessions.size())
+			{
+				// the ended session is deleted by the last unpin, other pinners may still hold it
+				for (auto s : retired_sessions)
+					backend->local->unpinSession(s);
+				if (local_session)
+				{
+					if (!local_session->isEnded())
+						backend->local->endSession(remote_sid);
+					backend->local->unpinSession(local_session);
+				}
+				return;
+			}
+
+			// the remote session is ended through any connection of the pool
+			std::string invoker_name;
+			BypassBackend * b;
+			SessionID sid;
+			{
+				// no backend is selected for a session which has not made any call
+				std::unique_lock<std::mutex> __locker(remote_sid_mut);
+				if (!remote_sid || !backend)
+					return;
+				sid = remote_sid;
+				b = backend;
+				invoker_name = remote_invoker;
+			}
+			NullEC ec;
+			auto conn = b->pool.acquire(invoker_name, ec);
+			if (!conn)
+				return;
+			if (conn->setSessionId(sid) && !conn->endSession(ec))
+				SAS_LOG_DEBUG(logger, "could not end remote session: " + std::to_string(sid));
+			conn->setSessionId(0);
+			b->pool.release(invoker_name, conn);
 		}
 
-	protected:
-		virtual Invoker * getInvoker(const std::string & invoker_name, ErrorCollector & ec) final
+		// the backend is selected by the first call, it is kept while the remote session exists
+		SessionID remoteSession(BypassBackend *& backend_, std::string & invoker_name)
 		{
-			SAS_LOG_NDC();
-			std::unique_lock<std::mutex> __lock_invokers;
-			auto & inv = invokers[invoker_name];
-			if (inv)
-				return inv;
+			std::unique_lock<std::mutex> __locker(remote_sid_mut);
+			if (!backend || (!remote_sid && router->isEjected(backend)))
+				backend = router->select();
+			backend_ = backend;
+			invoker_name = remote_invoker;
+			return remote_sid;
+		}
 
-			auto conn = connector->createConnection(module_name, invoker_name, ec);
-			if (!conn)
+		void setRemoteSessionId(SessionID sid, const std::string & invoker_name)
+		{
+			std::unique_lock<std::mutex> __locker(remote_sid_mut);
+			remote_sid = sid;
+			remote_invoker = invoker_name;
+		}
+
+		// the session of a local backend is pinned for the lifetime of this session,
+		// if it is ended by someone else, a new one is pinned and the old one is kept until the end because the invokers may still refer to it
+		Session * localSession(ErrorCollector & ec)
+		{
+			std::unique_lock<std::mutex> __locker(remote_sid_mut);
+			if (local_session && local_session->isEnded())
 			{
-				invokers.erase(invoker_name);
-				return nullptr;
+				retired_sessions.push_back(local_session);
+				local_session = nullptr;
+			}
+			if (!local_session)
+			{
+				SAS_LOG_ASSERT(logger, backend && backend->local, "backend must be local");
+				if (!(local_session = backend->local->pinSession(remote_sid, ec)))
+					return nullptr;
+				remote_sid = local_session->id();
 			}
+			return local_session;
+		}
 
-			return inv = new BypassInvoker(conn);
+	protected:
+		virtual Invoker * getInvoker(const std::string & invoker_name, ErrorCollector & ec) final
+		{
+			(void)ec;
+			SAS_LOG_NDC();
+			std::unique_lock<std::mutex> __lock_invokers(invokers_mut);
+			auto & inv = invokers[invoker_name];
+			if (!inv)
+				inv = new BypassInvoker(this, router, single_flight->enabled(invoker_name) ? single_flight : nullptr, hedging, thread_pool, invoker_name);
+			return inv;
 		}
 	private:
 		std::mutex invokers_mut;
 		std::map<std::string, Invoker*> invokers;
 		std::string module_name;
-		Connector * connector;
+		BypassRouter * router;
+		SingleFlight * single_flight;
+		BypassHedging * hedging;
+		ThreadPool * thread_pool;
+		std::mutex remote_sid_mut;
+		SessionID remote_sid; // local sessions are mapped to remote ones, they are not bound to connections
+		BypassBackend * backend;
+		std::string remote_invoker;
+		Session * local_session;
+		std::list<Session*> retired_sessions;
 		Logging::LoggerPtr logger;
 	};
 
+	Invoker::Status BypassInvoker::invoke(BypassBackend * backend, Connection * conn, const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec)
+	{
+		router->begin(backend);
+		auto begin = std::chrono::steady_clock::now();
+		auto ret = conn->invoke(input, output, ec);
+		router->end(backend, ret, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin));
+		return ret;
+	}
+
+	Invoker::Status BypassInvoker::invoke(const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec)
+	{
+		SAS_LOG_NDC();
+		if (single_flight)
+			return single_flight->invoke(name, input, output, ec, [&](std::vector<char> & output_, ErrorCollector & ec_)
+			{
+				return call(input, output_, ec_);
+			});
+		return call(input, output, ec);
+	}
+
+	Invoker::Status BypassInvoker::call(const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec)
+	{
+		if (local_invoker)
+			return localCall(local_backend, input, output, ec);
+		if (dedicated)
+			return invoke(dedicated_backend, dedicated, input, output, ec);
+
+		std::string invoker_name;
+		BypassBackend * backend;
+		SessionID sid = session->remoteSession(backend, invoker_name);
+		if (backend->local)
+			return localCall(backend, input, output, ec);
+
+		Status ret;
+		if (latencies && router->backends.size() > 1 && hedgedCall(backend, sid, input, output, ec, ret))
+			return ret;
+
+		auto conn = backend->pool.acquire(name, ec);
+		if (!conn)
+		{
+			router->failed(backend);
+			return Status::Error;
+		}
+
+		if (!conn->setSessionId(sid))
+		{
+			dedicated = conn;
+			dedicated_backend = backend;
+			return invoke(dedicated_backend, dedicated, input, output, ec);
+		}
+
+		ret = invoke(backend, conn, input, output, ec);
+		session->setRemoteSessionId(conn->sessionId(), name);
+		conn->setSessionId(0);
+		backend->pool.release(name, conn);
+		return ret;
+	}
+
+	// the session and the invoker of the local destination are resolved by the first call, the later ones are direct calls
+	Invoker::Status BypassInvoker::localCall(BypassBackend * backend, const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec)
+	{
+		Status ret = Status::Error;
+		backend->app->callIfEnabled<Status>(ret, [&]()
+		{
+			if (!local_invoker || local_target->isEnded())
+			{
+				local_invoker = nullptr;
+				if (!(local_target = session->localSession(ec)))
+					return Status::Error;
+				if (!(local_invoker = local_target->invoker(name, ec)))
+					return Status::FatalError;
+				local_backend = backend;
+			}
+			return local_invoker->invoke(input, output, ec);
+		});
+		return ret;
+	}
+
+	// runs an attempt of a hedged call in a thread of the pool, the attempt of the other backend uses a temporary remote session
+	bool BypassInvoker::startAttempt(const std::shared_ptr<BypassHedgedCall> & call, BypassBackend * backend, SessionID sid, bool primary)
+	{
+		auto th = thread_pool->allocate();
+		if (!th)
+			return false;
+
+		{
+			std::unique_lock<std::mutex> __locker(call->mut);
+			++call->pending;
+		}
+		hedging->begin();
+
+		auto router_ = router;
+		auto hedging_ = hedging;
+		auto latencies_ = latencies;
+		auto thread_pool_ = thread_pool;
+		th->run([call, backend, sid, primary, router_, hedging_, latencies_]()
+		{
+			std::vector<std::pair<long, std::string>> errors;
+			SimpleErrorCollector ec([&](long errorCode, const std::string & errorText)
+			{
+				errors.push_back(std::make_pair(errorCode, errorText));
+			});
+
+			std::vector<char> output;
+			Invoker::Status status = Invoker::Status::Error;
+			SessionID new_sid = sid;
+			auto conn = backend->pool.acquire(call->invoker_name, ec);
+			if (conn && !conn->setSessionId(primary ? sid : 0))
+			{
+				// the connection cannot be switched to the session, it is not returned to the pool
+				ec.add(SAS_CORE__ERROR__CONNECTOR__COMMUNICATION_FAILURE, "session of connection could not be set for hedged call of invoker '" + call->invoker_name + "'");
+				delete conn;
+				conn = nullptr;
+			}
+			if (!conn)
+				router_->failed(backend);
+			else
+			{
+				router_->begin(backend);
+				auto begin = std::chrono::steady_clock::now();
+				status = conn->invoke(call->input, output, ec);
+				auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin);
+				router_->end(backend, status, elapsed);
+				if (primary)
+					hedging_->record(latencies_, elapsed);
+				new_sid = conn->sessionId();
+			}
+
+			bool won = false;
+			{
+				std::unique_lock<std::mutex> __locker(call->mut);
+				--call->pending;
+				// an error is accepted only if there is no other attempt to wait for
+				if (!call->done && (status == Invoker::Status::OK || !call->pending))
+				{
+					won = true;
+					call->done = true;
+					call->status = status;
+					call->output = std::move(output);
+					call->errors = std::move(errors);
+					call->sid = new_sid;
+					call->primary_won = primary;
+					call->cv.notify_all();
+				}
+			}
+
+			if (conn)
+			{
+				// the remote session is kept only if it belongs to the local session
+				if (!primary || (!won && !sid))
+				{
+					NullEC nec;
+					conn->endSession(nec);
+				}
+				conn->setSessionId(0);
+				backend->pool.release(call->invoker_name, conn);
+			}
+		},
+		[hedging_, thread_pool_, th]()
+		{
+			thread_pool_->release(th);
+			hedging_->end();
+		});
+		return true;
+	}
+
+	// false if no thread is available, then the call is not hedged
+	bool BypassInvoker::hedgedCall(BypassBackend * backend, SessionID sid, const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec, Status & status)
+	{
+		auto call = std::make_shared<BypassHedgedCall>(name, input);
+		if (!startAttempt(call, backend, sid, true))
+			return false;
+		hedging->earn();
+
+		std::unique_lock<std::mutex> __locker(call->mut);
+		auto delay = hedging->delay(latencies);
+		if (delay >= 0 && !call->cv.wait_for(__locker, std::chrono::microseconds(delay), [&]() { return call->done; }))
+		{
+			BypassBackend * other;
+			if ((other = router->select(backend)) && hedging->spend())
+			{
+				__locker.unlock();
+				startAttempt(call, other, 0, false);
+				__locker.lock();
+			}
+		}
+		call->cv.wait(__locker, [&]() { return call->done; });
+
+		if (call->primary_won)
+			session->setRemoteSessionId(call->sid, name);
+		output = std::move(call->output);
+		for (auto & e : call->errors)
+			ec.add(e.first, e.second);
+		status = call->status;
+		return true;
+	}
+
 	struct BypassModule_priv
 	{
         BypassModule_priv(Application * app, const std::string & name) :
             app(app),
             name(name),
-            logger(Logging::getLogger("SAS.BypassModule." + name))
+            logger(Logging::getLogger("SAS.BypassModule." + name)),
+            router(name),
+            info_ready(false),
+            connecting(false)
 		{ }
 
+		enum class ConnectMode { Eager, Lazy, Background };
+
+		// the backends are expected to serve the same module, the first one which answers is used
+		bool fetchModuleInfo(ErrorCollector & ec)
+		{
+			if (info_ready)
+				return true;
+			std::unique_lock<std::mutex> __locker(info_mut);
+			if (info_ready)
+				return true;
+			NullEC nec;
+			for (size_t i(0), l(router.backends.size()); i < l; ++i)
+			{
+				auto & b = router.backends[i];
+				auto & bec = i + 1 == l ? ec : nec;
+				if (b->pool.connect(bec) && b->connector->getModuleInfo(dest_module_name, description, version, bec))
+				{
+					info_ready = true;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// connects the backends and fetches the module information in a thread of the pool, unless it is already in progress
+		bool connectInBackground()
+		{
+			{
+				std::unique_lock<std::mutex> __locker(connecting_mut);
+				if (connecting)
+					return true;
+				connecting = true;
+			}
+			auto th = app->threadPool()->allocate();
+			if (!th)
+			{
+				std::unique_lock<std::mutex> __locker(connecting_mut);
+				connecting = false;
+				connecting_cv.notify_all();
+				return false;
+			}
+			auto thread_pool = app->threadPool();
+			th->run([this]()
+			{
+				SAS_LOG_NDC();
+				NullEC nec;
+				for (auto & b : router.backends)
+					if (!b->pool.connect(nec))
+						SAS_LOG_WARN(logger, "could not connect to '" + b->name() + "', it is retried by the first call");
+				if (fetchModuleInfo(nec))
+				{
+					SAS_LOG_INFO(logger, "bypass module is ready");
+				}
+				else
+				{
+					SAS_LOG_WARN(logger, "could not get module information of '" + dest_module_name + "'");
+				}
+			},
+			[this, thread_pool, th]()
+			{
+				thread_pool->release(th);
+				std::unique_lock<std::mutex> __locker(connecting_mut);
+				connecting = false;
+				connecting_cv.notify_all();
+			});
+			return true;
+		}
+
+		// LAZY mode or a failed fetch: the fetch is started in the background, a later query may find the information
+		bool moduleInfoReady()
+		{
+			if (info_ready)
+				return true;
+			connectInBackground();
+			return false;
+		}
+
+		void waitForConnecting()
+		{
+			std::unique_lock<std::mutex> __locker(connecting_mut);
+			connecting_cv.wait(__locker, [&]() { return !connecting; });
+		}
+
         Application * app;
 		std::string name;
 		std::string dest_module_name;
+		Logging::LoggerPtr logger;
+
+		BypassRouter router;
+		SingleFlight single_flight;
+		BypassHedging hedging;
+
+		std::mutex info_mut;
+		std::atomic<bool> info_ready;
 		std::string version;
 		std::string description;
-		Logging::LoggerPtr logger;
 
-		Connector * connector;
+		std::mutex connecting_mut;
+		std::condition_variable connecting_cv;
+		bool connecting;
 	};
 
     BypassModule::BypassModule(Application * app, const std::string & name) :
@@ -119,17 +821,41 @@ namespace SAS {
 
 	BypassModule::~BypassModule()
 	{
+		// the sessions use the connection pool
+		SessionManager::deinit();
+		priv->waitForConnecting();
+		priv->hedging.wait();
+		if (auto hedged = priv->hedging.hedgedCalls())
+			SAS_LOG_INFO(priv->logger, "hedged calls: " + std::to_string(hedged));
 		delete priv;
 	}
 
+	// the module information is not fetched synchronously here, it is empty until it is fetched,
+	// it is not modified after 'info_ready' is set
 	std::string BypassModule::description() const
-	{ return std::string(); }
+	{
+		if (!priv->moduleInfoReady())
+			return std::string();
+		return priv->description;
+	}
 
 	std::string BypassModule::version() const
 	{
+		if (!priv->moduleInfoReady())
+			return std::string();
 		return priv->version;
 	}
 
+	bool BypassModule::isReady() const
+	{
+		if (!priv->moduleInfoReady())
+			return false;
+		for (auto & b : priv->router.backends)
+			if (b->pool.isConnected() && b->connector->isReady())
+				return true;
+		return false;
+	}
+
 	std::string BypassModule::name() const
 	{
 		return priv->name;
@@ -139,28 +865,136 @@ namespace SAS {
 	{
 		SAS_LOG_NDC();
 
-		std::string connector_name;
-        if (!priv->app->configReader()->getStringEntry(config_path + "/CONNECTOR", connector_name, ec))
+		// '<connector>[:<weight>]'
+		std::vector<std::string> connector_names;
+		if (!priv->app->configReader()->getStringListEntry(config_path + "/CONNECTORS", connector_names, std::vector<std::string>(), ec))
+			return false;
+		if (!connector_names.size())
 		{
-			auto err = ec.add(SAS_CORE__ERROR__MODULE__MISSING_CONFIG_ENTRY, "connector is not specified for bypass module '" + priv->name + "'");
-			SAS_LOG_ERROR(priv->logger, err);
+			std::string connector_name;
+			if (!priv->app->configReader()->getStringEntry(config_path + "/CONNECTOR", connector_name, ec))
+			{
+				auto err = ec.add(SAS_CORE__ERROR__MODULE__MISSING_CONFIG_ENTRY, "connector is not specified for bypass module '" + priv->name + "'");
+				SAS_LOG_ERROR(priv->logger, err);
+				return false;
+			}
+			connector_names.push_back(connector_name);
+		}
+
+        if (!priv->app->configReader()->getStringEntry(config_path + "/MODULE", priv->dest_module_name, priv->name, ec))
 			return false;
+
+		long long pool_max_idle, pool_idle_timeout;
+		if (!priv->app->configReader()->getNumberEntry(config_path + "/POOL_MAX_IDLE", pool_max_idle, 8, ec) ||
+			!priv->app->configReader()->getNumberEntry(config_path + "/POOL_IDLE_TIMEOUT", pool_idle_timeout, 60, ec))
+			return false;
+		SAS_LOG_VAR(priv->logger, pool_max_idle);
+		SAS_LOG_VAR(priv->logger, pool_idle_timeout);
+
+		for (auto & entry : connector_names)
+		{
+			std::string connector_name = entry;
+			long weight = 1;
+			auto colon = entry.rfind(':');
+			if (colon != std::string::npos)
+			{
+				connector_name = entry.substr(0, colon);
+				char * end;
+				weight = strtol(entry.c_str() + colon + 1, &end, 10);
+				if (*end || weight <= 0)
+				{
+					auto err = ec.add(SAS_CORE__ERROR__MODULE__INVALID_CONFIG_VALUE, "invalid weight of connector: '" + entry + "'");
+					SAS_LOG_ERROR(priv->logger, err);
+					return false;
+				}
+			}
+			SAS_LOG_VAR(priv->logger, connector_name);
+			SAS_LOG_VAR(priv->logger, weight);
+
+			SAS_LOG_TRACE(priv->logger, "get connector object");
+			Connector * connector;
+			if (!(connector = priv->app->objectRegistry()->getObject<Connector>(SAS_OBJECT_TYPE__CONNECTOR, connector_name, ec)))
+				return false;
+
+			std::unique_ptr<BypassBackend> backend(new BypassBackend(priv->app, priv->name, connector, weight));
+			if (auto loopback = dynamic_cast<LoopbackConnector*>(connector))
+			{
+				NullEC nec;
+				if ((backend->local = loopback->module(priv->dest_module_name, nec)))
+					SAS_LOG_DEBUG(priv->logger, "destination module is local through connector '" + connector_name + "'");
+			}
+			backend->pool.init(connector, priv->dest_module_name, pool_max_idle > 0 ? static_cast<size_t>(pool_max_idle) : 0, std::chrono::seconds(pool_idle_timeout));
+			priv->router.backends.push_back(std::move(backend));
 		}
 
-		SAS_LOG_VAR(priv->logger, connector_name);
+		std::string routing;
+		if (!priv->app->configReader()->getStringEntry(config_path + "/ROUTING", routing, "LEAST_OUTSTANDING", ec))
+			return false;
+		SAS_LOG_VAR(priv->logger, routing);
+		if (routing == "LEAST_OUTSTANDING")
+			priv->router.mode = BypassRouter::Mode::LeastOutstanding;
+		else if (routing == "WEIGHTED_ROUND_ROBIN")
+			priv->router.mode = BypassRouter::Mode::WeightedRoundRobin;
+		else
+		{
+			auto err = ec.add(SAS_CORE__ERROR__MODULE__INVALID_CONFIG_VALUE, "invalid value of 'ROUTING': '" + routing + "'");
+			SAS_LOG_ERROR(priv->logger, err);
+			return false;
+		}
 
-		SAS_LOG_TRACE(priv->logger, "get connector object");
-        if (!(priv->connector = priv->app->objectRegistry()->getObject<Connector>(SAS_OBJECT_TYPE__CONNECTOR, connector_name, ec)))
+		long long ejection_failures, ejection_latency, ejection_time;
+		if (!priv->app->configReader()->getNumberEntry(config_path + "/EJECTION_FAILURES", ejection_failures, 5, ec) ||
+			!priv->app->configReader()->getNumberEntry(config_path + "/EJECTION_LATENCY", ejection_latency, 0, ec) ||
+			!priv->app->configReader()->getNumberEntry(config_path + "/EJECTION_TIME", ejection_time, 30, ec))
 			return false;
-		
-		SAS_LOG_TRACE(priv->logger, "activate connector");
-		if(!priv->connector->connect(ec))
+		SAS_LOG_VAR(priv->logger, ejection_failures);
+		SAS_LOG_VAR(priv->logger, ejection_latency);
+		SAS_LOG_VAR(priv->logger, ejection_time);
+		priv->router.ejection_failures = static_cast<long>(ejection_failures);
+		priv->router.ejection_latency = static_cast<long>(ejection_latency * 1000);
+		priv->router.ejection_time = ejection_time * 1000000;
+
+		std::vector<std::string> single_flight_invokers;
+		if (!priv->app->configReader()->getStringListEntry(config_path + "/SINGLE_FLIGHT_INVOKERS", single_flight_invokers, std::vector<std::string>(), ec))
 			return false;
+		priv->single_flight.setInvokers(single_flight_invokers);
 
-        if (!priv->app->configReader()->getStringEntry(config_path + "/MODULE", priv->dest_module_name, priv->name, ec))
+		std::vector<std::string> hedged_invokers;
+		long long hedge_percentile, hedge_min_delay, hedge_budget;
+		if (!priv->app->configReader()->getStringListEntry(config_path + "/HEDGED_INVOKERS", hedged_invokers, std::vector<std::string>(), ec) ||
+			!priv->app->configReader()->getNumberEntry(config_path + "/HEDGE_PERCENTILE", hedge_percentile, 95, ec) ||
+			!priv->app->configReader()->getNumberEntry(config_path + "/HEDGE_MIN_DELAY", hedge_min_delay, 5, ec) ||
+			!priv->app->configReader()->getNumberEntry(config_path + "/HEDGE_BUDGET", hedge_budget, 10, ec))
+			return false;
+		SAS_LOG_VAR(priv->logger, hedge_percentile);
+		SAS_LOG_VAR(priv->logger, hedge_min_delay);
+		SAS_LOG_VAR(priv->logger, hedge_budget);
+		if (hedge_percentile < 1 || hedge_percentile > 100)
+		{
+			auto err = ec.add(SAS_CORE__ERROR__MODULE__INVALID_CONFIG_VALUE, "invalid value of 'HEDGE_PERCENTILE': '" + std::to_string(hedge_percentile) + "'");
+			SAS_LOG_ERROR(priv->logger, err);
 			return false;
+		}
+		priv->hedging.init(hedged_invokers, static_cast<long>(hedge_percentile), std::chrono::milliseconds(hedge_min_delay),
+			hedge_budget > 0 ? static_cast<double>(hedge_budget) / 100 : 0);
 
-		SAS_LOG_TRACE(priv->logger, "get module information");
+		std::string connect_mode_str;
+		if (!priv->app->configReader()->getStringEntry(config_path + "/CONNECT_MODE", connect_mode_str, "EAGER", ec))
+			return false;
+		SAS_LOG_VAR(priv->logger, connect_mode_str);
+		BypassModule_priv::ConnectMode connect_mode;
+		if (connect_mode_str == "EAGER")
+			connect_mode = BypassModule_priv::ConnectMode::Eager;
+		else if (connect_mode_str == "LAZY")
+			connect_mode = BypassModule_priv::ConnectMode::Lazy;
+		else if (connect_mode_str == "BACKGROUND")
+			connect_mode = BypassModule_priv::ConnectMode::Background;
+		else
+		{
+			auto err = ec.add(SAS_CORE__ERROR__MODULE__INVALID_CONFIG_VALUE, "invalid value of 'CONNECT_MODE': '" + connect_mode_str + "'");
+			SAS_LOG_ERROR(priv->logger, err);
+			return false;
+		}
 
 		long long default_session_lifetime;
         if (!priv->app->configReader()->getNumberEntry(config_path + "/DEFAULT_SESSION_LIFETIME", default_session_lifetime, 120, ec))
@@ -169,15 +1003,32 @@ namespace SAS {
         if (!SAS::SessionManager::init(std::chrono::seconds(default_session_lifetime), ec))
 			return false;
 
-		return priv->connector->getModuleInfo(priv->dest_module_name, priv->description, priv->version, ec);
+		switch (connect_mode)
+		{
+		case BypassModule_priv::ConnectMode::Eager:
+			SAS_LOG_TRACE(priv->logger, "activate connectors");
+			for (auto & b : priv->router.backends)
+				if (!b->pool.connect(ec))
+					return false;
+			SAS_LOG_TRACE(priv->logger, "get module information");
+			return priv->fetchModuleInfo(ec);
+		case BypassModule_priv::ConnectMode::Background:
+			if (priv->connectInBackground())
+				break;
+			SAS_LOG_WARN(priv->logger, "no thread is available to connect in the background, the connectors are activated by the first calls");
+			break;
+		case BypassModule_priv::ConnectMode::Lazy:
+			break;
+		}
+		return true;
 	}
 
 	Session * BypassModule::createSession(SessionID id, ErrorCollector & ec)
 	{
         (void)ec;
 		SAS_LOG_NDC();
-		SAS_LOG_ASSERT(priv->logger, priv->connector, "connector must be initialized");
-		return new BypassSession(id, priv->dest_module_name, priv->connector);
+		SAS_LOG_ASSERT(priv->logger, priv->router.backends.size(), "connectors must be initialized");
+		return new BypassSession(id, priv->dest_module_name, &priv->router, &priv->single_flight, &priv->hedging, priv->app->threadPool());
 	}
 
 }
@@ -38,6 +38,9 @@ namespace SAS {
 
         bool init(const std::string & config_path, ErrorCollector & ec);
 
+		// a connector is connected and the module information is fetched (CONNECT_MODE)
+		virtual bool isReady() const final;
+
 	protected:
 		virtual Session * createSession(SessionID id, ErrorCollector & ec) final;
 
@@ -0,0 +1,414 @@
+/*
+	This file is part of sasBypass.
+
+	sasBypass is free software: you can redistribute it and/or modify
+	it under the terms of the Lesser GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	sasBypass is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with sasBypass.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "cachingmodule.h"
+#include "singleflight.h"
+#include "invokercache.h"
+#include "connectionpool.h"
+
+#include <sasCore/session.h>
+#include <sasCore/invoker.h>
+#include <sasCore/logging.h>
+#include <sasCore/configreader.h>
+#include <sasCore/objectregistry.h>
+#include <sasCore/application.h>
+#include <sasCore/errorcollector.h>
+#include <sasCore/connector.h>
+#include <sasCore/errorcodes.h>
+#include <sasCore/timerthread.h>
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <chrono>
+#include <atomic>
+#include <memory>
+
+namespace SAS {
+
+	struct CachingModule_priv
+	{
+		CachingModule_priv(Application * app_, const std::string & name_) :
+			app(app_),
+			name(name_),
+			connector(nullptr),
+			target(nullptr),
+			shard_num(16),
+			max_size(0),
+			ttl(0),
+			reporter(app_->threadPool(), this),
+			logger(Logging::getLogger("SAS.CachingModule." + name_))
+		{ }
+
+		~CachingModule_priv()
+		{
+			reporter.stop();
+			reporter.wait();
+			report();
+		}
+
+		Application * app;
+		std::string name;
+		std::string target_module_name;
+		std::string version;
+		std::string description;
+
+		Connector * connector; // the target is called through the connector if it is set
+		std::unique_ptr<BypassConnectionPool> pool; // connections of the connector, shared by the sessions
+		std::atomic<Module*> target; // otherwise the target is a local module, it is looked up on the first use
+
+		std::set<std::string> cached_invokers; // all invokers are cached if it is empty
+		size_t shard_num;
+		size_t max_size; // per invoker
+		std::chrono::milliseconds ttl; // default of the invokers
+		std::string config_path; // the TTL of the invokers are read on their first use
+
+		std::mutex caches_mut;
+		std::map<std::string, std::unique_ptr<InvokerCache>> caches;
+
+		SingleFlight single_flight; // the misses of the same input are coalesced
+
+		struct Reporter : public TimerThread
+		{
+			Reporter(ThreadPool * pool, CachingModule_priv * priv_) : TimerThread(pool), priv(priv_)
+			{ }
+
+			void shot() override
+			{
+				priv->report();
+			}
+
+			CachingModule_priv * priv;
+		} reporter;
+
+		Logging::LoggerPtr logger;
+
+		Module * targetModule(ErrorCollector & ec)
+		{
+			Module * ret = target;
+			if (!ret && (ret = app->objectRegistry()->getObject<Module>(SAS_OBJECT_TYPE__MODULE, target_module_name, ec)))
+				target = ret;
+			return ret;
+		}
+
+		// nullptr if the outputs of the invoker are not cached
+		InvokerCache * cache(const std::string & invoker_name)
+		{
+			if (cached_invokers.size() && !cached_invokers.count(invoker_name))
+				return nullptr;
+			std::unique_lock<std::mutex> __locker(caches_mut);
+			auto & ret = caches[invoker_name];
+			if (!ret)
+			{
+				long long invoker_ttl;
+				NullEC ec;
+				if (!app->configReader()->getNumberEntry(config_path + "/INVOKERS/" + invoker_name + "/TTL", invoker_ttl, std::chrono::duration_cast<std::chrono::seconds>(ttl).count(), ec))
+					invoker_ttl = std::chrono::duration_cast<std::chrono::seconds>(ttl).count();
+				SAS_LOG_DEBUG(logger, "TTL of invoker '" + invoker_name + "': " + std::to_string(invoker_ttl));
+				ret.reset(new InvokerCache(shard_num, max_size, std::chrono::seconds(invoker_ttl > 0 ? invoker_ttl : 0)));
+			}
+			return ret.get();
+		}
+
+		void report()
+		{
+			std::unique_lock<std::mutex> __locker(caches_mut);
+			for (auto & c : caches)
+				SAS_LOG_INFO(logger, "cache of invoker '" + c.first + "': " + c.second->stats());
+			if (single_flight.coalesced())
+				SAS_LOG_INFO(logger, "coalesced calls: " + std::to_string(single_flight.coalesced()));
+		}
+	};
+
+	class CachingSession;
+
+	class CachingInvoker : public Invoker
+	{
+		SAS_COPY_PROTECTOR(CachingInvoker)
+	public:
+		inline CachingInvoker(CachingSession * session_, const std::string & name_, InvokerCache * cache_, SingleFlight * single_flight_) : Invoker(),
+			session(session_), name(name_), cache(cache_), single_flight(single_flight_)
+		{ }
+
+		virtual Status invoke(const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec) final;
+
+	private:
+		CachingSession * session;
+		std::string name;
+		InvokerCache * cache;
+		SingleFlight * single_flight; // null if the calls of the invoker are not coalesced
+	};
+
+	class CachingSession : public Session
+	{
+		SAS_COPY_PROTECTOR(CachingSession)
+	public:
+		CachingSession(SessionID sid, CachingModule_priv * priv_) : Session(sid), priv(priv_), target_sid(0)
+		{ }
+
+		virtual ~CachingSession()
+		{
+			for (auto & inv : invokers)
+				delete inv.second;
+			// the dedicated connections end their own remote sessions
+			for (auto & conn : dedicated)
+				delete conn.second;
+
+			if (!target_sid)
+				return;
+
+			if (priv->pool)
+			{
+				// the remote session is ended through any connection of the pool
+				NullEC ec;
+				auto conn = priv->pool->acquire(target_invoker, ec);
+				if (!conn)
+					return;
+				if (conn->setSessionId(target_sid) && !conn->endSession(ec))
+					SAS_LOG_DEBUG(priv->logger, "could not end remote session: " + std::to_string(target_sid));
+				conn->setSessionId(0);
+				priv->pool->release(target_invoker, conn);
+				return;
+			}
+
+			Module * target;
+			if ((target = priv->target))
+				target->endSession(target_sid);
+		}
+
+		Invoker::Status invokeTarget(const std::string & invoker_name, const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec)
+		{
+			SAS_LOG_NDC();
+			if (priv->pool)
+			{
+				Connection * conn = nullptr;
+				SessionID sid;
+				{
+					std::unique_lock<std::mutex> __locker(mut);
+					auto it = dedicated.find(invoker_name);
+					if (it != dedicated.end())
+						conn = it->second;
+					sid = target_sid;
+				}
+				if (conn)
+					return conn->invoke(input, output, ec);
+
+				if (!(conn = priv->pool->acquire(invoker_name, ec)))
+					return Invoker::Status::Error;
+
+				if (!conn->setSessionId(sid))
+				{
+					// the connection cannot be switched to the session, it is kept by the session
+					std::unique_lock<std::mutex> __locker(mut);
+					auto & c = dedicated[invoker_name];
+					if (c)
+						delete conn;
+					else
+						c = conn;
+					conn = c;
+					__locker.unlock();
+					return conn->invoke(input, output, ec);
+				}
+
+				auto ret = conn->invoke(input, output, ec);
+				{
+					std::unique_lock<std::mutex> __locker(mut);
+					if ((target_sid = conn->sessionId()))
+						target_invoker = invoker_name;
+				}
+				conn->setSessionId(0);
+				priv->pool->release(invoker_name, conn);
+				return ret;
+			}
+
+			Module * target;
+			if (!(target = priv->targetModule(ec)))
+				return Invoker::Status::Error;
+
+			Session * session;
+			{
+				std::unique_lock<std::mutex> __locker(mut);
+				if (!(session = target->getSession(target_sid, ec)))
+					return Invoker::Status::Error;
+				target_sid = session->id();
+			}
+			auto ret = session->invoke(invoker_name, input, output, ec);
+			session->unlock();
+			return ret;
+		}
+
+	protected:
+		virtual Invoker * getInvoker(const std::string & invoker_name, ErrorCollector & ec) final
+		{
+			(void)ec;
+			SAS_LOG_NDC();
+			std::unique_lock<std::mutex> __locker(mut);
+			auto & inv = invokers[invoker_name];
+			if (!inv)
+				inv = new CachingInvoker(this, invoker_name, priv->cache(invoker_name),
+					priv->single_flight.enabled(invoker_name) ? &priv->single_flight : nullptr);
+			return inv;
+		}
+
+	private:
+		CachingModule_priv * priv;
+		std::mutex mut;
+		std::map<std::string, Invoker*> invokers;
+		std::map<std::string, Connection*> dedicated; // connections which do not support switching sessions
+		SessionID target_sid;
+		std::string target_invoker; // the remote session is ended through a connection of this invoker
+	};
+
+	Invoker::Status CachingInvoker::invoke(const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec)
+	{
+		SAS_LOG_NDC();
+		if (cache && cache->get(input, output))
+			return Status::OK;
+
+		auto call = [&](std::vector<char> & output_, ErrorCollector & ec_)
+		{
+			auto ret = session->invokeTarget(name, input, output_, ec_);
+			// only the successful outputs are cached
+			if (cache && ret == Status::OK)
+				cache->put(input, output_);
+			return ret;
+		};
+		return single_flight ? single_flight->invoke(name, input, output, ec, call) : call(output, ec);
+	}
+
+	CachingModule::CachingModule(Application * app, const std::string & name) :
+		Module(app), priv(new CachingModule_priv(app, name))
+	{ }
+
+	CachingModule::~CachingModule()
+	{
+		// the sessions use the target
+		SessionManager::deinit();
+		delete priv;
+	}
+
+	std::string CachingModule::description() const
+	{
+		if (priv->connector)
+			return priv->description;
+		NullEC ec;
+		auto target = priv->targetModule(ec);
+		return target ? target->description() : std::string();
+	}
+
+	std::string CachingModule::version() const
+	{
+		if (priv->connector)
+			return priv->version;
+		NullEC ec;
+		auto target = priv->targetModule(ec);
+		return target ? target->version() : std::string();
+	}
+
+	std::string CachingModule::name() const
+	{
+		return priv->name;
+	}
+
+	bool CachingModule::init(const std::string & config_path, ErrorCollector & ec)
+	{
+		SAS_LOG_NDC();
+
+		std::string connector_name;
+		if (!priv->app->configReader()->getStringEntry(config_path + "/CONNECTOR", connector_name, std::string(), ec))
+			return false;
+		SAS_LOG_VAR(priv->logger, connector_name);
+
+		if (connector_name.length())
+		{
+			SAS_LOG_TRACE(priv->logger, "get connector object");
+			if (!(priv->connector = priv->app->objectRegistry()->getObject<Connector>(SAS_OBJECT_TYPE__CONNECTOR, connector_name, ec)))
+				return false;
+
+			if (!priv->app->configReader()->getStringEntry(config_path + "/MODULE", priv->target_module_name, priv->name, ec))
+				return false;
+
+			long long pool_max_idle, pool_idle_timeout;
+			if (!priv->app->configReader()->getNumberEntry(config_path + "/POOL_MAX_IDLE", pool_max_idle, 8, ec) ||
+				!priv->app->configReader()->getNumberEntry(config_path + "/POOL_IDLE_TIMEOUT", pool_idle_timeout, 60, ec))
+				return false;
+			SAS_LOG_VAR(priv->logger, pool_max_idle);
+			SAS_LOG_VAR(priv->logger, pool_idle_timeout);
+
+			priv->pool.reset(new BypassConnectionPool(priv->app, priv->name + "." + connector_name));
+			priv->pool->init(priv->connector, priv->target_module_name, pool_max_idle > 0 ? static_cast<size_t>(pool_max_idle) : 0, std::chrono::seconds(pool_idle_timeout));
+			if (!priv->pool->connect(ec))
+				return false;
+		}
+		else if (!priv->app->configReader()->getStringEntry(config_path + "/MODULE", priv->target_module_name, ec))
+		{
+			auto err = ec.add(SAS_CORE__ERROR__MODULE__MISSING_CONFIG_ENTRY, "neither connector nor module is specified for caching module '" + priv->name + "'");
+			SAS_LOG_ERROR(priv->logger, err);
+			return false;
+		}
+		SAS_LOG_VAR(priv->logger, priv->target_module_name);
+
+		std::vector<std::string> cached_invokers;
+		if (!priv->app->configReader()->getStringListEntry(config_path + "/CACHED_INVOKERS", cached_invokers, std::vector<std::string>(), ec))
+			return false;
+		priv->cached_invokers.insert(cached_invokers.begin(), cached_invokers.end());
+
+		long long ttl, max_size, shard_num, stats_interval;
+		if (!priv->app->configReader()->getNumberEntry(config_path + "/CACHE_TTL", ttl, 60, ec) ||
+			!priv->app->configReader()->getNumberEntry(config_path + "/CACHE_MAX_SIZE", max_size, 16 * 1024 * 1024, ec) ||
+			!priv->app->configReader()->getNumberEntry(config_path + "/CACHE_SHARDS", shard_num, 16, ec) ||
+			!priv->app->configReader()->getNumberEntry(config_path + "/CACHE_STATS_INTERVAL", stats_interval, 300, ec))
+			return false;
+		SAS_LOG_VAR(priv->logger, ttl);
+		SAS_LOG_VAR(priv->logger, max_size);
+		SAS_LOG_VAR(priv->logger, shard_num);
+		SAS_LOG_VAR(priv->logger, stats_interval);
+		priv->ttl = std::chrono::seconds(ttl > 0 ? ttl : 0);
+		priv->max_size = max_size > 0 ? static_cast<size_t>(max_size) : 0;
+		priv->shard_num = shard_num > 0 ? static_cast<size_t>(shard_num) : 1;
+		priv->config_path = config_path;
+
+		std::vector<std::string> single_flight_invokers;
+		if (!priv->app->configReader()->getStringListEntry(config_path + "/SINGLE_FLIGHT_INVOKERS", single_flight_invokers, std::vector<std::string>(), ec))
+			return false;
+		priv->single_flight.setInvokers(single_flight_invokers);
+
+		long long default_session_lifetime;
+		if (!priv->app->configReader()->getNumberEntry(config_path + "/DEFAULT_SESSION_LIFETIME", default_session_lifetime, 120, ec))
+			return false;
+
+		if (!SAS::SessionManager::init(std::chrono::seconds(default_session_lifetime), ec))
+			return false;
+
+		if (stats_interval > 0)
+			priv->reporter.start(std::chrono::seconds(stats_interval));
+
+		if (!priv->connector)
+			return true;
+
+		SAS_LOG_TRACE(priv->logger, "get module information");
+		return priv->connector->getModuleInfo(priv->target_module_name, priv->description, priv->version, ec);
+	}
+
+	Session * CachingModule::createSession(SessionID id, ErrorCollector & ec)
+	{
+		(void)ec;
+		SAS_LOG_NDC();
+		return new CachingSession(id, priv);
+	}
+
+}
@@ -0,0 +1,51 @@
+/*
+	This file is part of sasBypass.
+
+	sasBypass is free software: you can redistribute it and/or modify
+	it under the terms of the Lesser GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	sasBypass is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with sasBypass.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef sasBypass__cachingmodule_h
+#define sasBypass__cachingmodule_h
+
+#include "config.h"
+#include <sasCore/module.h>
+
+namespace SAS {
+	class Application;
+
+	// caches the outputs of the invokers of a target module or connector by their inputs
+	struct CachingModule_priv;
+	class CachingModule : public Module
+	{
+		SAS_COPY_PROTECTOR(CachingModule)
+	public:
+		CachingModule(Application * app, const std::string & name);
+		virtual ~CachingModule();
+
+		virtual std::string description() const final;
+		virtual std::string version() const final;
+		virtual std::string name() const final;
+
+		bool init(const std::string & config_path, ErrorCollector & ec);
+
+	protected:
+		virtual Session * createSession(SessionID id, ErrorCollector & ec) final;
+
+	private:
+		CachingModule_priv * priv;
+	};
+
+}
+
+#endif // sasBypass__cachingmodule_h
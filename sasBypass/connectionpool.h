@@ -0,0 +1,178 @@
+/*
+	This file is part of sasBypass.
+
+	sasBypass is free software: you can redistribute it and/or modify
+	it under the terms of the Lesser GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	sasBypass is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with sasBypass.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef sasBypass__connectionpool_h
+#define sasBypass__connectionpool_h
+
+#include "config.h"
+#include <sasCore/application.h>
+#include <sasCore/connector.h>
+#include <sasCore/errorcollector.h>
+#include <sasCore/logging.h>
+#include <sasCore/timerthread.h>
+
+#include <string>
+#include <map>
+#include <list>
+#include <mutex>
+#include <chrono>
+#include <atomic>
+
+namespace SAS {
+
+	// reusable connections per invoker of the destination module (used by the bypass and the caching modules), the idle connections are deleted by the reaper thread
+	class BypassConnectionPool
+	{
+		SAS_COPY_PROTECTOR(BypassConnectionPool)
+
+		struct Reaper : public TimerThread
+		{
+			Reaper(ThreadPool * pool, BypassConnectionPool * that_) : TimerThread(pool), that(that_)
+			{ }
+
+			void shot() override
+			{
+				that->reap();
+			}
+
+			BypassConnectionPool * that;
+		};
+
+		struct IdleConnection
+		{
+			Connection * conn;
+			std::chrono::steady_clock::time_point since;
+		};
+
+	public:
+		BypassConnectionPool(Application * app, const std::string & name) :
+			connected(false),
+			reaper(app->threadPool(), this),
+			logger(Logging::getLogger("SAS.BypassConnectionPool." + name))
+		{ }
+
+		~BypassConnectionPool()
+		{
+			reaper.stop();
+			reaper.wait();
+			for (auto & it : idle)
+				for (auto & c : it.second)
+					delete c.conn;
+		}
+
+		void init(Connector * connector_, const std::string & module_name_, size_t max_idle_, std::chrono::seconds idle_timeout_)
+		{
+			connector = connector_;
+			module_name = module_name_;
+			max_idle = max_idle_;
+			idle_timeout = idle_timeout_;
+			if (idle_timeout.count() > 0)
+				reaper.start(std::chrono::duration_cast<std::chrono::milliseconds>(idle_timeout) / 2);
+		}
+
+		// the connector is connected once, by init or by the first connection (CONNECT_MODE)
+		bool connect(ErrorCollector & ec)
+		{
+			if (connected)
+				return true;
+			std::unique_lock<std::mutex> __locker(connect_mut);
+			if (connected)
+				return true;
+			SAS_LOG_TRACE(logger, "activate connector");
+			if (!connector->connect(ec))
+				return false;
+			connected = true;
+			return true;
+		}
+
+		bool isConnected() const
+		{
+			return connected;
+		}
+
+		Connection * acquire(const std::string & invoker_name, ErrorCollector & ec)
+		{
+			SAS_LOG_NDC();
+			{
+				std::unique_lock<std::mutex> __locker(mut);
+				auto & list = idle[invoker_name];
+				if (list.size())
+				{
+					// the most recently used one, this way the rest can expire
+					auto conn = list.back().conn;
+					list.pop_back();
+					return conn;
+				}
+			}
+			if (!connect(ec))
+				return nullptr;
+			SAS_LOG_TRACE(logger, "create new connection for invoker '" + invoker_name + "'");
+			return connector->createConnection(module_name, invoker_name, ec);
+		}
+
+		void release(const std::string & invoker_name, Connection * conn)
+		{
+			Connection * to_be_deleted = nullptr;
+			{
+				std::unique_lock<std::mutex> __locker(mut);
+				auto & list = idle[invoker_name];
+				list.push_back({ conn, std::chrono::steady_clock::now() });
+				if (list.size() > max_idle)
+				{
+					to_be_deleted = list.front().conn;
+					list.pop_front();
+				}
+			}
+			delete to_be_deleted;
+		}
+
+		void reap()
+		{
+			SAS_LOG_NDC();
+			std::list<Connection*> to_be_deleted;
+			{
+				auto limit = std::chrono::steady_clock::now() - idle_timeout;
+				std::unique_lock<std::mutex> __locker(mut);
+				for (auto & it : idle)
+					while (it.second.size() && it.second.front().since <= limit)
+					{
+						to_be_deleted.push_back(it.second.front().conn);
+						it.second.pop_front();
+					}
+			}
+			if (to_be_deleted.size())
+				SAS_LOG_DEBUG(logger, "delete idle connections: " + std::to_string(to_be_deleted.size()));
+			for (auto conn : to_be_deleted)
+				delete conn;
+		}
+
+	private:
+		Connector * connector = nullptr;
+		std::string module_name;
+		size_t max_idle = 0;
+		std::chrono::seconds idle_timeout;
+		std::atomic<bool> connected;
+		std::mutex connect_mut;
+		std::mutex mut;
+		std::map<std::string, std::list<IdleConnection>> idle;
+		Reaper reaper;
+		Logging::LoggerPtr logger;
+	};
+
+}
+
+#endif // sasBypass__connectionpool_h
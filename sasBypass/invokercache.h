@@ -0,0 +1,203 @@
+/*
+	This file is part of sasBypass.
+
+	sasBypass is free software: you can redistribute it and/or modify
+	it under the terms of the Lesser GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	sasBypass is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with sasBypass.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef sasBypass__invokercache_h
+#define sasBypass__invokercache_h
+
+#include "config.h"
+#include <sasCore/defines.h>
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+
+namespace SAS {
+
+	// FNV-1a
+	inline uint64_t hashInput(const std::vector<char> & input)
+	{
+		uint64_t ret = 14695981039346656037ULL;
+		for (auto c : input)
+		{
+			ret ^= static_cast<unsigned char>(c);
+			ret *= 1099511628211ULL;
+		}
+		return ret;
+	}
+
+	// LRU list of the cached outputs, the entries expire after the TTL
+	class CacheShard
+	{
+		struct Entry
+		{
+			uint64_t hash;
+			std::vector<char> input; // the hash is verified by the input
+			std::vector<char> output;
+			std::chrono::steady_clock::time_point expires;
+
+			size_t size() const
+			{
+				return sizeof(Entry) + input.size() + output.size();
+			}
+		};
+
+	public:
+		CacheShard() : max_size(0), size(0), hits(0), misses(0), evictions(0)
+		{ }
+
+		void setMaxSize(size_t v)
+		{
+			max_size = v;
+		}
+
+		bool get(uint64_t hash, const std::vector<char> & input, std::vector<char> & output)
+		{
+			auto now = std::chrono::steady_clock::now();
+			std::unique_lock<std::mutex> __locker(mut);
+			auto it = index.find(hash);
+			if (it == index.end())
+			{
+				++misses;
+				return false;
+			}
+			if (it->second->expires <= now)
+			{
+				erase(it);
+				++misses;
+				return false;
+			}
+			if (it->second->input != input)
+			{
+				++misses;
+				return false;
+			}
+			lru.splice(lru.begin(), lru, it->second);
+			output = it->second->output;
+			++hits;
+			return true;
+		}
+
+		void put(uint64_t hash, const std::vector<char> & input, const std::vector<char> & output, std::chrono::steady_clock::time_point expires)
+		{
+			Entry e{ hash, input, output, expires };
+			if (e.size() > max_size)
+				return;
+
+			std::unique_lock<std::mutex> __locker(mut);
+			auto it = index.find(hash);
+			if (it != index.end())
+				erase(it);
+
+			size += e.size();
+			lru.push_front(std::move(e));
+			index[hash] = lru.begin();
+
+			while (size > max_size)
+			{
+				size -= lru.back().size();
+				index.erase(lru.back().hash);
+				lru.pop_back();
+				++evictions;
+			}
+		}
+
+		void stats(unsigned long long & hits_, unsigned long long & misses_, unsigned long long & evictions_, size_t & size_)
+		{
+			std::unique_lock<std::mutex> __locker(mut);
+			hits_ += hits;
+			misses_ += misses;
+			evictions_ += evictions;
+			size_ += size;
+		}
+
+	private:
+		void erase(std::unordered_map<uint64_t, std::list<Entry>::iterator>::iterator it)
+		{
+			size -= it->second->size();
+			lru.erase(it->second);
+			index.erase(it);
+		}
+
+		std::mutex mut;
+		std::list<Entry> lru; // the most recently used is the first one
+		std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+		size_t max_size;
+		size_t size; // bytes
+
+		unsigned long long hits, misses, evictions;
+	};
+
+	// outputs of one invoker, the shards are selected by the hash of the input
+	class InvokerCache
+	{
+		SAS_COPY_PROTECTOR(InvokerCache)
+	public:
+		// a shard gets at least 'min_shard_size' bytes, the number of the shards is reduced for small caches
+		static const size_t min_shard_size = 64 * 1024;
+
+		InvokerCache(size_t shard_num, size_t max_size, std::chrono::milliseconds ttl_) :
+			shards(std::max<size_t>(1, std::min(shard_num, max_size / min_shard_size))), ttl(ttl_)
+		{
+			for (auto & s : shards)
+				s.setMaxSize(max_size / shards.size());
+		}
+
+		size_t shardCount() const
+		{
+			return shards.size();
+		}
+
+		bool get(const std::vector<char> & input, std::vector<char> & output)
+		{
+			auto hash = hashInput(input);
+			return shard(hash).get(hash, input, output);
+		}
+
+		void put(const std::vector<char> & input, const std::vector<char> & output)
+		{
+			auto hash = hashInput(input);
+			shard(hash).put(hash, input, output, std::chrono::steady_clock::now() + ttl);
+		}
+
+		std::string stats()
+		{
+			unsigned long long hits(0), misses(0), evictions(0);
+			size_t size(0);
+			for (auto & s : shards)
+				s.stats(hits, misses, evictions, size);
+			return "hits: " + std::to_string(hits) + ", misses: " + std::to_string(misses) +
+				", evictions: " + std::to_string(evictions) + ", size: " + std::to_string(size);
+		}
+
+	private:
+		inline CacheShard & shard(uint64_t hash)
+		{
+			return shards[(hash >> 32) % shards.size()];
+		}
+
+		std::vector<CacheShard> shards;
+		std::chrono::milliseconds ttl;
+	};
+
+}
+
+#endif // sasBypass__invokercache_h
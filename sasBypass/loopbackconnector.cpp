@@ -21,6 +21,7 @@
 #include <sasCore/objectregistry.h>
 #include <sasCore/module.h>
 #include <sasCore/session.h>
+#include <sasCore/errorcodes.h>
 
 #include <mutex>
 
@@ -29,7 +30,7 @@ namespace SAS {
 	struct LoopbackConnection_priv
 	{
         LoopbackConnection_priv(Application * app_, Module * module_, const std::string & invoker_name_) :
-            app(app_), module(module_), invoker_name(invoker_name_), session_id(0)
+            app(app_), module(module_), invoker_name(invoker_name_), session_id(0), pinned(nullptr), pinned_id(0), invoker(nullptr)
 		{ }
 
         Application * app;
@@ -38,6 +39,35 @@ namespace SAS {
 
 		std::mutex session_id_mut;
 		SessionID session_id;
+
+		// the session is resolved once and pinned, the calls go directly to its invoker until the session ID changes
+		Session * pinned;
+		SessionID pinned_id;
+		Invoker * invoker;
+
+		// session_id_mut has to be locked
+		bool bind(ErrorCollector & ec)
+		{
+			// the session can be ended by another client, then a new one is created with the same ID
+			if (pinned && pinned_id == session_id && !pinned->isEnded())
+				return true;
+			unbind();
+			if (!(pinned = module->pinSession(session_id, ec)))
+				return false;
+			session_id = pinned_id = pinned->id();
+			return true;
+		}
+
+		// session_id_mut has to be locked
+		void unbind()
+		{
+			if (!pinned)
+				return;
+			module->unpinSession(pinned);
+			pinned = nullptr;
+			pinned_id = 0;
+			invoker = nullptr;
+		}
 	};
 
     LoopbackConnection::LoopbackConnection(Application * app, Module * module, const std::string & invoker_name) :
@@ -47,21 +77,24 @@ namespace SAS {
 
 	LoopbackConnection::~LoopbackConnection()
 	{
+		{
+			std::unique_lock<std::mutex> __locker(priv->session_id_mut);
+			priv->unbind();
+		}
 		delete priv;
 	}
 
 	Invoker::Status LoopbackConnection::invoke(const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec)
 	{
         return priv->app->callIfEnabled<Invoker::Status>([&]() {
-            SAS::Session * sess;
-            {
-                std::unique_lock<std::mutex> __locker(priv->session_id_mut);
-                if (!(sess = priv->module->getSession(priv->session_id, ec)))
-                    return Invoker::Status::Error;
-                priv->session_id = sess->id();
-            }
-            auto ret = sess->invoke(priv->invoker_name, input, output, ec);
-            sess->unlock();
+            std::unique_lock<std::mutex> __locker(priv->session_id_mut);
+            if (!priv->bind(ec))
+                return Invoker::Status::Error;
+            if (!priv->invoker && !(priv->invoker = priv->pinned->invoker(priv->invoker_name, ec)))
+                return Invoker::Status::FatalError;
+            priv->pinned->lock();
+            auto ret = priv->invoker->invoke(input, output, ec);
+            priv->pinned->unlock();
             return ret;
         }, Invoker::Status::Error);
 	}
@@ -70,15 +103,36 @@ namespace SAS {
 	{
         return priv->app->callIfEnabled<bool>([&]() {
             std::unique_lock<std::mutex> __locker(priv->session_id_mut);
-            Session * sess;
-            if (!(sess = priv->module->getSession(priv->session_id, ec)))
-                return false;
-            priv->session_id = sess->id();
-            sess->unlock();
-            return true;
+            return priv->bind(ec);
         }, false);
     }
 
+	bool LoopbackConnection::setSessionId(SessionID sid)
+	{
+		std::unique_lock<std::mutex> __locker(priv->session_id_mut);
+		priv->session_id = sid;
+		return true;
+	}
+
+	SessionID LoopbackConnection::sessionId() const
+	{
+		std::unique_lock<std::mutex> __locker(priv->session_id_mut);
+		return priv->session_id;
+	}
+
+	bool LoopbackConnection::endSession(ErrorCollector &)
+	{
+		std::unique_lock<std::mutex> __locker(priv->session_id_mut);
+		if (priv->session_id)
+		{
+			if (priv->pinned_id == priv->session_id)
+				priv->unbind();
+			priv->module->endSession(priv->session_id);
+			priv->session_id = 0;
+		}
+		return true;
+	}
+
 
 	struct LoopbackConnector_priv
 	{
@@ -115,6 +169,11 @@ namespace SAS {
             auto mod = priv->app->objectRegistry()->getObject<SAS::Module>(SAS_OBJECT_TYPE__MODULE, module_name, ec);
             if(!mod)
                 return false;
+            if(!mod->isReady())
+            {
+                ec.add(SAS_CORE__ERROR__MODULE__NOT_READY, "module '" + module_name + "' is not ready");
+                return false;
+            }
             description = mod->description();
             version = mod->version();
             return true;
@@ -123,10 +182,15 @@ namespace SAS {
 
 	Connection * LoopbackConnector::createConnection(const std::string & module_name, const std::string & invoker_name, ErrorCollector & ec)
 	{
-		auto mod = priv->app->objectRegistry()->getObject<SAS::Module>(SAS_OBJECT_TYPE__MODULE, module_name, ec);
+		auto mod = module(module_name, ec);
 		if(!mod)
 			return nullptr;
         return new LoopbackConnection(priv->app, mod, invoker_name);
 	}
 
+	Module * LoopbackConnector::module(const std::string & module_name, ErrorCollector & ec)
+	{
+		return priv->app->objectRegistry()->getObject<SAS::Module>(SAS_OBJECT_TYPE__MODULE, module_name, ec);
+	}
+
 }
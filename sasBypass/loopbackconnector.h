@@ -37,6 +37,10 @@ namespace SAS {
 
 		virtual bool getSession(ErrorCollector & ec) final;
 
+		virtual bool setSessionId(SessionID sid) final;
+		virtual SessionID sessionId() const final;
+		virtual bool endSession(ErrorCollector & ec) final;
+
 	private:
 		LoopbackConnection_priv * priv;
 	};
@@ -58,6 +62,9 @@ namespace SAS {
 
 		virtual Connection * createConnection(const std::string & module_name, const std::string & invoker_name, ErrorCollector & ec) final;
 
+		// the target module in this process, it can be called without connections
+		Module * module(const std::string & module_name, ErrorCollector & ec);
+
 	private:
 		LoopbackConnector_priv * priv;
 	};
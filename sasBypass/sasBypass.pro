@@ -17,11 +17,16 @@ LIBS += -L../sasCore -lsasCore
 SOURCES += \
     bp_component.cpp \
     bypassmodule.cpp \
+    cachingmodule.cpp \
     loopbackconnector.cpp \
     loopbackconnectorfactory.cpp
 
 HEADERS += \
     bypassmodule.h \
+    cachingmodule.h \
     config.h \
+    connectionpool.h \
+    invokercache.h \
     loopbackconnector.h \
-    loopbackconnectorfactory.h
+    loopbackconnectorfactory.h \
+    singleflight.h
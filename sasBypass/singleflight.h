@@ -0,0 +1,137 @@
+/*
+	This file is part of sasBypass.
+
+	sasBypass is free software: you can redistribute it and/or modify
+	it under the terms of the Lesser GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	sasBypass is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with sasBypass.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef sasBypass__singleflight_h
+#define sasBypass__singleflight_h
+
+#include "config.h"
+#include <sasCore/invoker.h>
+#include <sasCore/errorcollector.h>
+
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace SAS {
+
+	// concurrent calls with the same invoker and input share one call of the target, the followers get the result of the first one
+	class SingleFlight
+	{
+		SAS_COPY_PROTECTOR(SingleFlight)
+
+		struct Call
+		{
+			std::mutex mut;
+			std::condition_variable cv;
+			bool done = false;
+			Invoker::Status status = Invoker::Status::Error;
+			std::vector<char> output;
+			std::vector<std::pair<long, std::string>> errors;
+		};
+
+	public:
+		SingleFlight() : _coalesced(0)
+		{ }
+
+		void setInvokers(const std::vector<std::string> & invokers)
+		{
+			_invokers.clear();
+			_invokers.insert(invokers.begin(), invokers.end());
+		}
+
+		// calls of the invoker are coalesced (it is opt-in per invoker)
+		bool enabled(const std::string & invoker_name) const
+		{
+			return _invokers.count(invoker_name) > 0;
+		}
+
+		unsigned long long coalesced() const
+		{
+			return _coalesced;
+		}
+
+		// 'func(output, ec)' calls the target
+		template<typename Func>
+		Invoker::Status invoke(const std::string & invoker_name, const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec, Func func)
+		{
+			std::string key;
+			key.reserve(invoker_name.length() + 1 + input.size());
+			key.append(invoker_name).push_back('\0');
+			key.append(input.data(), input.size());
+
+			std::shared_ptr<Call> call;
+			bool leader = false;
+			{
+				std::unique_lock<std::mutex> __locker(_mut);
+				auto & c = _calls[key];
+				if (!c)
+				{
+					c = std::make_shared<Call>();
+					leader = true;
+				}
+				call = c;
+			}
+
+			if (!leader)
+			{
+				++_coalesced;
+				std::unique_lock<std::mutex> __locker(call->mut);
+				call->cv.wait(__locker, [&]() { return call->done; });
+				output = call->output;
+				for (auto & e : call->errors)
+					ec.add(e.first, e.second);
+				return call->status;
+			}
+
+			SimpleErrorCollector rec([&](long errorCode, const std::string & errorText)
+			{
+				call->errors.push_back(std::make_pair(errorCode, errorText));
+				ec.add(errorCode, errorText);
+			});
+			auto status = func(output, rec);
+
+			{
+				std::unique_lock<std::mutex> __locker(_mut);
+				_calls.erase(key);
+			}
+			{
+				std::unique_lock<std::mutex> __locker(call->mut);
+				call->status = status;
+				// nobody else can join after the erase, the output is copied only for waiting followers
+				if (call.use_count() > 1)
+					call->output = output;
+				call->done = true;
+			}
+			call->cv.notify_all();
+			return status;
+		}
+
+	private:
+		std::set<std::string> _invokers;
+		std::mutex _mut;
+		std::unordered_map<std::string, std::shared_ptr<Call>> _calls;
+		std::atomic<unsigned long long> _coalesced;
+	};
+
+}
+
+#endif // sasBypass__singleflight_h
@@ -25,9 +25,17 @@
 #include <sasCore/configreader.h>
 #include <sasCore/application.h>
 #include <sasCore/thread.h>
+#include <sasCore/notifier.h>
+#include <sasCore/threadpool.h>
+#include <sasCore/coalescer.h>
 
 #include <numeric>
 #include <mutex>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
 #include "tools.h"
 #include "generated/corbasas.hh"
 
@@ -42,227 +50,396 @@ namespace SAS {
 		inline CorbaConnector_internal(CorbaConnector * obj_) : obj(obj_)
 		{ }
 
-		bool reconnect(CorbaSAS::SASModule_ptr & corba_sas_module, ErrorCollector &ec);
+		// fails fast while the circuit breaker is not closed
+		bool available(ErrorCollector & ec);
+
+		// one attempt without waiting, if it fails the circuit breaker is opened and the reconnector thread takes over
+		bool reconnect(ErrorCollector & ec);
+
+		// the current server object, it is replaced by the reconnections
+		CorbaSAS::SASModule_var module();
+
+		// the object of the module on the server, it is requested once per connection; the server object is returned
+		// if the server does not provide objects per module
+		CorbaSAS::SASModule_var module(const std::string & module_name);
+
+		// calls 'func(module)' with the object of 'module_name' (or the server object if it is empty),
+		// on a CORBA system exception it reconnects and retries, at most MAX_RECONNECT_MAX_RECALL times
+		template<typename Func>
+		bool call(const std::string & module_name, Func func, ErrorCollector & ec);
 
 	private:
 		CorbaConnector * obj;
 	};
 
+	// the exceptions raised by the server are mapped to the status of the invoker
+	template<typename Func>
+	static Invoker::Status call_server(CorbaConnector_internal & internal, const std::string & module_name, Logging::LoggerPtr logger, Func func, ErrorCollector & ec)
+	{
+		Invoker::Status status = Invoker::Status::OK;
+		if (!internal.call(module_name, [&](CorbaSAS::SASModule_ptr module)
+			{
+				try
+				{
+					func(module);
+				}
+				catch (CorbaSAS::ErrorHandling::ErrorException & ex)
+				{
+					auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__SERVER__ERROR, "Caught a CorbaSAS::ErrorHandling::ErrorException");
+					SAS_LOG_DEBUG(logger, err);
+					CorbaTools::logException(logger, ex, ec);
+					status = Invoker::Status::Error;
+				}
+				catch (CorbaSAS::ErrorHandling::FatalErrorException & ex)
+				{
+					auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__SERVER__FATAL_ERROR, "Caught a CorbaSAS::ErrorHandling::FatalErrorException");
+					SAS_LOG_DEBUG(logger, err);
+					CorbaTools::logException(logger, ex, ec);
+					status = Invoker::Status::FatalError;
+				}
+				catch (CorbaSAS::ErrorHandling::NotImplementedException & ex)
+				{
+					auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__SERVER__NOT_IMPLEMENTED, "Caught a CorbaSAS::ErrorHandling::NotImplementedException");
+					SAS_LOG_DEBUG(logger, err);
+					CorbaTools::logException(logger, ex, ec);
+					status = Invoker::Status::NotImplemented;
+				}
+				catch (CORBA::COMM_FAILURE & ex)
+				{
+					auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__COMMUNICATION_FAILURE, "Caught a CORBA::COMM_FAILURE");
+					SAS_LOG_DEBUG(logger, err);
+					CorbaTools::logException(logger, ex);
+					status = Invoker::Status::Error;
+				}
+			}, ec))
+			return Invoker::Status::FatalError;
+		return status;
+	}
 
-	class CorbaConnection :public Connection
+	static void toRequestSequence(const std::vector<const CorbaRequest *> & requests, CorbaSAS::SASModule::RequestSequence & ret)
+	{
+		ret.length(static_cast<CORBA::ULong>(requests.size()));
+		for (CORBA::ULong i(0), l(ret.length()); i < l; ++i)
+		{
+			auto & req = *requests[i];
+			ret[i].session_id = req.sid;
+			ret[i].module_name = req.module.c_str();
+			ret[i].invoker = req.invoker.c_str();
+			if (req.input)
+				CorbaTools::wrapOctetSequence(*req.input, ret[i].in_msg);
+		}
+	}
+
+	static void fromResponseSequence(const CorbaSAS::SASModule::ResponseSequence & responses, std::vector<CorbaResponse> & ret)
+	{
+		ret.resize(responses.length());
+		for (CORBA::ULong i(0), l(responses.length()); i < l; ++i)
+		{
+			auto & resp = responses[i];
+			ret[i].sid = resp.session_id;
+			ret[i].status = resp.status >= 0 && resp.status <= static_cast<CORBA::Long>(Invoker::Status::NotImplemented) ?
+				static_cast<Invoker::Status>(resp.status) : Invoker::Status::FatalError;
+			ret[i].errors.clear();
+			for (CORBA::ULong j(0), m(resp.err.length()); j < m; ++j)
+				ret[i].errors.push_back(std::make_pair(static_cast<long>(resp.err[j].error_code), std::string(resp.err[j].error_text.in())));
+			CorbaTools::toByteArray(resp.out_msg, ret[i].output);
+		}
+	}
+
+	// receives the responses of 'invokeAsync' calls
+	class CorbaResponseHandler_impl : public POA_CorbaSAS::ResponseHandler
 	{
 	public:
-		CorbaConnection(CorbaConnector * conn_, long maxReconnectRecursion_, const std::string & module, const std::string & invoker, Application * app, const CorbaSAS::SASModule_ptr & corba_sas_module) :
-			conn(conn_), maxReconnectRecursion(maxReconnectRecursion_), _module(module), _invoker(invoker), _sessionId(0),
-			_corba_sas_module(corba_sas_module), _app(app), _logger(Logging::getLogger("SAS.CorbaConnection." + module + "." + invoker))
+		typedef std::function<void(std::vector<CorbaResponse> & responses)> Handler;
+
+		CorbaResponseHandler_impl(const std::string & name) :
+			_logger(Logging::getLogger("SAS.CorbaResponseHandler." + name)), _seq(0)
 		{ }
 
-		virtual ~CorbaConnection()
+		CORBA::LongLong add(size_t request_count, Handler handler)
 		{
-			SAS_LOG_NDC();
-			try
-			{
-				_corba_sas_module->endSession(CORBA::string_dup(_module.c_str()), _sessionId);
-			}
-			catch(...)
-			{
-				SAS_LOG_WARN(_logger, "Caught an unknown exception.");
-			}
+			std::unique_lock<std::mutex> __locker(_mut);
+			auto call_id = ++_seq;
+			_calls[call_id] = std::make_pair(request_count, std::move(handler));
+			return call_id;
 		}
 
-		virtual bool getSession(ErrorCollector & ec) final
+		void remove(CORBA::LongLong call_id)
 		{
-			SAS_LOG_NDC();
-			long recusiv_counter(0);
-			return getSession_recursive(recusiv_counter, ec);
+			std::unique_lock<std::mutex> __locker(_mut);
+			_calls.erase(call_id);
 		}
 
-		virtual Status invoke(const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec) final
+		// completes the pending calls with an error
+		void abort(const std::string & reason)
 		{
-			SAS_LOG_NDC();
-			long recusiv_counter(0);
-			return invoke_recursive(recusiv_counter, input, output, ec);
+			std::map<CORBA::LongLong, std::pair<size_t, Handler>> calls;
+			{
+				std::unique_lock<std::mutex> __locker(_mut);
+				calls.swap(_calls);
+			}
+			for (auto & c : calls)
+			{
+				std::vector<CorbaResponse> responses(c.second.first);
+				for (auto & r : responses)
+				{
+					r.status = Invoker::Status::FatalError;
+					r.errors.push_back(std::make_pair(static_cast<long>(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR), reason));
+				}
+				c.second.second(responses);
+			}
 		}
 
-	private:
-
-		bool getSession_recursive(long & recursive_counter, ErrorCollector & ec)
+		virtual void responses(CORBA::LongLong call_id, const CorbaSAS::SASModule::ResponseSequence & responses) final
 		{
 			SAS_LOG_NDC();
-			if (recursive_counter >= maxReconnectRecursion)
+			Handler handler;
 			{
-				SAS_LOG_INFO(_logger, "'recursive_coiunter' reached the maximum number '10'");
-				return false;
+				std::unique_lock<std::mutex> __locker(_mut);
+				auto it = _calls.find(call_id);
+				if (it == _calls.end())
+				{
+					SAS_LOG_DEBUG(_logger, "responses without a pending call (late or duplicated): " + std::to_string(call_id));
+					return;
+				}
+				handler = std::move(it->second.second);
+				_calls.erase(it);
 			}
 
+			std::vector<CorbaResponse> ret;
+			fromResponseSequence(responses, ret);
 			try
 			{
-				_corba_sas_module->getSession(_sessionId, CORBA::string_dup(_module.c_str()));
-			}
-			catch (CorbaSAS::ErrorHandling::ErrorException & ex)
-			{
-				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__SERVER__ERROR, "Caught a CorbaSAS::ErrorHandling::ErrorException");
-				SAS_LOG_DEBUG(_logger, err);
-				CorbaTools::logException(_logger, ex, ec);
-				return false;
+				handler(ret);
 			}
-			catch (CorbaSAS::ErrorHandling::FatalErrorException & ex)
-			{
-				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__SERVER__FATAL_ERROR, "Caught a CorbaSAS::ErrorHandling::FatalErrorException");
-				SAS_LOG_DEBUG(_logger, err);
-				CorbaTools::logException(_logger, ex, ec);
-				return false;
-			}
-			catch (CorbaSAS::ErrorHandling::NotImplementedException & ex)
-			{
-				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__SERVER__NOT_IMPLEMENTED, "Caught a CorbaSAS::ErrorHandling::NotImplementedException");
-				SAS_LOG_DEBUG(_logger, err);
-				CorbaTools::logException(_logger, ex, ec);
-				return false;
-			}
-			catch (CORBA::COMM_FAILURE & ex)
+			catch (...)
 			{
-				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__COMMUNICATION_FAILURE, "Caught a CORBA::COMM_FAILURE");
-				SAS_LOG_DEBUG(_logger, err);
-				CorbaTools::logException(_logger, ex);
-				return false;
+				SAS_LOG_ERROR(_logger, "response handler of call '" + std::to_string(call_id) + "' has thrown an exception");
 			}
-			catch (CORBA::SystemException & ex)
-			{
-				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "Caught a CORBA::SystemException.");
-				SAS_LOG_ERROR(_logger, err);
-				CorbaTools::logException(_logger, ex);
+		}
 
-				SAS_LOG_INFO(_logger, "client may lost the connection. try to reconnect");
-				if (conn->internal().reconnect(_corba_sas_module, ec))
-					return getSession_recursive(++recursive_counter, ec);
+	private:
+		Logging::LoggerPtr _logger;
+		std::mutex _mut;
+		CORBA::LongLong _seq;
+		std::map<CORBA::LongLong, std::pair<size_t, Handler>> _calls;
+	};
 
-				return false;
-			}
-			catch (CORBA::Exception & ex)
-			{
-				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "Caught a CORBA::Exception.");
-				SAS_LOG_ERROR(_logger, err);
-				CorbaTools::logException(_logger, ex);
-				return false;
-			}
-			catch (omniORB::fatalException & ex)
-			{
-				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "Caught omniORB::fatalException");
-				SAS_LOG_FATAL(_logger, err);
-				CorbaTools::logException(_logger, ex);
-				return false;
-			}
-			catch (...)
-			{
-				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "Caught an unknown exception.");
-				SAS_LOG_FATAL(_logger, err);
-				return false;
-			}
+	struct CorbaBatchOptions
+	{
+		bool batch = false;
+		std::chrono::microseconds batchDelay = std::chrono::microseconds(0);
+		size_t batchMaxSize = 64;
+	};
+
+	// coalesces the invocations of concurrent callers into 'invokeMany' calls
+	typedef Coalescer<CorbaRequest, CorbaResponse> CorbaBatcher;
 
+
+	class CorbaConnection :public Connection
+	{
+	public:
+		CorbaConnection(CorbaConnector * conn_, const std::string & module, const std::string & invoker, Application * app, CorbaBatcher * batcher) :
+			conn(conn_), _module(module), _invoker(invoker), _sessionId(0),
+			_app(app), _logger(Logging::getLogger("SAS.CorbaConnection." + module + "." + invoker)),
+			_batcher(batcher)
+		{ }
+
+		virtual ~CorbaConnection()
+		{
+			SAS_LOG_NDC();
+			NullEC ec;
+			endSession(ec);
+		}
+
+		virtual bool setSessionId(SessionID sid) final
+		{
+			_sessionId = sid;
 			return true;
 		}
 
-		Status invoke_recursive(long & recursive_counter, const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec)
+		virtual SessionID sessionId() const final
 		{
-			SAS_LOG_NDC();
-			if (recursive_counter >= maxReconnectRecursion)
-			{
-				SAS_LOG_INFO(_logger, "'recursive_coiunter' reached the maximum number '10'");
-				return Status::FatalError;
-			}
+			return _sessionId;
+		}
 
+		virtual bool endSession(ErrorCollector & ec) final
+		{
+			SAS_LOG_NDC();
+			if (!_sessionId)
+				return true;
+			if (!conn->internal().available(ec))
+				return false;
 			try
 			{
-				CorbaSAS::SASModule::OctetSequence_var out;
-				_corba_sas_module->invoke(_sessionId,
-					CORBA::string_dup(_module.c_str()),
-					CORBA::string_dup(_invoker.c_str()),
-					CorbaTools::toOctetSequence_var(input), out);
-				output = CorbaTools::toByteArray(out);
-			}
-			catch (CorbaSAS::ErrorHandling::ErrorException & ex)
-			{
-				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__SERVER__ERROR, "Caught a CorbaSAS::ErrorHandling::ErrorException");
-				SAS_LOG_DEBUG(_logger, err);
-				CorbaTools::logException(_logger, ex, ec);
-				return Status::Error;
+				conn->internal().module(_module)->endSession(_module.c_str(), _sessionId);
 			}
-			catch (CorbaSAS::ErrorHandling::FatalErrorException & ex)
-			{
-				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__SERVER__FATAL_ERROR, "Caught a CorbaSAS::ErrorHandling::FatalErrorException");
-				SAS_LOG_DEBUG(_logger, err);
-				CorbaTools::logException(_logger, ex, ec);
-				return Status::FatalError;
-			}
-			catch (CorbaSAS::ErrorHandling::NotImplementedException & ex)
-			{
-				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__SERVER__NOT_IMPLEMENTED, "Caught a CorbaSAS::ErrorHandling::NotImplementedException");
-				SAS_LOG_DEBUG(_logger, err);
-				CorbaTools::logException(_logger, ex, ec);
-				return Status::NotImplemented;
-			}
-			catch (CORBA::COMM_FAILURE & ex)
+			catch(...)
 			{
-				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__COMMUNICATION_FAILURE, "Caught a CORBA::COMM_FAILURE while using the naming service.");
-				SAS_LOG_DEBUG(_logger, err);
-				CorbaTools::logException(_logger, ex);
-				return Status::Error;
+				SAS_LOG_WARN(_logger, "Caught an unknown exception.");
+				return false;
 			}
-			catch (CORBA::SystemException & ex)
+			_sessionId = 0;
+			return true;
+		}
+
+		virtual bool getSession(ErrorCollector & ec) final
+		{
+			SAS_LOG_NDC();
+			return call_server(conn->internal(), _module, _logger, [this](CorbaSAS::SASModule_ptr module)
 			{
-				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "Caught a CORBA::SystemException.");
-				SAS_LOG_ERROR(_logger, err);
-				CorbaTools::logException(_logger, ex);
+				module->getSession(_sessionId, _module.c_str());
+			}, ec) == Status::OK;
+		}
 
-				SAS_LOG_INFO(_logger, "client may lost the connection. try to reconnect");
-				if (conn->internal().reconnect(_corba_sas_module, ec))
-					return invoke_recursive(++recursive_counter, input, output, ec);
+		virtual Status invoke(const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec) final
+		{
+			SAS_LOG_NDC();
 
-				return Status::FatalError;
-			}
-			catch (CORBA::Exception & ex)
+			if (_batcher)
 			{
-				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "Caught a CORBA::Exception.");
-				SAS_LOG_ERROR(_logger, err);
-				CorbaTools::logException(_logger, ex);
-				return Status::FatalError;
-			}
-			catch (omniORB::fatalException & ex)
-			{
-				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "Caught omniORB::fatalException");
-				SAS_LOG_FATAL(_logger, err);
-				CorbaTools::logException(_logger, ex);
-				return Status::FatalError;
-			}
-			catch (...)
-			{
-				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "Caught an unknown exception.");
-				SAS_LOG_FATAL(_logger, err);
-				return Status::FatalError;
+				CorbaRequest request;
+				request.module = _module;
+				request.sid = _sessionId;
+				request.invoker = _invoker;
+				request.input = &input;
+
+				CorbaResponse response;
+				if (!_batcher->invoke(request, response, ec))
+					return Status::Error;
+
+				_sessionId = response.sid;
+				output = std::move(response.output);
+				for (auto & e : response.errors)
+					ec.add(e.first, e.second);
+				return response.status;
 			}
 
-			return Status::OK;
+			return call_server(conn->internal(), _module, _logger, [&](CorbaSAS::SASModule_ptr module)
+			{
+				CorbaSAS::SASModule::OctetSequence in;
+				CorbaTools::wrapOctetSequence(input, in);
+				CorbaSAS::SASModule::OctetSequence_var out;
+				module->invoke(_sessionId, _module.c_str(), _invoker.c_str(), in, out);
+				CorbaTools::toByteArray(out.in(), output);
+			}, ec);
 		}
 
-
+	private:
 		CorbaConnector * conn;
-		long maxReconnectRecursion;
 		std::string _module, _invoker;
 		CORBA::LongLong _sessionId;
-		CorbaSAS::SASModule_ptr _corba_sas_module;
 		Application * _app;
 		Logging::LoggerPtr _logger;
+		CorbaBatcher * _batcher;
+	};
+
+	struct CorbaConnector_priv;
+
+	// reconnects in the background while the circuit breaker is open
+	// the delay between the attempts starts from RECONNECT_DELAY and doubles up to RECONNECT_MAX_DELAY
+	class CorbaReconnector : public Thread
+	{
+	public:
+		CorbaReconnector(ThreadPool * pool, CorbaConnector * connector, CorbaConnector_priv * priv) : Thread(pool),
+			_connector(connector), _priv(priv)
+		{ }
+
+		virtual void stop() override
+		{
+			Thread::stop();
+			_wake.notify();
+		}
+
+		void wake()
+		{
+			_wake.notify();
+		}
+
+	protected:
+		virtual void execute() override;
+
+	private:
+		bool attempt();
+
+		CorbaConnector * _connector;
+		CorbaConnector_priv * _priv;
+		Notifier _wake;
 	};
 
 	struct CorbaConnector_priv
 	{
 		CorbaConnector_priv(CorbaConnector * obj_, const std::string & name_, Application * app_)
 			: app(app_), logger(Logging::getLogger("SAS.CorbaConnector." + name_)), name(name_), connectionActive(false), 
-			  reconnectSleep(0), maxReconnectNum(0), maxReconnectRecall(0),
+			  reconnectSleep(0), maxReconnectNum(0), maxReconnectRecall(0), reconnectMaxDelay(0),
+			  breaker(Breaker::Closed), reconnectBackoff(0),
 			  internal(obj_)
 		{ }
 
+		~CorbaConnector_priv()
+		{
+			if (reconnector)
+			{
+				reconnector->stop();
+				reconnector->wait();
+			}
+			if (response_handler.in())
+			{
+				try
+				{
+					poa->deactivate_object(response_handler_id.in());
+				}
+				catch (...)
+				{
+					SAS_LOG_WARN(logger, "could not deactivate response handler");
+				}
+				response_handler->abort("connector is destroyed");
+			}
+		}
+
+		bool activateResponseHandler(ErrorCollector & ec)
+		{
+			SAS_LOG_NDC();
+			try
+			{
+				CORBA::Object_var poa_obj = orb->resolve_initial_references("RootPOA");
+				PortableServer::POA_var root_poa = PortableServer::POA::_narrow(poa_obj);
+				PortableServer::Servant_var<CorbaResponseHandler_impl> handler = new CorbaResponseHandler_impl(name);
+				PortableServer::ObjectId_var handler_id = root_poa->activate_object(handler.in());
+				CORBA::Object_var handler_obj = root_poa->id_to_reference(handler_id.in());
+				response_handler_ref = CorbaSAS::ResponseHandler::_narrow(handler_obj);
+
+				// the responses are received only if the POA is active, also in a client-only process
+				PortableServer::POAManager_var pman = root_poa->the_POAManager();
+				pman->activate();
+
+				poa = root_poa;
+				response_handler_id = handler_id;
+				response_handler = handler;
+			}
+			catch (CORBA::Exception & ex)
+			{
+				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "could not activate response handler: caught CORBA::Exception.");
+				SAS_LOG_ERROR(logger, err);
+				CorbaTools::logException(logger, ex);
+				return false;
+			}
+			catch (omniORB::fatalException & ex)
+			{
+				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "could not activate response handler: caught omniORB::fatalException");
+				SAS_LOG_FATAL(logger, err);
+				CorbaTools::logException(logger, ex);
+				return false;
+			}
+			catch (...)
+			{
+				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "could not activate response handler: caught an unknown exception");
+				SAS_LOG_FATAL(logger, err);
+				return false;
+			}
+			return true;
+		}
+
 		Application * app;
 		Logging::LoggerPtr logger;
 		std::string name;
@@ -278,7 +455,9 @@ namespace SAS {
 
 		CORBA::ORB_var orb;
 		CORBA::Object_var obj;
-		CorbaSAS::SASModule_ptr corba_sas_module;
+		std::mutex mut_module;
+		CorbaSAS::SASModule_var corba_sas_module;
+		std::map<std::string, CorbaSAS::SASModule_var> module_objects; // cleared when the server object is replaced
 
 		std::mutex mut_reconnect;
 		bool connectionActive;
@@ -286,20 +465,163 @@ namespace SAS {
 		long reconnectSleep;
 		long maxReconnectNum;
 		long maxReconnectRecall;
+		long reconnectMaxDelay;
+
+		// Closed: calls are passed, Open: calls fail fast until the reconnector restores the connection,
+		// HalfOpen: the reconnector probes the server
+		enum class Breaker { Closed, Open, HalfOpen };
+		std::atomic<Breaker> breaker;
+		std::atomic<long> reconnectBackoff; // milliseconds
+		std::unique_ptr<CorbaReconnector> reconnector;
+
+		// the background attempts are at least a second apart, RECONNECT_DELAY = 0 would make the reconnector spin
+		long boundedBackoff(long backoff) const
+		{
+			return std::max(std::min(backoff, reconnectMaxDelay), 1000L);
+		}
+
+		void trip()
+		{
+			auto expected = Breaker::Closed;
+			if (breaker.compare_exchange_strong(expected, Breaker::Open))
+			{
+				SAS_LOG_WARN(logger, "circuit breaker is opened, calls fail fast until the connection is restored");
+				reconnectBackoff = boundedBackoff(reconnectSleep);
+				if (reconnector)
+					reconnector->wake();
+			}
+		}
+
+		CorbaBatchOptions batchOptions;
+		std::unique_ptr<CorbaBatcher> batcher;
+
+		std::mutex mut_async;
+		PortableServer::POA_var poa;
+		PortableServer::Servant_var<CorbaResponseHandler_impl> response_handler;
+		PortableServer::ObjectId_var response_handler_id;
+		CorbaSAS::ResponseHandler_var response_handler_ref;
 
 		CorbaConnector_internal internal;
 	};
 
-	CorbaConnector::CorbaConnector(const std::string & name, Application * app)
-		: Connector(), priv(new CorbaConnector_priv(this, name, app))
-	{ }
+	template<typename Func>
+	bool CorbaConnector_internal::call(const std::string & module_name, Func func, ErrorCollector & ec)
+	{
+		SAS_LOG_NDC();
+		auto priv = obj->priv;
+		for (long attempt(0); ; ++attempt)
+		{
+			if (!available(ec))
+				return false;
+			try
+			{
+				func(module_name.length() ? module(module_name).in() : module().in());
+				return true;
+			}
+			catch (CORBA::COMM_FAILURE & ex)
+			{
+				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__COMMUNICATION_FAILURE, "Caught a CORBA::COMM_FAILURE");
+				SAS_LOG_DEBUG(priv->logger, err);
+				CorbaTools::logException(priv->logger, ex);
+				return false;
+			}
+			catch (CORBA::SystemException & ex)
+			{
+				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "Caught a CORBA::SystemException.");
+				SAS_LOG_ERROR(priv->logger, err);
+				CorbaTools::logException(priv->logger, ex);
+
+				if (attempt + 1 >= priv->maxReconnectRecall)
+				{
+					SAS_LOG_INFO(priv->logger, "number of reconnections reached the maximum '" + std::to_string(priv->maxReconnectRecall) + "'");
+					return false;
+				}
+				SAS_LOG_INFO(priv->logger, "client may lost the connection. try to reconnect");
+				if (!reconnect(ec))
+					return false;
+			}
+			catch (CORBA::Exception & ex)
+			{
+				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "Caught a CORBA::Exception.");
+				SAS_LOG_ERROR(priv->logger, err);
+				CorbaTools::logException(priv->logger, ex);
+				return false;
+			}
+			catch (omniORB::fatalException & ex)
+			{
+				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "Caught omniORB::fatalException");
+				SAS_LOG_FATAL(priv->logger, err);
+				CorbaTools::logException(priv->logger, ex);
+				return false;
+			}
+			catch (...)
+			{
+				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "Caught an unknown exception.");
+				SAS_LOG_FATAL(priv->logger, err);
+				return false;
+			}
+		}
+	}
+
+	void CorbaReconnector::execute()
+	{
+		SAS_LOG_NDC();
+		while (status() != Status::Stopped)
+		{
+			if (_priv->breaker == CorbaConnector_priv::Breaker::Closed)
+			{
+				_wake.wait();
+				continue;
+			}
+
+			long backoff = _priv->reconnectBackoff;
+			SAS_LOG_TRACE(_priv->logger, "wait for '" + std::to_string(backoff) + "' milliseconds");
+			_wake.wait(backoff);
+			if (status() == Status::Stopped)
+				break;
 
-	CorbaConnector::~CorbaConnector()
-	{ delete priv; }
+			_priv->breaker = CorbaConnector_priv::Breaker::HalfOpen;
+			if (attempt())
+			{
+				_priv->breaker = CorbaConnector_priv::Breaker::Closed;
+				SAS_LOG_INFO(_priv->logger, "connection is restored, circuit breaker is closed");
+			}
+			else
+			{
+				_priv->reconnectBackoff = _priv->boundedBackoff(backoff * 2);
+				_priv->breaker = CorbaConnector_priv::Breaker::Open;
+				SAS_LOG_INFO(_priv->logger, "could not restore the connection, next attempt in '" + std::to_string(_priv->reconnectBackoff) + "' milliseconds");
+			}
+		}
+	}
 
-	std::string CorbaConnector::name() const
+	bool CorbaReconnector::attempt()
 	{
-		return priv->name;
+		SAS_LOG_NDC();
+		NullEC ec;
+		std::unique_lock<std::mutex> __locker(_priv->mut_reconnect);
+		_priv->connectionActive = false;
+		if (!_connector->connect(ec))
+			return false;
+
+		// the reference can be created without reaching the server
+		try
+		{
+			if (!_connector->internal().module()->_non_existent())
+				return true;
+			SAS_LOG_WARN(_priv->logger, "server object does not exist");
+		}
+		catch (CORBA::Exception & ex)
+		{
+			SAS_LOG_DEBUG(_priv->logger, "server is not reachable");
+			CorbaTools::logException(_priv->logger, ex);
+		}
+		catch (...)
+		{
+			SAS_LOG_DEBUG(_priv->logger, "server is not reachable: unknown exception");
+		}
+		_priv->connectionActive = false;
+		return false;
 	}
 
 	CORBA::Object_ptr getObjectReference(const std::string & service_name, const std::string & interface_name, CORBA::ORB_ptr orb, Logging::LoggerPtr logger, ErrorCollector & ec)
@@ -555,7 +877,7 @@ namespace SAS {
 		else if (tmp_ll == 0)
 		{
 			SAS_LOG_WARN(priv->logger, "no recall is set for reconnect feature (MAX_RECONNECT_MAX_RECALL = 0)");
-			priv->reconnectSleep = 0;
+			priv->maxReconnectRecall = 0;
 		}
 		else
 			priv->maxReconnectRecall = (long)tmp_ll;
@@ -575,31 +897,123 @@ namespace SAS {
 		else
 			priv->reconnectSleep = (long)tmp_ll * 1000;
 
+		if (!priv->app->configReader()->getNumberEntry(config_path + "/RECONNECT_MAX_DELAY", tmp_ll, 60, ec))
+			return false;
+		priv->reconnectMaxDelay = std::max((long)tmp_ll * 1000, priv->reconnectSleep);
+
+		if (!priv->app->configReader()->getBoolEntry(config_path + "/BATCH", priv->batchOptions.batch, false, ec))
+			return false;
+		if (!priv->app->configReader()->getNumberEntry(config_path + "/BATCH_DELAY", tmp_ll, 0, ec))
+			return false;
+		priv->batchOptions.batchDelay = std::chrono::microseconds(tmp_ll > 0 ? tmp_ll : 0);
+		if (!priv->app->configReader()->getNumberEntry(config_path + "/BATCH_MAX_SIZE", tmp_ll, 64, ec))
+			return false;
+		if (tmp_ll <= 0)
+		{
+			auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__INVALID_CONNECTION_DATA, "invalid value of 'BATCH_MAX_SIZE': '" + std::to_string(tmp_ll) + "'");
+			SAS_LOG_ERROR(priv->logger, err);
+			return false;
+		}
+		priv->batchOptions.batchMaxSize = static_cast<size_t>(tmp_ll);
+		if (priv->batchOptions.batch)
+			priv->batcher.reset(new CorbaBatcher(Logging::getLogger("SAS.CorbaBatcher." + priv->name),
+				[this](const std::vector<const CorbaRequest *> & requests, std::vector<CorbaResponse> & responses, ErrorCollector & ec)
+				{
+					return invokeMany(requests, responses, ec);
+				}, priv->batchOptions.batchDelay, priv->batchOptions.batchMaxSize));
+
 		priv->orb = orb;
 
+		if (priv->maxReconnectNum)
+		{
+			priv->reconnector.reset(new CorbaReconnector(priv->app->threadPool(), this, priv));
+			if (!priv->reconnector->start())
+			{
+				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "could not start reconnector thread");
+				SAS_LOG_ERROR(priv->logger, err);
+				return false;
+			}
+		}
+
 		return true;
 	}
 
-	bool CorbaConnector_internal::reconnect(CorbaSAS::SASModule_ptr & corba_sas_module, ErrorCollector &ec)
+	bool CorbaConnector_internal::available(ErrorCollector & ec)
+	{
+		if (obj->priv->breaker == CorbaConnector_priv::Breaker::Closed)
+			return true;
+		auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__CANNOT_CONNECT, "connection to the server is lost, circuit breaker of '" + obj->priv->name + "' is open");
+		SAS_LOG_DEBUG(obj->priv->logger, err);
+		return false;
+	}
+
+	bool CorbaConnector_internal::reconnect(ErrorCollector & ec)
 	{
 		SAS_LOG_NDC();
-		std::unique_lock<std::mutex> __locker(obj->priv->mut_reconnect);
+		if (!obj->priv->maxReconnectNum)
+			return false;
+
+		// only one caller tries, the others fail fast instead of waiting for it
+		std::unique_lock<std::mutex> __locker(obj->priv->mut_reconnect, std::try_to_lock);
+		if (!__locker.owns_lock())
+		{
+			auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__CANNOT_CONNECT, "reconnection is in progress");
+			SAS_LOG_DEBUG(obj->priv->logger, err);
+			return false;
+		}
+		if (!available(ec))
+			return false;
+
 		obj->priv->connectionActive = false;
+		if (obj->connect(ec))
+			return true;
+
+		obj->priv->trip();
+		return false;
+	}
 
-		for (int i(0); i < obj->priv->maxReconnectNum; ++i)
+	CorbaSAS::SASModule_var CorbaConnector_internal::module()
+	{
+		std::unique_lock<std::mutex> __locker(obj->priv->mut_module);
+		return CorbaSAS::SASModule::_duplicate(obj->priv->corba_sas_module.in());
+	}
+
+	CorbaSAS::SASModule_var CorbaConnector_internal::module(const std::string & module_name)
+	{
+		auto priv = obj->priv;
+		CorbaSAS::SASModule_var root;
 		{
-			SAS_LOG_INFO(obj->priv->logger, "attempt #" + std::to_string(i+1));
-			if (obj->connect(ec))
-			{
-				corba_sas_module = obj->priv->corba_sas_module;
-				return true;
-			}
+			std::unique_lock<std::mutex> __locker(priv->mut_module);
+			auto it = priv->module_objects.find(module_name);
+			if (it != priv->module_objects.end())
+				return CorbaSAS::SASModule::_duplicate(it->second.in());
+			root = CorbaSAS::SASModule::_duplicate(priv->corba_sas_module.in());
+		}
 
-			SAS_LOG_TRACE(obj->priv->logger, "wait for '" + std::to_string(obj->priv->reconnectSleep) + "' milliseconds");
-			Thread::sleep(obj->priv->reconnectSleep);
+		CorbaSAS::SASModule_var ret;
+		try
+		{
+			ret = root->getModuleObject(module_name.c_str());
 		}
-		SAS_LOG_INFO(obj->priv->logger, "was not possible to connect to the server");
-		return false;
+		catch (CORBA::BAD_OPERATION &)
+		{
+			SAS_LOG_DEBUG(priv->logger, "server does not provide objects per module, the server object is used for module '" + module_name + "'");
+			ret = CorbaSAS::SASModule::_duplicate(root.in());
+		}
+		catch (CorbaSAS::ErrorHandling::ErrorException &)
+		{
+			// the module is not found, the error is reported by the call itself
+			return root;
+		}
+
+		std::unique_lock<std::mutex> __locker(priv->mut_module);
+		// the server object could have been replaced meanwhile
+		if (priv->corba_sas_module.in() != root.in())
+			return ret;
+		auto & cached = priv->module_objects[module_name];
+		if (CORBA::is_nil(cached))
+			cached = CorbaSAS::SASModule::_duplicate(ret.in());
+		return CorbaSAS::SASModule::_duplicate(cached.in());
 	}
 
 	bool CorbaConnector::connect(ErrorCollector & ec)
@@ -636,12 +1050,16 @@ namespace SAS {
 
 		try
 		{
-			if(CORBA::is_nil(priv->corba_sas_module = CorbaSAS::SASModule::_narrow(priv->obj)))
+			CorbaSAS::SASModule_var corba_sas_module = CorbaSAS::SASModule::_narrow(priv->obj);
+			if(CORBA::is_nil(corba_sas_module))
 			{
 				auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__CANNOT_CONNECT, "could not connect to corba server");
 				SAS_LOG_ERROR(priv->logger, err);
 				return false;
 			}
+			std::unique_lock<std::mutex> __locker(priv->mut_module);
+			priv->corba_sas_module = corba_sas_module._retn();
+			priv->module_objects.clear();
 		}
 		catch(CORBA::COMM_FAILURE & ex)
 		{
@@ -681,99 +1099,79 @@ namespace SAS {
 		return true;
 	}
 
-	bool CorbaConnector::getModuleInfo(const std::string & moduleName, std::string & description, std::string & version, ErrorCollector & ec)
+	bool CorbaConnector::isReady() const
 	{
-		SAS_LOG_NDC();
-		long recusiv_counter(0);
-		return getModuleInfo_recursive(recusiv_counter, moduleName, description, version, ec);
+		return priv->connectionActive && priv->breaker == CorbaConnector_priv::Breaker::Closed;
 	}
 
-	bool CorbaConnector::getModuleInfo_recursive(long & recursive_counter, const std::string & moduleName, std::string & description, std::string & version, ErrorCollector & ec)
+	bool CorbaConnector::getModuleInfo(const std::string & moduleName, std::string & description, std::string & version, ErrorCollector & ec)
 	{
 		SAS_LOG_NDC();
-		if (recursive_counter >= priv->maxReconnectRecall)
-		{
-			SAS_LOG_INFO(priv->logger, "'recursive_counter' reached the maximum number '10'");
-			return false;
-		}
-
-		try
+		return call_server(priv->internal, moduleName, priv->logger, [&](CorbaSAS::SASModule_ptr module)
 		{
 			CORBA::String_var _description, _version;
-			priv->corba_sas_module->getModuleInfo(CORBA::string_dup(moduleName.c_str()), _description, _version);
+			module->getModuleInfo(moduleName.c_str(), _description, _version);
 			description = _description;
 			version = _version;
-		}
-		catch (CORBA::COMM_FAILURE & ex)
-		{
-			auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__COMMUNICATION_FAILURE, "Caught a CORBA::COMM_FAILURE while using the naming service.");
-			SAS_LOG_DEBUG(priv->logger, err);
-			CorbaTools::logException(priv->logger, ex);
-			return false;
-		}
-		catch (CorbaSAS::ErrorHandling::ErrorException & ex)
-		{
-			auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "Caught a CorbaSAS::ErrorHandling::ErrorException while using the naming service.");
-			SAS_LOG_DEBUG(priv->logger, err);
-			CorbaTools::logException(priv->logger, ex, ec);
-			return false;
-		}
-		catch (CorbaSAS::ErrorHandling::FatalErrorException & ex)
-		{
-			auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "Caught a CorbaSAS::ErrorHandling::FatalErrorException while using the naming service.");
-			SAS_LOG_DEBUG(priv->logger, err);
-			CorbaTools::logException(priv->logger, ex, ec);
-			return false;
-		}
-		catch (CorbaSAS::ErrorHandling::NotImplementedException & ex)
-		{
-			auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "Caught a CorbaSAS::ErrorHandling::NotImplementedException.");
-			SAS_LOG_DEBUG(priv->logger, err);
-			CorbaTools::logException(priv->logger, ex, ec);
-			return false;
-		}
-		catch (CORBA::SystemException & ex)
-		{
-			auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "Caught a CORBA::SystemException.");
-			SAS_LOG_ERROR(priv->logger, err);
-			CorbaTools::logException(priv->logger, ex);
+		}, ec) == Invoker::Status::OK;
+	}
 
-			SAS_LOG_INFO(priv->logger, "client may lost the connection. try to reconnect");
-			if (priv->internal.reconnect(priv->corba_sas_module, ec))
-				return getModuleInfo_recursive(++recursive_counter, moduleName, description, version, ec);
+	Connection * CorbaConnector::createConnection(const std::string & module_name, const std::string & invoker_name, ErrorCollector & ec)
+	{
+        (void)ec;
+		return new CorbaConnection(this, module_name, invoker_name, priv->app, priv->batcher.get());
+	}
 
-			return false;
-		}
-		catch (CORBA::Exception & ex)
+	bool CorbaConnector::invokeMany(const std::vector<CorbaRequest> & requests, std::vector<CorbaResponse> & responses, ErrorCollector & ec)
+	{
+		std::vector<const CorbaRequest *> _requests;
+		_requests.reserve(requests.size());
+		for (auto & r : requests)
+			_requests.push_back(&r);
+		return invokeMany(_requests, responses, ec);
+	}
+
+	bool CorbaConnector::invokeMany(const std::vector<const CorbaRequest *> & requests, std::vector<CorbaResponse> & responses, ErrorCollector & ec)
+	{
+		SAS_LOG_NDC();
+		CorbaSAS::SASModule::RequestSequence in;
+		toRequestSequence(requests, in);
+
+		return priv->internal.call(std::string(), [&](CorbaSAS::SASModule_ptr module)
 		{
-			auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "Caught a CORBA::Exception.");
-			SAS_LOG_ERROR(priv->logger, err);
-			CorbaTools::logException(priv->logger, ex);
-			return false;
-		}
-		catch (omniORB::fatalException & ex)
+			CorbaSAS::SASModule::ResponseSequence_var out;
+			module->invokeMany(in, out);
+			fromResponseSequence(out.in(), responses);
+		}, ec);
+	}
+
+	bool CorbaConnector::invokeAsync(const std::vector<CorbaRequest> & requests, std::function<void(std::vector<CorbaResponse> & responses)> handler, ErrorCollector & ec)
+	{
+		SAS_LOG_NDC();
+		CorbaSAS::ResponseHandler_var handler_ref;
 		{
-			auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "Caught omniORB::fatalException");
-			SAS_LOG_FATAL(priv->logger, err);
-			CorbaTools::logException(priv->logger, ex);
-			return false;
+			std::unique_lock<std::mutex> __locker(priv->mut_async);
+			if (!priv->response_handler.in() && !priv->activateResponseHandler(ec))
+				return false;
+			handler_ref = CorbaSAS::ResponseHandler::_duplicate(priv->response_handler_ref.in());
 		}
-		catch (...)
+
+		std::vector<const CorbaRequest *> _requests;
+		_requests.reserve(requests.size());
+		for (auto & r : requests)
+			_requests.push_back(&r);
+		CorbaSAS::SASModule::RequestSequence in;
+		toRequestSequence(_requests, in);
+
+		auto call_id = priv->response_handler->add(requests.size(), std::move(handler));
+		if (!priv->internal.call(std::string(), [&](CorbaSAS::SASModule_ptr module) { module->invokeAsync(call_id, in, handler_ref.in()); }, ec))
 		{
-			auto err = ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "Caught an unknown exception.");
-			SAS_LOG_FATAL(priv->logger, err);
+			priv->response_handler->remove(call_id);
 			return false;
 		}
-
 		return true;
 	}
 
-	Connection * CorbaConnector::createConnection(const std::string & module_name, const std::string & invoker_name, ErrorCollector & ec)
-	{
-        (void)ec;
-		return new CorbaConnection(this, priv->maxReconnectRecall, module_name, invoker_name, priv->app, priv->corba_sas_module);
-	}
-
 	CorbaConnector_internal & CorbaConnector::internal()
 	{
 		return priv->internal;
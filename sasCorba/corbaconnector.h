@@ -21,12 +21,36 @@
 #include "config.h"
 
 #include <sasCore/connector.h>
+#include <sasCore/session.h>
 #include <omniORB4/CORBA.h>
 
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace SAS {
 
 class Application;
 
+// one entry of an 'invokeMany' or 'invokeAsync' call
+struct CorbaRequest
+{
+	std::string module;
+	SessionID sid = 0;
+	std::string invoker;
+	const std::vector<char> * input = nullptr; // not copied, it has to be kept until the call returns
+};
+
+// result of one entry of an 'invokeMany' or 'invokeAsync' call
+struct CorbaResponse
+{
+	SessionID sid = 0;
+	Invoker::Status status = Invoker::Status::Error;
+	std::vector<char> output;
+	std::vector<std::pair<long, std::string>> errors;
+};
+
 class CorbaConnector_internal;
 
 struct CorbaConnector_priv;
@@ -45,14 +69,21 @@ public:
 
 	virtual bool connect(ErrorCollector & ec) final;
 
+	virtual bool isReady() const final;
+
 	virtual Connection * createConnection(const std::string & module_name, const std::string & invoker_name, ErrorCollector & ec) final;
 
 	virtual bool getModuleInfo(const std::string & moduleName, std::string & description, std::string & version, ErrorCollector & ec) final;
 
+	// sends all requests in one call; responses are in the order of the requests
+	bool invokeMany(const std::vector<CorbaRequest> & requests, std::vector<CorbaResponse> & responses, ErrorCollector & ec);
+	bool invokeMany(const std::vector<const CorbaRequest *> & requests, std::vector<CorbaResponse> & responses, ErrorCollector & ec);
+
+	// returns when the requests are sent; 'handler' is called by an ORB thread when the responses arrive
+	bool invokeAsync(const std::vector<CorbaRequest> & requests, std::function<void(std::vector<CorbaResponse> & responses)> handler, ErrorCollector & ec);
+
 	CorbaConnector_internal & internal();
 private:
-	bool getModuleInfo_recursive(long & recursive_counter, const std::string & moduleName, std::string & description, std::string & version, ErrorCollector & ec);
-
 	CorbaConnector_priv * priv;
 };
 
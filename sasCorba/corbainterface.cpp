@@ -34,42 +34,85 @@
 #include <numeric>
 #include <fstream>
 #include <mutex>
+#include <map>
+#include <memory>
 
 #include "generated/corbasas.hh"
 
 namespace SAS {
 
-class CorbaSASModule_impl : public POA_CorbaSAS::SASModule
+struct CorbaErr
+{
+	long code;
+	std::string text;
+};
+
+// the error list is allocated only when an error is added
+class CorbaErrorCollector : public ErrorCollector
 {
+	std::unique_ptr<std::vector<CorbaErr>> _errs;
 public:
-	CorbaSASModule_impl(Application * app) :
-		_app(app), _logger(Logging::getLogger("SAS.CorbaSASModuleImpl"))
-	{ }
+	CorbaSAS::ErrorHandling::ErrorSequence errors() const
+	{
+		CorbaSAS::ErrorHandling::ErrorSequence ret;
+		if (!_errs)
+			return ret;
+		ret.length(static_cast<CORBA::ULong>(_errs->size()));
+		CORBA::ULong i(0);
+		for (const auto & e : *_errs)
+		{
+			ret[i].error_code = e.code;
+			ret[i].error_text = CORBA::string_dup(e.text.c_str());
+			++i;
+		}
+		return ret;
+	}
 
-	Logging::LoggerPtr logger() const
+protected:
+	virtual void append(long errorCode, const std::string & errorText) final
 	{
-		return _logger;
+		if (!_errs)
+			_errs.reset(new std::vector<CorbaErr>());
+		_errs->push_back({ errorCode, errorText });
 	}
+};
+
+class CorbaSASModule_impl;
+
+// one CORBA object per module, they are activated on the first request of the module
+class CorbaModuleObjects
+{
+public:
+	CorbaModuleObjects(Application * app) : _app(app), _logger(Logging::getLogger("SAS.CorbaModuleObjects"))
+	{ }
 
-	struct Err
+	void init(const PortableServer::POA_var & poa)
 	{
-		long code;
-		std::string text;
-	};
+		_poa = poa;
+	}
+
+	CorbaSAS::SASModule_ptr get(const char * module_name, ErrorCollector & ec);
+
+private:
+	Application * _app;
+	Logging::LoggerPtr _logger;
+	PortableServer::POA_var _poa;
+	std::mutex _mut;
+	std::map<std::string, CorbaSAS::SASModule_var> _objects;
+};
+
+class CorbaSASModule_impl : public POA_CorbaSAS::SASModule
+{
+public:
+	// 'module' is null for the object of the interface, then the module is looked up by name for every call
+	CorbaSASModule_impl(Application * app, CorbaModuleObjects * module_objects, Module * module = nullptr) :
+		_app(app), _module_objects(module_objects), _module(module),
+		_logger(Logging::getLogger(module ? "SAS.CorbaSASModuleImpl." + module->name() : std::string("SAS.CorbaSASModuleImpl")))
+	{ }
 
-	static CorbaSAS::ErrorHandling::ErrorSequence toErrorSequence(const std::list<Err> & errs)
+	Logging::LoggerPtr logger() const
 	{
-		CorbaSAS::ErrorHandling::ErrorSequence_var ret = new CorbaSAS::ErrorHandling::ErrorSequence();
-		ret->length(errs.size());
-		size_t i(0);
-		for(const auto & e : errs)
-		{
-			CorbaSAS::ErrorHandling::Error err;
-			err.error_code = e.code;
-			err.error_text = CORBA::string_dup(e.text.c_str());
-			ret[i++] = err;
-		}
-		return ret;
+		return _logger;
 	}
 
     virtual void invoke(CorbaSAS::SASModule::SessionID& session_id, const char* module_name, const char* invoker,
@@ -77,33 +120,31 @@ public:
 	{
     	SAS_LOG_NDC();
 
-    	std::list<Err> errs;
-    	SimpleErrorCollector ec([&](long errorCode, const std::string & errorText)
-    		{ errs.push_back({errorCode, errorText}); });
+    	CorbaErrorCollector ec;
 
     	Module * module;
-    	if(!(module = _app->objectRegistry()->getObject<Module>(SAS_OBJECT_TYPE__MODULE, module_name, ec)))
-    		throw CorbaSAS::ErrorHandling::ErrorException(module_name, invoker, toErrorSequence(errs));
+    	if(!(module = getModule(module_name, ec)))
+    		throw CorbaSAS::ErrorHandling::ErrorException(module_name, invoker, ec.errors());
 
     	SessionID sid = session_id;
     	Session * session;
     	if(!(session = module->getSession(sid, ec)))
-    		throw CorbaSAS::ErrorHandling::ErrorException(module_name, invoker, toErrorSequence(errs));
+    		throw CorbaSAS::ErrorHandling::ErrorException(module_name, invoker, ec.errors());
     	session_id = session->id();
 
     	std::vector<char> out;
-    	std::vector<char> tmp = CorbaTools::toByteArray(in_msg);
-		switch(session->invoke(invoker, tmp, out, ec))
+		// the input is passed to the invoker from the request buffer
+		switch(session->invoke(invoker, reinterpret_cast<const char *>(in_msg.get_buffer()), in_msg.length(), out, ec))
     	{
     	case Invoker::Status::FatalError:
 			session->unlock();
-    		throw CorbaSAS::ErrorHandling::FatalErrorException(module_name, invoker, toErrorSequence(errs));
+    		throw CorbaSAS::ErrorHandling::FatalErrorException(module_name, invoker, ec.errors());
     	case Invoker::Status::Error:
 			session->unlock();
-			throw CorbaSAS::ErrorHandling::ErrorException(module_name, invoker, toErrorSequence(errs));
+			throw CorbaSAS::ErrorHandling::ErrorException(module_name, invoker, ec.errors());
     	case Invoker::Status::NotImplemented:
 			session->unlock();
-			throw CorbaSAS::ErrorHandling::NotImplementedException(module_name, invoker, toErrorSequence(errs));
+			throw CorbaSAS::ErrorHandling::NotImplementedException(module_name, invoker, ec.errors());
     	case Invoker::Status::OK:
 			session->unlock();
 			break;
@@ -114,13 +155,11 @@ public:
     virtual void endSession(const char * module_name, ::CorbaSAS::SASModule::SessionID session_id) final
 	{
     	SAS_LOG_NDC();
-    	std::list<Err> errs;
-    	SimpleErrorCollector ec([&](long errorCode, const std::string & errorText)
-    		{ errs.push_back({errorCode, errorText}); });
+    	CorbaErrorCollector ec;
 
     	Module * module;
-    	if(!(module = _app->objectRegistry()->getObject<Module>(SAS_OBJECT_TYPE__MODULE, module_name, ec)))
-    		throw CorbaSAS::ErrorHandling::ErrorException(module_name, "", toErrorSequence(errs));
+    	if(!(module = getModule(module_name, ec)))
+    		throw CorbaSAS::ErrorHandling::ErrorException(module_name, "", ec.errors());
 
     	module->endSession(session_id);
 	}
@@ -128,46 +167,173 @@ public:
 	virtual void getModuleInfo(const char* module_name, ::CORBA::String_out description, ::CORBA::String_out version) final
 	{
     	SAS_LOG_NDC();
-    	std::list<Err> errs;
-    	SimpleErrorCollector ec([&](long errorCode, const std::string & errorText)
-    		{ errs.push_back({errorCode, errorText}); });
+    	CorbaErrorCollector ec;
 
     	Module * module;
-    	if(!(module = _app->objectRegistry()->getObject<Module>(SAS_OBJECT_TYPE__MODULE, module_name, ec)))
-    		throw CorbaSAS::ErrorHandling::ErrorException(module_name, "", toErrorSequence(errs));
+    	if(!(module = getModule(module_name, ec)))
+    		throw CorbaSAS::ErrorHandling::ErrorException(module_name, "", ec.errors());
+
+    	if(!module->isReady())
+    	{
+    		auto err = ec.add(SAS_CORE__ERROR__MODULE__NOT_READY, std::string() + "module '" + module_name + "' is not ready");
+    		SAS_LOG_WARN(logger(), err);
+    		throw CorbaSAS::ErrorHandling::ErrorException(module_name, "", ec.errors());
+    	}
 
     	description = CORBA::string_dup(module->description().c_str());
     	version = CORBA::string_dup(module->version().c_str());
 	}
 
-	virtual void getSession(CorbaSAS::SASModule::SessionID& session_id, const char* module_name) final
-	{
-		std::list<Err> errs;
-		SimpleErrorCollector ec([&](long errorCode, const std::string & errorText)
-		{ errs.push_back({ errorCode, errorText }); });
+	virtual void getSession(CorbaSAS::SASModule::SessionID& session_id, const char* module_name) final
+	{
+		CorbaErrorCollector ec;
 
 		Module * module;
-		if (!(module = _app->objectRegistry()->getObject<Module>(SAS_OBJECT_TYPE__MODULE, module_name, ec)))
-			throw CorbaSAS::ErrorHandling::ErrorException(module_name, CORBA::string_dup(""), toErrorSequence(errs));
+		if (!(module = getModule(module_name, ec)))
+			throw CorbaSAS::ErrorHandling::ErrorException(module_name, CORBA::string_dup(""), ec.errors());
 
 		SessionID sid = session_id;
 		Session * session;
 		if (!(session = module->getSession(sid, ec)))
-			throw CorbaSAS::ErrorHandling::ErrorException(module_name, CORBA::string_dup(""), toErrorSequence(errs));
+			throw CorbaSAS::ErrorHandling::ErrorException(module_name, CORBA::string_dup(""), ec.errors());
 		session_id = session->id();
 		session->unlock();
-	}
+	}
+
+	virtual void invokeMany(const CorbaSAS::SASModule::RequestSequence & requests, CorbaSAS::SASModule::ResponseSequence_out responses) final
+	{
+		SAS_LOG_NDC();
+		CorbaSAS::SASModule::ResponseSequence_var ret = new CorbaSAS::SASModule::ResponseSequence();
+		ret->length(requests.length());
+		for (CORBA::ULong i(0), l(requests.length()); i < l; ++i)
+			invokeOne(requests[i], ret[i]);
+		responses = ret._retn();
+	}
+
+	// oneway: the client does not wait for it, the ORB runs the concurrent calls in its own threads
+	virtual void invokeAsync(CORBA::LongLong call_id, const CorbaSAS::SASModule::RequestSequence & requests, CorbaSAS::ResponseHandler_ptr handler) final
+	{
+		SAS_LOG_NDC();
+		CorbaSAS::SASModule::ResponseSequence responses;
+		responses.length(requests.length());
+		for (CORBA::ULong i(0), l(requests.length()); i < l; ++i)
+			invokeOne(requests[i], responses[i]);
+
+		if (CORBA::is_nil(handler))
+		{
+			SAS_LOG_WARN(_logger, "no response handler is set for call '" + std::to_string(call_id) + "'");
+			return;
+		}
+
+		try
+		{
+			handler->responses(call_id, responses);
+		}
+		catch (CORBA::SystemException & ex)
+		{
+			SAS_LOG_ERROR(_logger, "could not send responses of call '" + std::to_string(call_id) + "'");
+			CorbaTools::logException(_logger, ex);
+		}
+		catch (CORBA::Exception & ex)
+		{
+			SAS_LOG_ERROR(_logger, "could not send responses of call '" + std::to_string(call_id) + "'");
+			CorbaTools::logException(_logger, ex);
+		}
+		catch (...)
+		{
+			SAS_LOG_ERROR(_logger, "could not send responses of call '" + std::to_string(call_id) + "': unknown exception");
+		}
+	}
+
+	virtual CorbaSAS::SASModule_ptr getModuleObject(const char * module_name) final
+	{
+		SAS_LOG_NDC();
+		CorbaErrorCollector ec;
+		auto ret = _module_objects->get(module_name, ec);
+		if (CORBA::is_nil(ret))
+			throw CorbaSAS::ErrorHandling::ErrorException(module_name, "", ec.errors());
+		return ret;
+	}
 
 private:
+	inline Module * getModule(const char * module_name, ErrorCollector & ec)
+	{
+		return _module ? _module : _app->objectRegistry()->getObject<Module>(SAS_OBJECT_TYPE__MODULE, module_name, ec);
+	}
+
+	// errors are reported in the response instead of exceptions, so one failing request does not fail the others
+	void invokeOne(const CorbaSAS::SASModule::Request & req, CorbaSAS::SASModule::Response & resp)
+	{
+		SAS_LOG_NDC();
+		CorbaErrorCollector ec;
+
+		resp.session_id = req.session_id;
+		resp.status = static_cast<CORBA::Long>(Invoker::Status::Error);
+
+		// the requests can address any module
+		Module * module;
+		SessionID sid = req.session_id;
+		Session * session;
+		if (!(module = _app->objectRegistry()->getObject<Module>(SAS_OBJECT_TYPE__MODULE, req.module_name.in(), ec)) ||
+			!(session = module->getSession(sid, ec)))
+		{
+			resp.err = ec.errors();
+			return;
+		}
+		resp.session_id = session->id();
+
+		std::vector<char> out;
+		auto status = session->invoke(req.invoker.in(), reinterpret_cast<const char *>(req.in_msg.get_buffer()), req.in_msg.length(), out, ec);
+		session->unlock();
+
+		resp.status = static_cast<CORBA::Long>(status);
+		resp.err = ec.errors();
+		CorbaTools::assignOctetSequence(out, resp.out_msg);
+	}
+
    Application * _app;
+   CorbaModuleObjects * _module_objects;
+   Module * _module;
    Logging::LoggerPtr _logger;
 };
 
+CorbaSAS::SASModule_ptr CorbaModuleObjects::get(const char * module_name, ErrorCollector & ec)
+{
+	SAS_LOG_NDC();
+	std::unique_lock<std::mutex> __locker(_mut);
+	auto it = _objects.find(module_name);
+	if (it != _objects.end())
+		return CorbaSAS::SASModule::_duplicate(it->second.in());
+
+	Module * module;
+	if (!(module = _app->objectRegistry()->getObject<Module>(SAS_OBJECT_TYPE__MODULE, module_name, ec)))
+		return CorbaSAS::SASModule::_nil();
+
+	try
+	{
+		PortableServer::Servant_var<CorbaSASModule_impl> servant = new CorbaSASModule_impl(_app, this, module);
+		PortableServer::ObjectId_var id = PortableServer::string_to_ObjectId(module_name);
+		_poa->activate_object_with_id(id.in(), servant.in());
+		CORBA::Object_var obj = _poa->id_to_reference(id.in());
+		CorbaSAS::SASModule_var ref = CorbaSAS::SASModule::_narrow(obj);
+		SAS_LOG_DEBUG(_logger, std::string("CORBA object of module '") + module_name + "' is activated");
+		_objects[module_name] = CorbaSAS::SASModule::_duplicate(ref.in());
+		return ref._retn();
+	}
+	catch (CORBA::Exception & ex)
+	{
+		auto err = ec.add(SAS_CORE__ERROR__INTERFACE__UNEXPECTED_ERROR, std::string("could not activate CORBA object of module '") + module_name + "'");
+		SAS_LOG_ERROR(_logger, err);
+		CorbaTools::logException(_logger, ex);
+	}
+	return CorbaSAS::SASModule::_nil();
+}
+
 class CorbaServer
 {
 public:
 	CorbaServer(CorbaInterface * interface, Application * app) :
-		_app(app), _interface(interface), corba_sas_module(new CorbaSASModule_impl(app))
+		_app(app), _interface(interface), module_objects(app), corba_sas_module(new CorbaSASModule_impl(app, &module_objects))
 	{ }
 
 	struct ServerConnectionInfo
@@ -325,6 +491,17 @@ public:
 
 			PortableServer::ObjectId_var corba_sas_module_id = poa->activate_object(corba_sas_module);
 
+			// module objects: the servants are bound to their modules, the ORB dispatches the calls in its own threads
+			CORBA::PolicyList policies;
+			policies.length(2);
+			policies[0] = poa->create_thread_policy(PortableServer::ORB_CTRL_MODEL);
+			policies[1] = poa->create_id_assignment_policy(PortableServer::USER_ID);
+			PortableServer::POAManager_var pman = poa->the_POAManager();
+			PortableServer::POA_var module_poa = poa->create_POA(("SASModules." + _interface->name()).c_str(), pman, policies);
+			for (CORBA::ULong i(0), l(policies.length()); i < l; ++i)
+				policies[i]->destroy();
+			module_objects.init(module_poa);
+
 			obj = corba_sas_module->_this();
 
 			_serverConnectionInfo = serverConnectionInfo;
@@ -468,6 +645,7 @@ private:
 	CORBA::ORB_var orb;
 	CORBA::Object_var obj;
 	PortableServer::POA_var poa;
+	CorbaModuleObjects module_objects;
 	PortableServer::Servant_var<CorbaSASModule_impl> corba_sas_module;
 };
 
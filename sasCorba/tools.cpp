@@ -18,31 +18,58 @@
 #include "tools.h"
 #include <sasCore/errorcollector.h>
 
+#include <cstring>
+
 namespace SAS { namespace CorbaTools {
 
+	static CORBA::Octet * toOctetBuffer(const std::vector<char> & data)
+	{
+		CORBA::Octet * buffer = CorbaSAS::SASModule::OctetSequence::allocbuf(static_cast<CORBA::ULong>(data.size()));
+		if (data.size())
+			memcpy(buffer, data.data(), data.size());
+		return buffer;
+	}
+
+	static CorbaSAS::SASModule::OctetSequence * newOctetSequence(const std::vector<char> & data)
+	{
+		// the buffer is adopted by the sequence, it is released with it
+		CORBA::ULong length = static_cast<CORBA::ULong>(data.size());
+		return new CorbaSAS::SASModule::OctetSequence(length, length, toOctetBuffer(data), true);
+	}
+
 	std::vector<char> toByteArray(const CorbaSAS::SASModule::OctetSequence & data)
 	{
-		std::vector<char> ret(data.length());
-		for(size_t i(0), l(ret.size()); i < l; ++i)
-			ret[i] = data[i];
+		std::vector<char> ret;
+		toByteArray(data, ret);
 		return ret;
 	}
 
+	extern void toByteArray(const CorbaSAS::SASModule::OctetSequence & data, std::vector<char> & ret)
+	{
+		auto buffer = reinterpret_cast<const char *>(data.get_buffer());
+		ret.assign(buffer, buffer + data.length());
+	}
+
 	extern void toOctetSequence(const std::vector<char> & data, CorbaSAS::SASModule::OctetSequence_out & ret)
 	{
-		ret = new CorbaSAS::SASModule::OctetSequence();
-		ret->length(data.size());
-		for(size_t i(0), l(data.size()); i < l; ++i)
-			ret[i] = data[i];
+		ret = newOctetSequence(data);
 	}
 
 	extern CorbaSAS::SASModule::OctetSequence_var toOctetSequence_var(const std::vector<char> & data)
 	{
-		CorbaSAS::SASModule::OctetSequence_var ret = new CorbaSAS::SASModule::OctetSequence();
-		ret->length(data.size());
-		for(size_t i(0), l(data.size()); i < l; ++i)
-			ret[i] = data[i];
-		return ret;
+		return newOctetSequence(data);
+	}
+
+	extern void assignOctetSequence(const std::vector<char> & data, CorbaSAS::SASModule::OctetSequence & ret)
+	{
+		CORBA::ULong length = static_cast<CORBA::ULong>(data.size());
+		ret.replace(length, length, toOctetBuffer(data), true);
+	}
+
+	extern void wrapOctetSequence(const std::vector<char> & data, CorbaSAS::SASModule::OctetSequence & ret)
+	{
+		CORBA::ULong length = static_cast<CORBA::ULong>(data.size());
+		ret.replace(length, length, reinterpret_cast<CORBA::Octet*>(const_cast<char*>(data.data())), false);
 	}
 
 	extern void logException(Logging::LoggerPtr logger, CORBA::COMM_FAILURE & ex)
@@ -31,9 +31,13 @@ namespace SAS {
 	namespace CorbaTools {
 
 	extern std::vector<char> toByteArray(const CorbaSAS::SASModule::OctetSequence & data);
+	extern void toByteArray(const CorbaSAS::SASModule::OctetSequence & data, std::vector<char> & ret);
 
 	extern void toOctetSequence(const std::vector<char> & data, CorbaSAS::SASModule::OctetSequence_out & ret);
 	extern CorbaSAS::SASModule::OctetSequence_var toOctetSequence_var(const std::vector<char> & data);
+	extern void assignOctetSequence(const std::vector<char> & data, CorbaSAS::SASModule::OctetSequence & ret);
+	// 'ret' refers to the buffer of 'data' without copying, it must not outlive 'data'
+	extern void wrapOctetSequence(const std::vector<char> & data, CorbaSAS::SASModule::OctetSequence & ret);
 
 	extern void logException(Logging::LoggerPtr logger, CORBA::COMM_FAILURE & ex);
 	extern void logException(Logging::LoggerPtr logger, CORBA::Exception & ex);
@@ -28,7 +28,12 @@
 #include "include/sasCore/threadpool.h"
 
 #include <list>
+#include <map>
 #include <memory>
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <condition_variable>
 
 #include <stdlib.h>
@@ -36,15 +41,43 @@
 
 namespace SAS {
 
+#ifdef SAS_APP_SHARDED_LOCKING
+// every counter has its own cache line, a thread always uses the same one
+struct alignas(64) ApplicationLockShard
+{
+    ApplicationLockShard() : counter(0)
+    { }
+
+    std::atomic<long> counter;
+};
+
+static size_t applicationLockShard()
+{
+    static std::atomic<size_t> next(0);
+    static thread_local size_t shard = next++ % SAS_APP_LOCK_SHARDS;
+    return shard;
+}
+#endif
+
 struct Application_priv
 {
     Application_priv() :
         logger(Logging::getLogger("SAS.Application")),
         threadPool("SAS.Application.ThreadPool"),
         argc(0),
-        argv(nullptr)
+        argv(nullptr),
+        enabled(false)
     {
 		srand((unsigned int)time(0));
+#if defined(SAS_APP_SHARDED_LOCKING)
+        // operator new aligns only to alignof(std::max_align_t) before C++17, so the shards get a buffer of their own
+        size_t space = sizeof(ApplicationLockShard) * SAS_APP_LOCK_SHARDS + alignof(ApplicationLockShard);
+        lock_shard_buffer.reset(new char[space]);
+        void * p = lock_shard_buffer.get();
+        lock_shards = static_cast<ApplicationLockShard*>(std::align(alignof(ApplicationLockShard), sizeof(ApplicationLockShard) * SAS_APP_LOCK_SHARDS, p, space));
+        for (size_t i = 0; i < SAS_APP_LOCK_SHARDS; ++i)
+            new (lock_shards + i) ApplicationLockShard();
+#endif
 	}
 
 	ObjectRegistry objectRegistry;
@@ -55,9 +88,22 @@ struct Application_priv
 	int argc;
 	char ** argv;
 
-    bool enabled = false;
+    std::atomic<bool> enabled;
 
-    #ifdef SAS_APP_SMART_LOCKING
+#if defined(SAS_APP_SHARDED_LOCKING)
+    std::unique_ptr<char[]> lock_shard_buffer;
+    ApplicationLockShard * lock_shards;
+    std::mutex lock_mut;
+    std::condition_variable lock_cv;
+
+    long lockCounter() const
+    {
+        long ret = 0;
+        for (size_t i = 0; i < SAS_APP_LOCK_SHARDS; ++i)
+            ret += lock_shards[i].counter.load();
+        return ret;
+    }
+#elif defined(SAS_APP_SMART_LOCKING)
         std::mutex lock_mut;
         std::condition_variable lock_cv;
         int lock_counter = 0;
@@ -66,6 +112,57 @@ struct Application_priv
 #endif
 };
 
+// runs the tasks in threads of the pool (in the calling thread if there is no more thread) and waits for all of them
+static bool runParallel(ThreadPool * pool, const std::vector<std::function<bool(ErrorCollector & ec)>> & tasks, ErrorCollector & ec)
+{
+    std::mutex mut;
+    std::condition_variable cv;
+    size_t pending = 0;
+    bool ret = true;
+    std::vector<std::pair<long, std::string>> errors;
+
+    auto run = [&](const std::function<bool(ErrorCollector & ec)> & task)
+    {
+        SimpleErrorCollector tec([&](long errorCode, const std::string & errorText)
+        {
+            std::unique_lock<std::mutex> __locker(mut);
+            errors.push_back(std::make_pair(errorCode, errorText));
+        });
+        bool ok = task(tec);
+        std::unique_lock<std::mutex> __locker(mut);
+        if(!ok)
+            ret = false;
+    };
+
+    for(auto & task : tasks)
+    {
+        auto th = pool->allocate();
+        if(!th)
+        {
+            run(task);
+            continue;
+        }
+        {
+            std::unique_lock<std::mutex> __locker(mut);
+            ++pending;
+        }
+        th->run([&run, &task]() { run(task); },
+        [&, pool, th]()
+        {
+            pool->release(th);
+            std::unique_lock<std::mutex> __locker(mut);
+            --pending;
+            cv.notify_all();
+        });
+    }
+
+    std::unique_lock<std::mutex> __locker(mut);
+    cv.wait(__locker, [&]() { return pending == 0; });
+    for(auto & e : errors)
+        ec.add(e.first, e.second);
+    return ret;
+}
+
 Application::Application() : priv(new Application_priv)
 { }
 
@@ -123,21 +220,46 @@ bool Application::init(ErrorCollector & ec)
                 return false;
             }
 
+            bool parallel_init;
+            if (!configReader()->getBoolEntry("SAS/PARALLEL_INIT", parallel_init, false, ec))
+            {
+                __locker.unlock();
+                deinit();
+                return false;
+            }
+            SAS_LOG_VAR(logger(), parallel_init);
+#if !defined(SAS_APP_SHARDED_LOCKING) && !defined(SAS_APP_SMART_LOCKING)
+            if (parallel_init)
+            {
+                // the components calling the application from other threads would wait for the init thread
+                SAS_LOG_WARN(logger(), "parallel initialization is not supported with exclusive application locking");
+                parallel_init = false;
+            }
+#endif
+
             priv->componentLoaders.resize(comp_paths.size());
 
             SAS_LOG_INFO(logger(), "loading component libraries...");
+            std::vector<std::function<bool(ErrorCollector & ec)>> loaders;
             for(size_t i = 0, l = comp_paths.size(); i < l; ++i)
-            {
-                SAS_LOG_VAR(logger(), comp_paths[i]);
-                auto cl = new ComponentLoader(comp_paths[i]);
-                if(!cl->load(ec))
+                loaders.push_back([this, &comp_paths, i](ErrorCollector & ec) -> bool
                 {
-                    delete cl;
-                    has_error = true;
-                }
-                else
+                    SAS_LOG_VAR(logger(), comp_paths[i]);
+                    auto cl = new ComponentLoader(comp_paths[i]);
+                    if(!cl->load(ec))
+                    {
+                        delete cl;
+                        return false;
+                    }
                     priv->componentLoaders[i] = cl;
-            }
+                    return true;
+                });
+            if(parallel_init)
+                has_error = !runParallel(threadPool(), loaders, ec);
+            else
+                for(auto & loader : loaders)
+                    if(!loader(ec))
+                        has_error = true;
             if(has_error)
             {
                 SAS_LOG_ERROR(logger(), "loading component libraries... ..error");
@@ -148,6 +270,8 @@ bool Application::init(ErrorCollector & ec)
             SAS_LOG_INFO(logger(), "loading component libraries... ..done");
 
             SAS_LOG_INFO(logger(), "initializing components...");
+            auto init_begin = std::chrono::steady_clock::now();
+            std::vector<Component*> comps;
             for(auto cl : priv->componentLoaders)
             {
                 auto comp = cl->component();
@@ -164,17 +288,52 @@ bool Application::init(ErrorCollector & ec)
                     ss << v.first << ": '" << v.second << "'";
                 }
                 SAS_LOG_INFO(logger(), ss.str());
+                comps.push_back(comp);
+            }
+
+            auto initializer = [this](Component * comp, ErrorCollector & ec) -> bool
+            {
                 SAS_LOG_DEBUG(logger(), "initializing component '"+comp->name()+"'...");
+                auto begin = std::chrono::steady_clock::now();
                 if(!comp->init(this, ec))
                 {
                     SAS_LOG_ERROR(logger(), "initializing component '"+comp->name()+"'... ..error");
-                    __locker.unlock();
-                    deinit();
                     return false;
                 }
-                SAS_LOG_INFO(logger(), "initializing component '"+comp->name()+"'... ..done");
+                auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+                SAS_LOG_INFO(logger(), "initializing component '"+comp->name()+"'... ..done (" + std::to_string(elapsed.count()) + " ms)");
+                return true;
+            };
+
+            if(parallel_init)
+            {
+                std::vector<std::vector<Component*>> waves;
+                if(!initWaves(comps, waves, ec))
+                    has_error = true;
+                for(size_t i = 0, l = waves.size(); i < l && !has_error; ++i)
+                {
+                    SAS_LOG_DEBUG(logger(), "initialization wave " + std::to_string(i + 1) + ": " + std::to_string(waves[i].size()) + " component(s)");
+                    std::vector<std::function<bool(ErrorCollector & ec)>> initializers;
+                    for(auto comp : waves[i])
+                        initializers.push_back([&initializer, comp](ErrorCollector & ec) { return initializer(comp, ec); });
+                    has_error = !runParallel(threadPool(), initializers, ec);
+                }
+            }
+            else
+                for(auto comp : comps)
+                    if(!initializer(comp, ec))
+                    {
+                        has_error = true;
+                        break;
+                    }
+            if(has_error)
+            {
+                __locker.unlock();
+                deinit();
+                return false;
             }
-            SAS_LOG_INFO(logger(), "initializing components... ..done");
+            auto init_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - init_begin);
+            SAS_LOG_INFO(logger(), "initializing components... ..done (" + std::to_string(init_elapsed.count()) + " ms)");
         }
         else
             SAS_LOG_WARN(logger(), "no components are set");
@@ -189,12 +348,88 @@ bool Application::init(ErrorCollector & ec)
     return true;
 }
 
+// the components of a wave depend only on the components of the previous waves
+bool Application::initWaves(const std::vector<Component*> & comps, std::vector<std::vector<Component*>> & waves, ErrorCollector & ec)
+{
+    SAS_LOG_NDC();
+    std::map<std::string, size_t> index;
+    for(size_t i = 0, l = comps.size(); i < l; ++i)
+        if(!index.insert(std::make_pair(comps[i]->name(), i)).second)
+        {
+            auto err = ec.add(SAS_CORE__ERROR__APPLICATION__INVALID_DEPENDENCY, "component name '" + comps[i]->name() + "' is not unique");
+            SAS_LOG_ERROR(logger(), err);
+            return false;
+        }
+
+    std::vector<std::vector<size_t>> dependents(comps.size());
+    std::vector<size_t> missing(comps.size(), 0);
+    for(size_t i = 0, l = comps.size(); i < l; ++i)
+    {
+        auto deps = comps[i]->dependencies();
+        std::vector<std::string> configured_deps;
+        if(!configReader()->getStringListEntry("SAS/DEPENDENCIES/" + comps[i]->name(), configured_deps, std::vector<std::string>(), ec))
+            return false;
+        deps.insert(deps.end(), configured_deps.begin(), configured_deps.end());
+        for(auto & dep : deps)
+        {
+            auto it = index.find(dep);
+            if(it == index.end())
+            {
+                auto err = ec.add(SAS_CORE__ERROR__APPLICATION__INVALID_DEPENDENCY, "component '" + comps[i]->name() + "' depends on unknown component '" + dep + "'");
+                SAS_LOG_ERROR(logger(), err);
+                return false;
+            }
+            dependents[it->second].push_back(i);
+            ++missing[i];
+        }
+    }
+
+    std::vector<size_t> ready;
+    for(size_t i = 0, l = comps.size(); i < l; ++i)
+        if(!missing[i])
+            ready.push_back(i);
+
+    size_t done = 0;
+    while(ready.size())
+    {
+        std::vector<Component*> wave;
+        std::vector<size_t> next;
+        for(auto i : ready)
+        {
+            wave.push_back(comps[i]);
+            for(auto d : dependents[i])
+                if(!--missing[d])
+                    next.push_back(d);
+        }
+        done += wave.size();
+        waves.push_back(wave);
+        ready.swap(next);
+    }
+
+    if(done < comps.size())
+    {
+        auto err = ec.add(SAS_CORE__ERROR__APPLICATION__INVALID_DEPENDENCY, "circular dependency among components");
+        SAS_LOG_ERROR(logger(), err);
+        return false;
+    }
+    return true;
+}
+
 void Application::deinit()
 {
 	SAS_LOG_NDC();
 
     //set app to disable
     SAS_LOG_INFO(priv->logger, "shutting down SAS..");
+#ifdef SAS_APP_SHARDED_LOCKING
+    // the new calls are rejected first, then the in-flight ones are waited for
+    priv->enabled = false;
+    {
+        std::unique_lock<std::mutex> __locker(priv->lock_mut);
+        while (!priv->lock_cv.wait_for(__locker, std::chrono::milliseconds(200), [&]() { return priv->lockCounter() == 0; }))
+            ;
+    }
+#else
     while(true)
     {
     #ifdef SAS_APP_SMART_LOCKING
@@ -207,6 +442,7 @@ void Application::deinit()
         priv->enabled = false;
         break;
     }
+#endif
 
     SAS_LOG_INFO(priv->logger, "terminating interfaces...");
     auto im = interfaceManager();
@@ -236,7 +472,9 @@ ThreadPool * Application::threadPool()
 
 void Application::lock()
 {
-#ifdef SAS_APP_SMART_LOCKING
+#if defined(SAS_APP_SHARDED_LOCKING)
+    priv->lock_shards[applicationLockShard()].counter.fetch_add(1);
+#elif defined(SAS_APP_SMART_LOCKING)
     std::unique_lock<std::mutex> __locker(priv->lock_mut);
     ++priv->lock_counter;
 #else
@@ -246,7 +484,15 @@ void Application::lock()
 
 void Application::unlock()
 {
-#ifdef SAS_APP_SMART_LOCKING
+#if defined(SAS_APP_SHARDED_LOCKING)
+    priv->lock_shards[applicationLockShard()].counter.fetch_sub(1);
+    // only the shutdown waits for the counters
+    if (!priv->enabled)
+    {
+        std::unique_lock<std::mutex> __locker(priv->lock_mut);
+        priv->lock_cv.notify_all();
+    }
+#elif defined(SAS_APP_SMART_LOCKING)
     std::unique_lock<std::mutex> __locker(priv->lock_mut);
     if(--priv->lock_counter < 0)
         priv->lock_counter = 0;
@@ -29,6 +29,7 @@ namespace SAS
 {
 
 class ConfigReader;
+class Component;
 class InterfaceManager;
 class ObjectRegistry;
 class ThreadPool;
@@ -59,8 +60,8 @@ public:
 	virtual inline InterfaceManager * interfaceManager() { return nullptr; };
 	virtual ConfigReader * configReader() = 0;
 
-    template<typename RetT>
-    bool callIfEnabled(RetT & ret, std::function<RetT()> func)
+    template<typename RetT, typename Func>
+    bool callIfEnabled(RetT & ret, Func func)
     {
         std::unique_lock<Application> __locker(*this);
         if(isEnabled())
@@ -72,8 +73,8 @@ public:
         return false;
     }
 
-    template<typename RetT>
-    RetT callIfEnabled(std::function<RetT()> func, const RetT & defaultRet)
+    template<typename RetT, typename Func>
+    RetT callIfEnabled(Func func, const RetT & defaultRet)
     {
         std::unique_lock<Application> __locker(*this);
         if(isEnabled())
@@ -82,7 +83,8 @@ public:
         return defaultRet;
     }
 
-    bool callIfEnabled(std::function<void()> func)
+    template<typename Func>
+    bool callIfEnabled(Func func)
     {
         std::unique_lock<Application> __locker(*this);
         if(isEnabled())
@@ -101,6 +103,8 @@ private:
     void unlock();
     bool isEnabled();
 
+    bool initWaves(const std::vector<Component*> & comps, std::vector<std::vector<Component*>> & waves, ErrorCollector & ec);
+
 	Application_priv * priv;
 };
 
@@ -0,0 +1,155 @@
+/*
+This file is part of sasCore.
+
+sasCore is free software: you can redistribute it and/or modify
+it under the terms of the Lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+sasCore is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with sasCore.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef sasCore__coalescer_h
+#define sasCore__coalescer_h
+
+#include "config.h"
+#include "defines.h"
+#include "errorcodes.h"
+#include "errorcollector.h"
+#include "logging.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace SAS {
+
+	// coalesces the calls of concurrent callers: the first waiting caller becomes the leader
+	// and sends every queued request in one call of the send function
+	// the requests are not copied, the callers are blocked until their responses arrive
+	template<class Request, class Response>
+	class Coalescer
+	{
+		SAS_COPY_PROTECTOR(Coalescer)
+
+	public:
+		typedef std::function<bool(const std::vector<const Request *> & requests, std::vector<Response> & responses, ErrorCollector & ec)> SendFunction;
+
+		Coalescer(const Logging::LoggerPtr & logger, const SendFunction & send, std::chrono::microseconds delay, size_t maxSize) :
+			_logger(logger),
+			_send(send),
+			_delay(delay),
+			_maxSize(maxSize ? maxSize : 1)
+		{ }
+
+		bool invoke(const Request & request, Response & response, ErrorCollector & ec)
+		{
+			SAS_LOG_NDC();
+
+			Item item;
+			item.request = &request;
+			item.response = &response;
+
+			std::unique_lock<std::mutex> __locker(_mut);
+			_queue.push_back(&item);
+			while (!item.done)
+			{
+				if (_flushing)
+				{
+					_cv.wait(__locker);
+					continue;
+				}
+
+				_flushing = true;
+				if (_delay.count())
+				{
+					__locker.unlock();
+					std::this_thread::sleep_for(_delay);
+					__locker.lock();
+				}
+
+				std::vector<Item*> items;
+				while (_queue.size() && items.size() < _maxSize)
+				{
+					items.push_back(_queue.front());
+					_queue.pop_front();
+				}
+				__locker.unlock();
+
+				SAS_LOG_TRACE(_logger, "sending " + std::to_string(items.size()) + " coalesced call(s)");
+
+				std::vector<const Request *> requests;
+				requests.reserve(items.size());
+				for (auto i : items)
+					requests.push_back(i->request);
+
+				std::vector<Response> responses;
+				std::vector<std::pair<long, std::string>> errors;
+				SimpleErrorCollector batch_ec([&errors](long errorCode, const std::string & errorText)
+				{
+					errors.push_back(std::make_pair(errorCode, errorText));
+				});
+				bool ok = _send(requests, responses, batch_ec);
+				if (ok && responses.size() != requests.size())
+				{
+					auto err = batch_ec.add(SAS_CORE__ERROR__CONNECTOR__UNEXPECTED_ERROR, "number of responses (" + std::to_string(responses.size()) + ") does not match number of requests (" + std::to_string(requests.size()) + ")");
+					SAS_LOG_ERROR(_logger, err);
+					ok = false;
+				}
+
+				__locker.lock();
+				for (size_t i = 0, l = items.size(); i < l; ++i)
+				{
+					if ((items[i]->ok = ok))
+						*items[i]->response = std::move(responses[i]);
+					else
+						items[i]->errors = errors;
+					items[i]->done = true;
+				}
+				_flushing = false;
+				_cv.notify_all();
+			}
+			__locker.unlock();
+
+			for (auto & e : item.errors)
+				ec.add(e.first, e.second);
+
+			return item.ok;
+		}
+
+	private:
+		struct Item
+		{
+			const Request * request;
+			Response * response;
+			bool done = false;
+			bool ok = false;
+			std::vector<std::pair<long, std::string>> errors;
+		};
+
+		Logging::LoggerPtr _logger;
+		SendFunction _send;
+		std::chrono::microseconds _delay;
+		size_t _maxSize;
+
+		std::mutex _mut;
+		std::condition_variable _cv;
+		std::deque<Item*> _queue;
+		bool _flushing = false;
+	};
+
+}
+
+#endif // sasCore__coalescer_h
@@ -21,6 +21,7 @@
 #include "defines.h"
 
 #include <string>
+#include <vector>
 #include <map>
 
 namespace SAS
@@ -40,6 +41,8 @@ namespace SAS
 		virtual inline std::string version() const { return std::string(); }
         virtual inline std::string vendor() const { return std::string(); }
         virtual inline std::map<std::string, std::string> customInfo() const { return std::map<std::string, std::string>(); }
+		// names of the components which have to be initialized before this one (SAS/PARALLEL_INIT)
+		virtual inline std::vector<std::string> dependencies() const { return std::vector<std::string>(); }
 
 		virtual bool init(Application * app, ErrorCollector & ec) = 0;
 
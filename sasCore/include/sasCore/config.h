@@ -46,5 +46,8 @@
 #define SAS_SESSION_MAX_COUNT 2000
 
 #define SAS_APP_SMART_LOCKING
+// in-flight calls are counted per thread group, it takes precedence over SAS_APP_SMART_LOCKING
+#define SAS_APP_SHARDED_LOCKING
+#define SAS_APP_LOCK_SHARDS 64
 
 #endif /* INCLUDE_SASCORE_CONFIG_H_ */
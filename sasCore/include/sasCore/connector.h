@@ -20,6 +20,7 @@
 
 #include "object.h"
 #include "invoker.h"
+#include "session.h"
 
 #define SAS_OBJECT_TYPE__CONNECTOR "connector"
 
@@ -35,6 +36,18 @@ public:
 	virtual inline ~Connection() { }
 
 	virtual bool getSession(ErrorCollector & ec) =  0;
+
+	// the remote session of the connection can be switched by connections which support it,
+	// this way a connection can be shared by several local sessions (see the connection pool of sasBypass)
+	virtual inline bool setSessionId(SessionID sid)
+	{ (void)sid; return false; }
+
+	virtual inline SessionID sessionId() const
+	{ return 0; }
+
+	// ends the current remote session
+	virtual inline bool endSession(ErrorCollector & ec)
+	{ (void)ec; return true; }
 };
 
 
@@ -50,6 +63,10 @@ public:
 
 	virtual bool connect(ErrorCollector & ec) = 0;
 
+	// the connector is connected and its calls do not have to wait for (re)connection
+	virtual inline bool isReady() const
+	{ return true; }
+
 	virtual bool getModuleInfo(const std::string & module_name, std::string & description, std::string & version, ErrorCollector & ec) = 0;
 
 	virtual Connection * createConnection(const std::string & module_name, const std::string & invoker_name, ErrorCollector & ec) = 0;
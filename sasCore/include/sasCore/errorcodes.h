@@ -56,9 +56,9 @@ along with sasCore.  If not, see <http://www.gnu.org/licenses/>
 #define SAS_CORE__ERROR__INTERFACE__UNEXPECTED_ERROR _SAS_CORE__ERROR_BASE_+34
 #define SAS_CORE__ERROR__MODULE__INIT_FAILURE  _SAS_CORE__ERROR_BASE_+35
 #define SAS_CORE__ERROR__MODULE__MISSING_CONFIG_ENTRY  _SAS_CORE__ERROR_BASE_+35
-//#define SAS_CORE__ERROR__  _SAS_CORE__ERROR_BASE_+36
-//#define SAS_CORE__ERROR__  _SAS_CORE__ERROR_BASE_+37
-//#define SAS_CORE__ERROR__  _SAS_CORE__ERROR_BASE_+38
+#define SAS_CORE__ERROR__MODULE__INVALID_CONFIG_VALUE  _SAS_CORE__ERROR_BASE_+36
+#define SAS_CORE__ERROR__APPLICATION__INVALID_DEPENDENCY  _SAS_CORE__ERROR_BASE_+37
+#define SAS_CORE__ERROR__MODULE__NOT_READY  _SAS_CORE__ERROR_BASE_+38
 //#define SAS_CORE__ERROR__  _SAS_CORE__ERROR_BASE_+39
 //#define SAS_CORE__ERROR__  _SAS_CORE__ERROR_BASE_+40
 //#define SAS_CORE__ERROR__  _SAS_CORE__ERROR_BASE_+41
@@ -19,6 +19,7 @@
 #define INCLUDE_SASCORE_INVOKER_H_
 
 #include <vector>
+#include <cstddef>
 #include "defines.h"
 
 namespace SAS
@@ -40,6 +41,10 @@ public:
 
 	virtual Status invoke(const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec) = 0;
 
+	// the input is given by a buffer owned by the caller (e.g. by a network library)
+	// the default implementation copies it into a vector, invokers which can process it in place should override it
+	virtual Status invokeBuffer(const char * input, size_t input_size, std::vector<char> & output, ErrorCollector & ec);
+
 private:
 	Invoker_priv * priv;
 };
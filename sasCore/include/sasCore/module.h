@@ -39,6 +39,9 @@ public:
 
 	virtual inline std::string description() const { return std::string(); }
 	virtual inline std::string version() const { return std::string(); }
+
+	// false while the module cannot serve requests yet (e.g. its backends are still connecting), the interfaces reject them meanwhile
+	virtual inline bool isReady() const { return true; }
 };
 
 }
@@ -35,14 +35,22 @@ namespace SAS {
 	class SAS_CORE__CLASS Session
 	{
 		SAS_COPY_PROTECTOR(Session)
+		friend class SessionManager;
 	public:
 		Session(SessionID id);
 		virtual ~Session();
 
 		Invoker::Status invoke(const std::string & invoker_name, const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec);
+		Invoker::Status invoke(const std::string & invoker_name, const char * input, size_t input_size, std::vector<char> & output, ErrorCollector & ec);
+
+		// the invoker lives as long as the session, so it can be cached by the caller
+		Invoker * invoker(const std::string & name, ErrorCollector & ec);
 
 		bool isActive();
 
+		// the session has been ended while it was pinned (see SessionManager::pinSession)
+		bool isEnded() const;
+
 		SessionID id() const;
 
 		bool try_lock();
@@ -53,6 +61,8 @@ namespace SAS {
 		virtual Invoker * getInvoker(const std::string & name, ErrorCollector & ec) = 0;
 
 	private:
+		void setEnded();
+
 		Session_priv * priv;
 	};
 
@@ -45,6 +45,12 @@ namespace SAS {
 		Session * getSession(SessionID sid, ErrorCollector & ec);
 		void endSession(SessionID sid);
 
+		// the session is returned unlocked and it is not deleted until it is unpinned,
+		// the caller has to serialize its calls and keep the pointer only until unpinSession();
+		// if the session is ended meanwhile, Session::isEnded() turns true and the last unpin deletes it
+		Session * pinSession(SessionID sid, ErrorCollector & ec);
+		void unpinSession(Session * session);
+
 	protected:
 		virtual Session * createSession(SessionID id, ErrorCollector & ec) = 0;
 
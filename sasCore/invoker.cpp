@@ -27,4 +27,10 @@ namespace SAS {
 	Invoker::~Invoker()
 	{ }
 
+	//virtual
+	Invoker::Status Invoker::invokeBuffer(const char * input, size_t input_size, std::vector<char> & output, ErrorCollector & ec)
+	{
+		return invoke(std::vector<char>(input, input + input_size), output, ec);
+	}
+
 }
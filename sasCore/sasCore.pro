@@ -65,6 +65,7 @@ SOURCES += \
 HEADERS += \
     include/sasCore/application.h \
     include/sasCore/basictypes.h \
+    include/sasCore/coalescer.h \
     include/sasCore/component.h \
     include/sasCore/componentloader.h \
     include/sasCore/config.h \
@@ -19,18 +19,20 @@
 #include <map>
 #include <chrono>
 #include <mutex>
+#include <atomic>
 #include <sstream>
 
 namespace SAS {
 
 	struct Session_priv
 	{
-		Session_priv(SessionID id_) : id(id_)
+		Session_priv(SessionID id_) : id(id_), ended(false)
 		{ }
 
         std::recursive_mutex active_mutex;
 
 		SessionID id;
+		std::atomic<bool> ended;
 	};
 
 	Session::Session(SessionID id) : priv(new Session_priv(id))
@@ -49,6 +51,29 @@ namespace SAS {
 		return inv->invoke(input, output, ec);
 	}
 
+	Invoker::Status Session::invoke(const std::string & invoker_name, const char * input, size_t input_size, std::vector<char> & output, ErrorCollector & ec)
+	{
+		Invoker * inv;
+		if(!(inv = getInvoker(invoker_name, ec)))
+			return Invoker::Status::FatalError;
+		return inv->invokeBuffer(input, input_size, output, ec);
+	}
+
+	Invoker * Session::invoker(const std::string & name, ErrorCollector & ec)
+	{
+		return getInvoker(name, ec);
+	}
+
+	bool Session::isEnded() const
+	{
+		return priv->ended;
+	}
+
+	void Session::setEnded()
+	{
+		priv->ended = true;
+	}
+
 	bool Session::isActive()
 	{
 		if(!priv->active_mutex.try_lock())
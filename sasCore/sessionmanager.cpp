@@ -43,7 +43,7 @@ namespace SAS {
 
 		struct SessionObject : public UniqueObjectManager::Object
 		{
-			SessionObject(Session * session_, std::chrono::seconds max_idletime_) : session(session_), max_idletime(max_idletime_)
+			SessionObject(Session * session_, std::chrono::seconds max_idletime_) : session(session_), max_idletime(max_idletime_), pins(0)
 			{ }
 
 			virtual ~SessionObject()
@@ -55,11 +55,17 @@ namespace SAS {
 			Session * session;
 
 			std::chrono::seconds max_idletime;
+
+			// guarded by the depot
+			unsigned long pins;
 		};
 
 		UniqueObjectManager * that;
 		std::chrono::seconds default_max_idletime;
 
+		// guarded by the depot, the ended ones are not in the depot any more
+		std::map<Session*, SessionObject*> pinned;
+
 		struct Cleaner : public TimerThread
 		{
             Cleaner(ThreadPool * pool, Priv * priv_) : TimerThread(pool), logger(Logging::getLogger("SAS.SessionManager.Cleaner")), priv(priv_)
@@ -78,7 +84,7 @@ namespace SAS {
 					{
 						auto so = dynamic_cast<SessionObject*>(it.second);
 						assert(so);
-						if (so->session->try_lock())
+						if (!so->pins && so->session->try_lock())
 						{
 							if (std::chrono::high_resolution_clock::now() - so->lastTouched() >= so->max_idletime)
 								to_be_deleted.push_back(std::pair<SessionID, SessionObject*>(it.first, so));
@@ -134,6 +140,13 @@ namespace SAS {
 		SAS_LOG_TRACE(priv->logger, "session cleaner thread has been ended");
 		SAS_LOG_TRACE(priv->logger, "remove all sessions");
 		clear();
+
+		std::unique_lock<Depot> __locker(depot());
+		if (priv->pinned.size())
+			SAS_LOG_WARN(priv->logger, "delete pinned sessions: " + std::to_string(priv->pinned.size()));
+		for (auto & p : priv->pinned)
+			delete p.second;
+		priv->pinned.clear();
 	}
 
 	Session * SessionManager::getSession(SessionID sid, ErrorCollector & ec)
@@ -158,6 +171,55 @@ namespace SAS {
 		unuse(sid);
 	}
 
+	Session * SessionManager::pinSession(SessionID sid, ErrorCollector & ec)
+	{
+		SAS_LOG_NDC();
+		std::unique_lock<Depot> __locker(depot());
+
+		Object * o;
+		if (!(o = getObject(sid, ec)))
+			return nullptr;
+
+		auto so = dynamic_cast<Priv::SessionObject*>(o);
+		assert(so);
+
+		if (!so->pins++)
+			priv->pinned[so->session] = so;
+		return so->session;
+	}
+
+	void SessionManager::unpinSession(Session * session)
+	{
+		SAS_LOG_NDC();
+		Priv::SessionObject * to_be_deleted = nullptr;
+		{
+			std::unique_lock<Depot> __locker(depot());
+
+			auto it = priv->pinned.find(session);
+			if (it == priv->pinned.end())
+				return;
+
+			auto so = it->second;
+			if (--so->pins)
+				return;
+			priv->pinned.erase(it);
+
+			if (session->isEnded())
+				to_be_deleted = so;
+			else
+				// the idle time is counted from the release
+				so->setLastTouched(std::chrono::high_resolution_clock::now());
+		}
+
+		if (to_be_deleted)
+		{
+			SAS_LOG_DEBUG(priv->logger, "delete ended session: " + std::to_string(session->id()));
+			session->lock();
+			session->unlock();
+			delete to_be_deleted;
+		}
+	}
+
 	SessionManager::Object * SessionManager::createObject(const UniqueId & id, ErrorCollector & ec)
 	{
 		Session * s;
@@ -171,6 +233,10 @@ namespace SAS {
 	{
 		auto so = dynamic_cast<Priv::SessionObject*>(o);
 		assert(so);
+		so->session->setEnded();
+		// it is deleted by the last unpinSession()
+		if (so->pins)
+			return;
 		so->session->lock();
 		so->session->unlock();
 		delete so;
@@ -0,0 +1,236 @@
+/*
+This file is part of sasHTTP.
+
+sasHTTP is free software: you can redistribute it and/or modify
+it under the terms of the Lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+sasHTTP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with sasHTTP.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "httpbatch.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace SAS { namespace HTTPBatch {
+
+	namespace {
+
+		template<typename T>
+		void put_int(std::vector<char> & data, T v)
+		{
+			for (int i = sizeof(T) - 1; i >= 0; --i)
+				data.push_back(static_cast<char>((static_cast<uint64_t>(v) >> (i * 8)) & 0xff));
+		}
+
+		template<typename T>
+		void put_bytes(std::vector<char> & data, const char * bytes, size_t size)
+		{
+			put_int<T>(data, static_cast<T>(size));
+			data.insert(data.end(), bytes, bytes + size);
+		}
+
+		class Reader
+		{
+			const std::vector<char> & _data;
+			size_t _idx = 0;
+		public:
+			Reader(const std::vector<char> & data) : _data(data)
+			{ }
+
+			template<typename T>
+			bool get_int(T & v)
+			{
+				if (_data.size() - _idx < sizeof(T))
+					return false;
+				uint64_t tmp = 0;
+				for (size_t i = 0; i < sizeof(T); ++i)
+					tmp = (tmp << 8) | static_cast<unsigned char>(_data[_idx++]);
+				v = static_cast<T>(tmp);
+				return true;
+			}
+
+			template<typename L, typename C>
+			bool get_bytes(C & ret)
+			{
+				L size;
+				if (!get_int(size) || _data.size() - _idx < size)
+					return false;
+				ret.assign(_data.data() + _idx, _data.data() + _idx + size);
+				_idx += size;
+				return true;
+			}
+
+			bool atEnd() const
+			{
+				return _idx == _data.size();
+			}
+		};
+
+		bool invalid(const char * what, ErrorCollector & ec)
+		{
+			ec.add(-1, std::string() + "invalid batch message: " + what);
+			return false;
+		}
+
+	}
+
+	bool check(const HTTPBatchRequest & request, ErrorCollector & ec)
+	{
+		if (request.module.size() > std::numeric_limits<uint16_t>::max())
+		{
+			ec.add(-1, "module name is too long for batch message (" + std::to_string(request.module.size()) + " bytes)");
+			return false;
+		}
+		if (request.invoker.size() > std::numeric_limits<uint16_t>::max())
+		{
+			ec.add(-1, "invoker name is too long for batch message (" + std::to_string(request.invoker.size()) + " bytes)");
+			return false;
+		}
+		if (request.input.size() > std::numeric_limits<uint32_t>::max())
+		{
+			ec.add(-1, "input is too large for batch message (" + std::to_string(request.input.size()) + " bytes)");
+			return false;
+		}
+		return true;
+	}
+
+	bool encode(const std::vector<HTTPBatchRequest> & requests, std::vector<char> & data, ErrorCollector & ec)
+	{
+		std::vector<const HTTPBatchRequest *> refs;
+		refs.reserve(requests.size());
+		for (auto & r : requests)
+			refs.push_back(&r);
+		return encode(refs, data, ec);
+	}
+
+	bool encode(const std::vector<const HTTPBatchRequest *> & requests, std::vector<char> & data, ErrorCollector & ec)
+	{
+		size_t size = 4;
+		for (auto r : requests)
+		{
+			if (!check(*r, ec))
+				return false;
+			size += 16 + r->module.size() + r->invoker.size() + r->input.size();
+		}
+		data.clear();
+		data.reserve(size);
+
+		put_int<uint32_t>(data, static_cast<uint32_t>(requests.size()));
+		for (auto r : requests)
+		{
+			put_bytes<uint16_t>(data, r->module.data(), r->module.size());
+			put_int<uint64_t>(data, static_cast<uint64_t>(r->sid));
+			put_bytes<uint16_t>(data, r->invoker.data(), r->invoker.size());
+			put_bytes<uint32_t>(data, r->input.data(), r->input.size());
+		}
+		return true;
+	}
+
+	bool decode(const std::vector<char> & data, std::vector<HTTPBatchRequest> & requests, ErrorCollector & ec)
+	{
+		Reader r(data);
+		uint32_t count;
+		if (!r.get_int(count))
+			return invalid("missing entry count", ec);
+		if (count > data.size() / 16)
+			return invalid("entry count exceeds message size", ec);
+
+		requests.clear();
+		requests.resize(count);
+		for (auto & req : requests)
+		{
+			uint64_t sid;
+			if (!r.get_bytes<uint16_t>(req.module) ||
+				!r.get_int(sid) ||
+				!r.get_bytes<uint16_t>(req.invoker) ||
+				!r.get_bytes<uint32_t>(req.input))
+				return invalid("truncated request entry", ec);
+			req.sid = static_cast<SessionID>(sid);
+		}
+		if (!r.atEnd())
+			return invalid("unexpected trailing data", ec);
+		return true;
+	}
+
+	void encode(const std::vector<HTTPBatchResponse> & responses, std::vector<char> & data)
+	{
+		size_t size = 4;
+		for (auto & r : responses)
+		{
+			size += 17 + r.output.size();
+			for (auto & e : r.errors)
+				size += 8 + e.second.size();
+		}
+		data.clear();
+		data.reserve(size);
+
+		put_int<uint32_t>(data, static_cast<uint32_t>(responses.size()));
+		for (auto & r : responses)
+		{
+			put_int<uint64_t>(data, static_cast<uint64_t>(r.sid));
+			put_int<uint8_t>(data, static_cast<uint8_t>(r.status));
+			put_bytes<uint32_t>(data, r.output.data(), r.output.size());
+			put_int<uint32_t>(data, static_cast<uint32_t>(r.errors.size()));
+			for (auto & e : r.errors)
+			{
+				put_int<int32_t>(data, static_cast<int32_t>(e.first));
+				put_bytes<uint32_t>(data, e.second.data(), e.second.size());
+			}
+		}
+	}
+
+	bool decode(const std::vector<char> & data, std::vector<HTTPBatchResponse> & responses, ErrorCollector & ec)
+	{
+		Reader r(data);
+		uint32_t count;
+		if (!r.get_int(count))
+			return invalid("missing entry count", ec);
+		if (count > data.size() / 17)
+			return invalid("entry count exceeds message size", ec);
+
+		responses.clear();
+		responses.resize(count);
+		for (auto & resp : responses)
+		{
+			uint64_t sid;
+			uint8_t status;
+			uint32_t error_count;
+			if (!r.get_int(sid) ||
+				!r.get_int(status) ||
+				!r.get_bytes<uint32_t>(resp.output) ||
+				!r.get_int(error_count))
+				return invalid("truncated response entry", ec);
+			if (status > static_cast<uint8_t>(Invoker::Status::NotImplemented))
+				return invalid("unknown status", ec);
+			resp.sid = static_cast<SessionID>(sid);
+			resp.status = static_cast<Invoker::Status>(status);
+			for (uint32_t i = 0; i < error_count; ++i)
+			{
+				int32_t code;
+				std::string text;
+				if (!r.get_int(code) || !r.get_bytes<uint32_t>(text))
+					return invalid("truncated error entry", ec);
+				resp.errors.push_back(std::make_pair(static_cast<long>(code), text));
+			}
+		}
+		if (!r.atEnd())
+			return invalid("unexpected trailing data", ec);
+		return true;
+	}
+
+	void EntryErrorCollector::append(long errorCode, const std::string & errorText)
+	{
+		_resp.errors.push_back(std::make_pair(errorCode, errorText));
+	}
+
+} }
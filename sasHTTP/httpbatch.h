@@ -0,0 +1,87 @@
+/*
+This file is part of sasHTTP.
+
+sasHTTP is free software: you can redistribute it and/or modify
+it under the terms of the Lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+sasHTTP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with sasHTTP.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef sasHTTP__httpbatch_h
+#define sasHTTP__httpbatch_h
+
+#include "config.h"
+
+#include <sasCore/invoker.h>
+#include <sasCore/errorcollector.h>
+#include <sasCore/session.h>
+
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace SAS {
+
+	// one entry of a 'batch' request
+	struct HTTPBatchRequest
+	{
+		std::string module;
+		SessionID sid = 0;
+		std::string invoker;
+		std::vector<char> input;
+	};
+
+	// result of one entry of a 'batch' request
+	struct HTTPBatchResponse
+	{
+		SessionID sid = 0;
+		Invoker::Status status = Invoker::Status::Error;
+		std::vector<char> output;
+		std::vector<std::pair<long, std::string>> errors;
+	};
+
+	/*
+	 * Framing of the 'batch' message body (all integers are big-endian):
+	 *
+	 *   request:  u32 count, count * { u16 len, module, u64 sid, u16 len, invoker, u32 len, input }
+	 *   response: u32 count, count * { u64 sid, u8 status, u32 len, output,
+	 *                                   u32 error_count, error_count * { i32 code, u32 len, text } }
+	 *
+	 * Responses are in the same order as the requests.
+	 */
+	namespace HTTPBatch {
+
+		// checks whether the entry fits into the framing (module and invoker names are at most 65535 bytes long)
+		bool check(const HTTPBatchRequest & request, ErrorCollector & ec);
+
+		bool encode(const std::vector<HTTPBatchRequest> & requests, std::vector<char> & data, ErrorCollector & ec);
+		bool encode(const std::vector<const HTTPBatchRequest *> & requests, std::vector<char> & data, ErrorCollector & ec);
+		bool decode(const std::vector<char> & data, std::vector<HTTPBatchRequest> & requests, ErrorCollector & ec);
+
+		void encode(const std::vector<HTTPBatchResponse> & responses, std::vector<char> & data);
+		bool decode(const std::vector<char> & data, std::vector<HTTPBatchResponse> & responses, ErrorCollector & ec);
+
+		// collector which stores the errors of one entry
+		class EntryErrorCollector : public ErrorCollector
+		{
+			HTTPBatchResponse & _resp;
+		public:
+			inline EntryErrorCollector(HTTPBatchResponse & resp) : _resp(resp)
+			{ }
+		protected:
+			virtual void append(long errorCode, const std::string & errorText) final;
+		};
+
+	}
+
+}
+
+#endif // sasHTTP__httpbatch_h
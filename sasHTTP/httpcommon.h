@@ -18,6 +18,10 @@ along with sasHTTP.  If not, see <http://www.gnu.org/licenses/>
 #ifndef sasHTTP__httpcommon_h
 #define sasHTTP__httpcommon_h
 
+#include <string>
+#include <vector>
+#include <utility>
+
 namespace SAS {
 
 	enum class HTTPMethod
@@ -26,6 +30,8 @@ namespace SAS {
 		GET, POST, PUT
 	};
 
+	typedef std::vector<std::pair<std::string, std::string>> HTTPHeaders;
+
 }
 
 #endif // sasHTTP__httpcommon_h
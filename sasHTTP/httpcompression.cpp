@@ -0,0 +1,416 @@
+/*
+This file is part of sasHTTP.
+
+sasHTTP is free software: you can redistribute it and/or modify
+it under the terms of the Lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+sasHTTP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with sasHTTP.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "httpcompression.h"
+
+#include <sasCore/errorcollector.h>
+#include <sasCore/configreader.h>
+
+#include <zlib.h>
+#ifdef SAS_HTTP__HAVE_ZSTD
+#  include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <limits>
+
+namespace SAS {
+
+	bool HTTPCompressionOptions::build(const std::string & path, ConfigReader * cr, ErrorCollector & ec)
+	{
+		std::vector<std::string> names;
+		if (!cr->getStringListEntry(path + "/COMPRESSION", names, std::vector<std::string>(), ec))
+			return false;
+
+		encodings.clear();
+		for (auto & name : names)
+		{
+			HTTPEncoding encoding;
+			if (!HTTPCompression::fromString(name, encoding))
+			{
+				ec.add(-1, "invalid value of 'COMPRESSION': '" + name + "'");
+				return false;
+			}
+			if (encoding != HTTPEncoding::Identity)
+				encodings.push_back(encoding);
+		}
+
+		long long tmp;
+		if (!cr->getNumberEntry(path + "/COMPRESSION_THRESHOLD", tmp, 1024, ec))
+			return false;
+		threshold = tmp > 0 ? static_cast<size_t>(tmp) : 0;
+
+		if (!cr->getNumberEntry(path + "/COMPRESSION_LEVEL", tmp, -1, ec))
+			return false;
+		level = static_cast<int>(tmp);
+
+		if (!cr->getNumberEntry(path + "/COMPRESSION_MAX_SIZE", tmp, 64 * 1024 * 1024, ec))
+			return false;
+		maxDecompressedSize = tmp > 0 ? static_cast<size_t>(tmp) : 0;
+
+		return true;
+	}
+
+	namespace HTTPCompression {
+
+		namespace {
+
+			std::string to_lower(std::string str)
+			{
+				std::transform(str.begin(), str.end(), str.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+				return str;
+			}
+
+			std::string trim(const std::string & str)
+			{
+				auto b = str.find_first_not_of(" \t");
+				if (b == std::string::npos)
+					return std::string();
+				return str.substr(b, str.find_last_not_of(" \t") - b + 1);
+			}
+
+			// size of the output buffer which can hold one byte more than the limit, so exceeding it is detected
+			size_t buffer_limit(size_t max_size)
+			{
+				return max_size && max_size < std::numeric_limits<size_t>::max() ? max_size + 1 : std::numeric_limits<size_t>::max();
+			}
+
+			bool check_size(size_t size, size_t max_size, bool & limit_exceeded, ErrorCollector & ec)
+			{
+				if (max_size && size > max_size)
+				{
+					limit_exceeded = true;
+					ec.add(-1, "decompressed data is longer than " + std::to_string(max_size) + " bytes");
+					return false;
+				}
+				return true;
+			}
+
+			bool grow(std::vector<char> & output, size_t max_size, bool & limit_exceeded, ErrorCollector & ec)
+			{
+				auto limit = buffer_limit(max_size);
+				if (output.size() >= limit && !check_size(output.size(), max_size, limit_exceeded, ec))
+					return false;
+				output.resize(output.size() > limit / 2 ? limit : output.size() * 2);
+				return true;
+			}
+
+			bool zlib_compress(int window_bits, int level, const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec)
+			{
+				if (input.size() > std::numeric_limits<uInt>::max())
+				{
+					ec.add(-1, "input is too large for compression");
+					return false;
+				}
+
+				z_stream strm = {};
+				if (deflateInit2(&strm, level < 0 ? Z_DEFAULT_COMPRESSION : std::min(level, 9), Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+				{
+					ec.add(-1, "could not initialize zlib compressor");
+					return false;
+				}
+
+				output.resize(deflateBound(&strm, static_cast<uLong>(input.size())));
+				strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+				strm.avail_in = static_cast<uInt>(input.size());
+				strm.next_out = reinterpret_cast<Bytef*>(output.data());
+				strm.avail_out = static_cast<uInt>(output.size());
+
+				auto ret = deflate(&strm, Z_FINISH);
+				output.resize(strm.total_out);
+				deflateEnd(&strm);
+
+				if (ret != Z_STREAM_END)
+				{
+					ec.add(-1, "zlib compression error (" + std::to_string(ret) + ")");
+					return false;
+				}
+				return true;
+			}
+
+			bool zlib_decompress(int window_bits, const std::vector<char> & input, size_t max_size, std::vector<char> & output, bool & limit_exceeded, ErrorCollector & ec)
+			{
+				if (input.size() > std::numeric_limits<uInt>::max())
+				{
+					ec.add(-1, "input is too large for decompression");
+					return false;
+				}
+
+				z_stream strm = {};
+				if (inflateInit2(&strm, window_bits) != Z_OK)
+				{
+					ec.add(-1, "could not initialize zlib decompressor");
+					return false;
+				}
+
+				output.resize(std::min(std::max<size_t>(input.size() * 4, 1024), buffer_limit(max_size)));
+				strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+				strm.avail_in = static_cast<uInt>(input.size());
+
+				int ret;
+				do
+				{
+					if (output.size() == strm.total_out && !grow(output, max_size, limit_exceeded, ec))
+					{
+						inflateEnd(&strm);
+						output.clear();
+						return false;
+					}
+					strm.next_out = reinterpret_cast<Bytef*>(output.data()) + strm.total_out;
+					strm.avail_out = static_cast<uInt>(std::min<size_t>(output.size() - strm.total_out, std::numeric_limits<uInt>::max()));
+					ret = inflate(&strm, Z_NO_FLUSH);
+				} while (ret == Z_OK);
+
+				output.resize(strm.total_out);
+				inflateEnd(&strm);
+
+				if (!check_size(output.size(), max_size, limit_exceeded, ec))
+				{
+					output.clear();
+					return false;
+				}
+
+				if (ret != Z_STREAM_END)
+				{
+					ec.add(-1, "zlib decompression error (" + std::to_string(ret) + ")");
+					return false;
+				}
+				return true;
+			}
+
+#ifdef SAS_HTTP__HAVE_ZSTD
+			bool zstd_compress(int level, const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec)
+			{
+				output.resize(ZSTD_compressBound(input.size()));
+				auto ret = ZSTD_compress(output.data(), output.size(), input.data(), input.size(), level < 0 ? ZSTD_CLEVEL_DEFAULT : level);
+				if (ZSTD_isError(ret))
+				{
+					ec.add(-1, std::string() + "zstd compression error: '" + ZSTD_getErrorName(ret) + "'");
+					return false;
+				}
+				output.resize(ret);
+				return true;
+			}
+
+			bool zstd_decompress(const std::vector<char> & input, size_t max_size, std::vector<char> & output, bool & limit_exceeded, ErrorCollector & ec)
+			{
+				auto dctx = ZSTD_createDStream();
+				if (!dctx)
+				{
+					ec.add(-1, "could not initialize zstd decompressor");
+					return false;
+				}
+
+				ZSTD_inBuffer in = { input.data(), input.size(), 0 };
+				output.resize(std::min(std::max<size_t>(input.size() * 4, ZSTD_DStreamOutSize()), buffer_limit(max_size)));
+				size_t pos = 0;
+				size_t ret;
+				do
+				{
+					if (output.size() == pos && !grow(output, max_size, limit_exceeded, ec))
+					{
+						ZSTD_freeDStream(dctx);
+						output.clear();
+						return false;
+					}
+					ZSTD_outBuffer out = { output.data() + pos, output.size() - pos, 0 };
+					ret = ZSTD_decompressStream(dctx, &out, &in);
+					pos += out.pos;
+				} while (!ZSTD_isError(ret) && ret && (in.pos < in.size || pos == output.size()));
+				ZSTD_freeDStream(dctx);
+
+				output.resize(pos);
+				if (!check_size(pos, max_size, limit_exceeded, ec))
+				{
+					output.clear();
+					return false;
+				}
+				if (ZSTD_isError(ret))
+				{
+					ec.add(-1, std::string() + "zstd decompression error: '" + ZSTD_getErrorName(ret) + "'");
+					return false;
+				}
+				if (ret)
+				{
+					ec.add(-1, "truncated zstd frame");
+					return false;
+				}
+				return true;
+			}
+#endif
+
+		}
+
+		const char * toString(HTTPEncoding encoding)
+		{
+			switch (encoding)
+			{
+			case HTTPEncoding::Identity:
+				return "identity";
+			case HTTPEncoding::Deflate:
+				return "deflate";
+			case HTTPEncoding::GZip:
+				return "gzip";
+			case HTTPEncoding::Zstd:
+				return "zstd";
+			}
+			return "identity";
+		}
+
+		bool fromString(const std::string & str, HTTPEncoding & encoding)
+		{
+			auto s = to_lower(trim(str));
+			if (s == "identity")
+				encoding = HTTPEncoding::Identity;
+			else if (s == "deflate")
+				encoding = HTTPEncoding::Deflate;
+			else if (s == "gzip" || s == "x-gzip")
+				encoding = HTTPEncoding::GZip;
+#ifdef SAS_HTTP__HAVE_ZSTD
+			else if (s == "zstd")
+				encoding = HTTPEncoding::Zstd;
+#endif
+			else
+				return false;
+			return true;
+		}
+
+		std::string acceptEncoding(const std::vector<HTTPEncoding> & encodings)
+		{
+			std::string ret;
+			for (auto e : encodings)
+			{
+				if (ret.length())
+					ret += ", ";
+				ret += toString(e);
+			}
+			return ret;
+		}
+
+		HTTPEncoding negotiate(const char * accept_encoding, const std::vector<HTTPEncoding> & encodings)
+		{
+			if (!accept_encoding || !encodings.size())
+				return HTTPEncoding::Identity;
+
+			std::vector<std::pair<std::string, bool>> accepted;
+			std::string header(accept_encoding);
+			size_t b = 0;
+			while (b <= header.length())
+			{
+				auto e = header.find(',', b);
+				if (e == std::string::npos)
+					e = header.length();
+				auto item = header.substr(b, e - b);
+				b = e + 1;
+
+				bool acceptable = true;
+				auto sc = item.find(';');
+				if (sc != std::string::npos)
+				{
+					auto param = to_lower(trim(item.substr(sc + 1)));
+					if (param.compare(0, 2, "q=") == 0)
+						acceptable = std::strtod(param.c_str() + 2, nullptr) > 0;
+					item = item.substr(0, sc);
+				}
+				item = to_lower(trim(item));
+				if (item.length())
+					accepted.push_back(std::make_pair(item, acceptable));
+			}
+
+			for (auto e : encodings)
+			{
+				std::string name = toString(e);
+				bool found = false, wildcard = false;
+				for (auto & a : accepted)
+				{
+					if (a.first == name || (e == HTTPEncoding::GZip && a.first == "x-gzip"))
+					{
+						found = true;
+						if (a.second)
+							return e;
+					}
+					else if (a.first == "*")
+						wildcard = a.second;
+				}
+				if (!found && wildcard)
+					return e;
+			}
+
+			return HTTPEncoding::Identity;
+		}
+
+		bool compress(HTTPEncoding encoding, int level, const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec)
+		{
+			switch (encoding)
+			{
+			case HTTPEncoding::Identity:
+				output = input;
+				return true;
+			case HTTPEncoding::Deflate:
+				return zlib_compress(MAX_WBITS, level, input, output, ec);
+			case HTTPEncoding::GZip:
+				return zlib_compress(MAX_WBITS + 16, level, input, output, ec);
+			case HTTPEncoding::Zstd:
+#ifdef SAS_HTTP__HAVE_ZSTD
+				return zstd_compress(level, input, output, ec);
+#else
+				break;
+#endif
+			}
+			ec.add(-1, std::string() + "not supported content encoding: '" + toString(encoding) + "'");
+			return false;
+		}
+
+		bool decompress(HTTPEncoding encoding, const std::vector<char> & input, size_t max_size, std::vector<char> & output, bool & limit_exceeded, ErrorCollector & ec)
+		{
+			limit_exceeded = false;
+			switch (encoding)
+			{
+			case HTTPEncoding::Identity:
+				output = input;
+				return true;
+			case HTTPEncoding::Deflate:
+				{
+					// some peers send raw deflate data instead of the zlib format required by the RFC
+					NullEC nec;
+					if (zlib_decompress(MAX_WBITS, input, max_size, output, limit_exceeded, nec))
+						return true;
+					if (limit_exceeded)
+					{
+						ec.add(-1, "decompressed data is longer than " + std::to_string(max_size) + " bytes");
+						return false;
+					}
+					return zlib_decompress(-MAX_WBITS, input, max_size, output, limit_exceeded, ec);
+				}
+			case HTTPEncoding::GZip:
+				return zlib_decompress(MAX_WBITS + 16, input, max_size, output, limit_exceeded, ec);
+			case HTTPEncoding::Zstd:
+#ifdef SAS_HTTP__HAVE_ZSTD
+				return zstd_decompress(input, max_size, output, limit_exceeded, ec);
+#else
+				break;
+#endif
+			}
+			ec.add(-1, std::string() + "not supported content encoding: '" + toString(encoding) + "'");
+			return false;
+		}
+
+	}
+
+}
@@ -0,0 +1,65 @@
+/*
+This file is part of sasHTTP.
+
+sasHTTP is free software: you can redistribute it and/or modify
+it under the terms of the Lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+sasHTTP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with sasHTTP.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef sasHTTP__httpcompression_h
+#define sasHTTP__httpcompression_h
+
+#include "config.h"
+
+#include <string>
+#include <vector>
+
+namespace SAS {
+
+	class ErrorCollector;
+	class ConfigReader;
+
+	enum class HTTPEncoding
+	{
+		Identity, Deflate, GZip, Zstd
+	};
+
+	struct HTTPCompressionOptions
+	{
+		std::vector<HTTPEncoding> encodings; // in order of preference, empty means compression is disabled
+		size_t threshold = 1024; // bytes
+		int level = -1; // -1: default level of the algorithm
+		size_t maxDecompressedSize = 64 * 1024 * 1024; // bytes, 0 means no limit
+
+		bool build(const std::string & path, ConfigReader * cr, ErrorCollector & ec);
+	};
+
+	namespace HTTPCompression {
+
+		const char * toString(HTTPEncoding encoding);
+		bool fromString(const std::string & str, HTTPEncoding & encoding);
+
+		// value of the 'Accept-Encoding' header
+		std::string acceptEncoding(const std::vector<HTTPEncoding> & encodings);
+
+		// selects the first element of 'encodings' which is acceptable by the 'Accept-Encoding' header value
+		HTTPEncoding negotiate(const char * accept_encoding, const std::vector<HTTPEncoding> & encodings);
+
+		bool compress(HTTPEncoding encoding, int level, const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec);
+		// fails with 'limit_exceeded' set when the decompressed data would be longer than 'max_size' (0 means no limit)
+		bool decompress(HTTPEncoding encoding, const std::vector<char> & input, size_t max_size, std::vector<char> & output, bool & limit_exceeded, ErrorCollector & ec);
+
+	}
+
+}
+
+#endif // sasHTTP__httpcompression_h
@@ -17,6 +17,8 @@ along with sasHTTP.  If not, see <http://www.gnu.org/licenses/>
 
 #include "httpconnector.h"
 #include "httpcommon.h"
+#include "httpcompression.h"
+#include "httpunixsocket.h"
 
 #include <sasCore/logging.h>
 #include <sasCore/application.h>
@@ -24,6 +26,7 @@ along with sasHTTP.  If not, see <http://www.gnu.org/licenses/>
 #include <sasCore/tools.h>
 #include <sasCore/configreader.h>
 #include <sasCore/session.h>
+#include <sasCore/coalescer.h>
 
 #include <rapidjson/document.h>
 
@@ -34,6 +37,9 @@ along with sasHTTP.  If not, see <http://www.gnu.org/licenses/>
 
 #include <sstream>
 #include <mutex>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 
 #include "assert.h"
 
@@ -47,6 +53,14 @@ namespace SAS {
 		HTTPMethod method_invoke;
 		HTTPMethod method_control;
 
+		bool batch = false;
+		std::chrono::microseconds batchDelay = std::chrono::microseconds(0);
+		size_t batchMaxSize = 64;
+
+		HTTPCompressionOptions compression;
+
+		std::chrono::seconds timeout = std::chrono::seconds(120);
+
         bool build(const std::string & path, ConfigReader * cr, ErrorCollector & ec)
         {
             std::string tmp;
@@ -98,6 +112,30 @@ namespace SAS {
 				return false;
 			}
 
+			if (!cr->getBoolEntry(path + "/BATCH", batch, false, ec))
+				return false;
+
+			long long tmp_ll;
+			if (!cr->getNumberEntry(path + "/BATCH_DELAY", tmp_ll, 0, ec))
+				return false;
+			batchDelay = std::chrono::microseconds(tmp_ll > 0 ? tmp_ll : 0);
+
+			if (!cr->getNumberEntry(path + "/BATCH_MAX_SIZE", tmp_ll, 64, ec))
+				return false;
+			if (tmp_ll <= 0)
+			{
+				ec.add(-1, std::string() + "invalid value of 'BATCH_MAX_SIZE': '" + std::to_string(tmp_ll) + "'");
+				return false;
+			}
+			batchMaxSize = static_cast<size_t>(tmp_ll);
+
+			if (!cr->getNumberEntry(path + "/TIMEOUT", tmp_ll, 120, ec))
+				return false;
+			timeout = std::chrono::seconds(tmp_ll > 0 ? tmp_ll : 0);
+
+			if (!compression.build(path, cr, ec))
+				return false;
+
 			return true;
 		}
 	};
@@ -110,6 +148,9 @@ namespace SAS {
 		HTTPConnectionOptions _options;
 
 		ne_session *_sess = nullptr;
+#ifdef SAS_HTTP__HAVE_UNIX_SOCKET
+		std::unique_ptr<HTTPUnixSocketClient> _unix;
+#endif
 	public:
 		HTTPCaller(const std::string & module, const std::string & name) :
 			_logger(Logging::getLogger("SAS.HTTPCaller." + module + "." + name)),
@@ -131,6 +172,21 @@ namespace SAS {
                 return false;
             }
 
+#ifdef SAS_HTTP__HAVE_UNIX_SOCKET
+			if (HTTPUnixSocketClient::isUnixURL(options.baseURL))
+			{
+				auto path = HTTPUnixSocketClient::socketPath(options.baseURL);
+				if (!path.length())
+				{
+					auto err = ec.add(-1, "unix socket path is empty in base url");
+					SAS_LOG_ERROR(_logger, err);
+					return false;
+				}
+				_unix.reset(new HTTPUnixSocketClient(path, options.timeout));
+				return true;
+			}
+#endif
+
 			ne_uri uri;
             if(ne_uri_parse(options.baseURL.c_str(), &uri) != 0 || !uri.scheme || !uri.host)
             {
@@ -143,6 +199,8 @@ namespace SAS {
 			_sess = ne_session_create(uri.scheme, uri.host, uri.port);
 			SAS_LOG_TRACE(_logger, "ne_set_useragent");
 			ne_set_useragent(_sess, "SAS/1.0");
+			ne_set_read_timeout(_sess, static_cast<int>(options.timeout.count()));
+			ne_set_connect_timeout(_sess, static_cast<int>(options.timeout.count()));
             ne_uri_free(&uri);
 
 			return true;
@@ -176,6 +234,9 @@ namespace SAS {
                 ne_session_destroy(_sess);
                 _sess = nullptr;
             }
+#ifdef SAS_HTTP__HAVE_UNIX_SOCKET
+			_unix.reset();
+#endif
 		}
 
 		bool msg_exchange(HTTPMethod method, /*in-out*/ SessionID & sid, const std::string & invoker, const std::string & mode, const std::vector<char> & input, std::vector<char> & output, Invoker::Status & status, ErrorCollector & ec)
@@ -183,50 +244,59 @@ namespace SAS {
 			SAS_LOG_NDC();
 			std::unique_lock<std::mutex> __locker(mut);
 
+#ifdef SAS_HTTP__HAVE_UNIX_SOCKET
+            if(!_sess && !_unix)
+#else
             if(!_sess)
+#endif
             {
                 auto err = ec.add(-1, "http session is null");
                 SAS_LOG_ERROR(_logger, err);
                 return false;
             }
 
-			ne_request * req = nullptr;
-			switch (method)
+			auto & compression = _options.compression;
+			auto body_encoding = HTTPEncoding::Identity;
+			std::vector<char> compressed_input;
+			const std::vector<char> * body = &input;
+			if (compression.encodings.size() && input.size() >= compression.threshold && method != HTTPMethod::GET)
 			{
-			case HTTPMethod::POST:
-			case HTTPMethod::PUT:
-				SAS_LOG_TRACE(_logger, "ne_request_create");
-				req = ne_request_create(_sess, "PUT", ("/" + _module + "?mode=" + mode).c_str());
-				SAS_LOG_TRACE(_logger, "ne_add_request_header");
-				ne_add_request_header(req, "Content-type", _options.contentType.c_str());
-				SAS_LOG_TRACE(_logger, "ne_add_request_header");
-				ne_add_request_header(req, "Content-Length", std::to_string(input.size()).c_str());
-				if (sid)
+				NullEC nec;
+				if (!HTTPCompression::compress(compression.encodings.front(), compression.level, input, compressed_input, nec))
 				{
-					SAS_LOG_TRACE(_logger, "ne_add_request_header");
-					ne_add_request_header(req, "SID", std::to_string((unsigned long long) sid).c_str());
+					SAS_LOG_WARN(_logger, "could not compress request, it is sent uncompressed");
 				}
-
-				if (invoker.length())
+				else if (compressed_input.size() < input.size())
 				{
-					SAS_LOG_TRACE(_logger, "ne_add_request_header");
-					ne_add_request_header(req, "Invoker", invoker.c_str());
+					body_encoding = compression.encodings.front();
+					body = &compressed_input;
 				}
+			}
 
-				SAS_LOG_TRACE(_logger, "ne_set_request_body_buffer");
-				ne_set_request_body_buffer(req, input.data(), input.size());
+			const char * method_str = nullptr;
+			std::string url = "/" + _module + "?mode=" + mode;
+			HTTPHeaders headers;
+			switch (method)
+			{
+			case HTTPMethod::POST:
+			case HTTPMethod::PUT:
+				method_str = "PUT";
+				headers.push_back(std::make_pair("Content-type", _options.contentType));
+				headers.push_back(std::make_pair("Content-Length", std::to_string(body->size())));
+				if (body_encoding != HTTPEncoding::Identity)
+					headers.push_back(std::make_pair("Content-Encoding", HTTPCompression::toString(body_encoding)));
+				if (sid)
+					headers.push_back(std::make_pair("SID", std::to_string((unsigned long long) sid)));
+				if (invoker.length())
+					headers.push_back(std::make_pair("Invoker", invoker));
 				break;
 			case HTTPMethod::GET:
-				{
-					std::string url = "/" + _module + "?mode=" + mode;
-					if (sid)
-						url += "&sid=" + std::to_string((unsigned long long) sid);
-					if (invoker.length())
-						url += "&invoker=" + invoker;
-
-					SAS_LOG_TRACE(_logger, "ne_request_create");
-					req = ne_request_create(_sess, "GET", url.c_str());
-				}
+				method_str = "GET";
+				body = nullptr;
+				if (sid)
+					url += "&sid=" + std::to_string((unsigned long long) sid);
+				if (invoker.length())
+					url += "&invoker=" + invoker;
 				break;
 			case HTTPMethod::None:
 				{
@@ -236,44 +306,40 @@ namespace SAS {
 				return false;
 			}
 
-			auto _accept = [](void *userdata, ne_request *req, const ne_status *st) -> int
-			{
-                (void)userdata;
-                (void)req;
-                (void)st;
-				return 1;
-			};
+			if (compression.encodings.size())
+				headers.push_back(std::make_pair("Accept-Encoding", HTTPCompression::acceptEncoding(compression.encodings)));
 
-			auto _reader = [](void *userdata, const char *buf, size_t len) -> int
+			int status_code;
+			HTTPHeaders response_headers;
+#ifdef SAS_HTTP__HAVE_UNIX_SOCKET
+			if (_unix)
 			{
-				auto output_buffer = (std::list<std::vector<char>>*) userdata;
-				std::vector<char> _buff(len);
-				memcpy(_buff.data(), buf, len);
-				output_buffer->push_back(_buff);
-
-				return 0;
-			};
-
-			std::list<std::vector<char>> _output_buffer;
-
-			SAS_LOG_ASSERT(_logger, req, "HTTP request has not been created");
-
-			SAS_LOG_TRACE(_logger, "ne_add_response_body_reader");
-			ne_add_response_body_reader(req, _accept, _reader, &_output_buffer);
+				SAS_LOG_TRACE(_logger, "unix socket request");
+				if (!_unix->request(method_str, url, headers, body ? body->data() : nullptr, body ? body->size() : 0, status_code, response_headers, output, ec))
+				{
+					auto err = ec.add(-1, "error when dispatching HTTP request on unix socket");
+					SAS_LOG_ERROR(_logger, err);
+					return false;
+				}
+			}
+			else
+#endif
+			if (!neon_request(method_str, url, headers, body, status_code, response_headers, output, ec))
+				return false;
 
-			if (ne_request_dispatch(req) != NE_OK)
+			auto get_header = [&response_headers](const char * name) -> const char *
 			{
-				auto err = ec.add(-1, std::string() + "error when dispatching HTTP request: '" + ne_get_error(_sess) + "'");
-				SAS_LOG_ERROR(_logger, err);
-				return false;
-			}
+				for (auto & h : response_headers)
+					if (h.first.length() == strlen(name) && std::equal(h.first.begin(), h.first.end(), name, [](char a, char b) { return tolower(a) == tolower(b); }))
+						return h.second.c_str();
+				return nullptr;
+			};
 
-			switch(ne_get_status(req)->code)
+			switch(status_code)
 			{
 			case 200: //OK
 				{
-					SAS_LOG_TRACE(_logger, "ne_get_response_header");
-					const char * sid_str = ne_get_response_header(req, "SID");
+					const char * sid_str = get_header("SID");
 					if(sid_str)
 					{
 						try
@@ -290,37 +356,103 @@ namespace SAS {
 					status = Invoker::Status::OK;
 					break;
 				}
-			case 500: //Internal Server Error
-				status = Invoker::Status::Error;
-				break;
 			case 501: //Not Implemented
 				status = Invoker::Status::NotImplemented;
 				break;
+			case 500: //Internal Server Error
 			case 400: //Bad Request
+			default:
 				status = Invoker::Status::Error;
 				break;
 			}
 
-            SAS_LOG_TRACE(_logger, "ne_request_destroy");
-            ne_request_destroy(req);
-
-			if (_output_buffer.size())
+			if (const char * encoding_str = get_header("Content-Encoding"))
 			{
-				size_t size = 0;
-				for (auto & p : _output_buffer)
-					size += p.size();
-				output.resize(size);
-				size_t idx = 0;
-				for (auto & p : _output_buffer)
+				HTTPEncoding response_encoding;
+				if (!HTTPCompression::fromString(encoding_str, response_encoding))
 				{
-					memcpy(output.data() + idx, p.data(), p.size());
-					idx += p.size();
+					auto err = ec.add(-1, std::string() + "not supported content encoding in response: '" + encoding_str + "'");
+					SAS_LOG_ERROR(_logger, err);
+					return false;
+				}
+				if (response_encoding != HTTPEncoding::Identity)
+				{
+					std::vector<char> compressed_output;
+					compressed_output.swap(output);
+					bool limit_exceeded;
+					if (!HTTPCompression::decompress(response_encoding, compressed_output, _options.compression.maxDecompressedSize, output, limit_exceeded, ec))
+					{
+						SAS_LOG_ERROR(_logger, "could not decompress response body");
+						return false;
+					}
 				}
 			}
 
 			return true;
 		}
 
+		bool neon_request(const char * method, const std::string & url, const HTTPHeaders & headers, const std::vector<char> * body,
+			int & status_code, HTTPHeaders & response_headers, std::vector<char> & output, ErrorCollector & ec)
+		{
+			SAS_LOG_TRACE(_logger, "ne_request_create");
+			ne_request * req = ne_request_create(_sess, method, url.c_str());
+			SAS_LOG_ASSERT(_logger, req, "HTTP request has not been created");
+
+			for (auto & h : headers)
+			{
+				SAS_LOG_TRACE(_logger, "ne_add_request_header");
+				ne_add_request_header(req, h.first.c_str(), h.second.c_str());
+			}
+
+			if (body)
+			{
+				SAS_LOG_TRACE(_logger, "ne_set_request_body_buffer");
+				ne_set_request_body_buffer(req, body->data(), body->size());
+			}
+
+			auto _accept = [](void *userdata, ne_request *req, const ne_status *st) -> int
+			{
+                (void)userdata;
+                (void)req;
+                (void)st;
+				return 1;
+			};
+
+			auto _reader = [](void *userdata, const char *buf, size_t len) -> int
+			{
+				auto output_buffer = (std::vector<char>*) userdata;
+				output_buffer->insert(output_buffer->end(), buf, buf + len);
+				return 0;
+			};
+
+			output.clear();
+			SAS_LOG_TRACE(_logger, "ne_add_response_body_reader");
+			ne_add_response_body_reader(req, _accept, _reader, &output);
+
+			if (ne_request_dispatch(req) != NE_OK)
+			{
+				auto err = ec.add(-1, std::string() + "error when dispatching HTTP request: '" + ne_get_error(_sess) + "'");
+				SAS_LOG_ERROR(_logger, err);
+				SAS_LOG_TRACE(_logger, "ne_request_destroy");
+				ne_request_destroy(req);
+				return false;
+			}
+
+			status_code = ne_get_status(req)->code;
+
+			for (auto name : { "SID", "Content-Encoding" })
+			{
+				SAS_LOG_TRACE(_logger, "ne_get_response_header");
+				if (const char * value = ne_get_response_header(req, name))
+					response_headers.push_back(std::make_pair(name, value));
+			}
+
+            SAS_LOG_TRACE(_logger, "ne_request_destroy");
+            ne_request_destroy(req);
+
+			return true;
+		}
+
 		bool error_to_ec(const std::vector<char> & payload, ErrorCollector & ec)
 		{
 			if (payload.size())
@@ -371,6 +503,89 @@ namespace SAS {
 
 	};
 
+	// sends 'batch' messages; invoke() coalesces the calls of concurrent callers into one message
+	class HTTPBatcher
+	{
+		Logging::LoggerPtr _logger;
+		HTTPCaller _caller;
+		HTTPConnectionOptions _options;
+		std::unique_ptr<Coalescer<HTTPBatchRequest, HTTPBatchResponse>> _coalescer;
+
+	public:
+		HTTPBatcher(const std::string & name) :
+			_logger(Logging::getLogger("SAS.HTTPBatcher." + name)),
+			_caller("batch", name)
+		{ }
+
+		~HTTPBatcher()
+		{
+			_caller.deinit();
+		}
+
+		bool init(const HTTPConnectionOptions & options, ErrorCollector & ec)
+		{
+			_options = options;
+			_coalescer.reset(new Coalescer<HTTPBatchRequest, HTTPBatchResponse>(_logger,
+				[this](const std::vector<const HTTPBatchRequest *> & requests, std::vector<HTTPBatchResponse> & responses, ErrorCollector & ec)
+				{
+					return exchange(requests, responses, ec);
+				}, options.batchDelay, options.batchMaxSize));
+			return _caller.init(options, ec);
+		}
+
+		bool exchange(const std::vector<const HTTPBatchRequest *> & requests, std::vector<HTTPBatchResponse> & responses, ErrorCollector & ec)
+		{
+			SAS_LOG_NDC();
+
+			std::vector<char> input, output;
+			if (!HTTPBatch::encode(requests, input, ec))
+			{
+				SAS_LOG_ERROR(_logger, "could not encode batch request");
+				return false;
+			}
+
+			Invoker::Status status;
+			SessionID _tmp_sid = 0;
+			if (!_caller.msg_exchange(_options.method_invoke, _tmp_sid, std::string(), "batch", input, output, status, ec))
+				return false;
+
+			if (status != Invoker::Status::OK)
+			{
+				_caller.error_to_ec(output, ec);
+				return false;
+			}
+
+			if (!HTTPBatch::decode(output, responses, ec))
+			{
+				SAS_LOG_ERROR(_logger, "could not decode batch response");
+				return false;
+			}
+
+			if (responses.size() != requests.size())
+			{
+				auto err = ec.add(-1, "number of batch responses (" + std::to_string(responses.size()) + ") does not match number of requests (" + std::to_string(requests.size()) + ")");
+				SAS_LOG_ERROR(_logger, err);
+				return false;
+			}
+
+			return true;
+		}
+
+		bool invoke(const HTTPBatchRequest & request, HTTPBatchResponse & response, ErrorCollector & ec)
+		{
+			SAS_LOG_NDC();
+
+			// an entry which cannot be encoded would fail the whole batch
+			if (!HTTPBatch::check(request, ec))
+			{
+				SAS_LOG_ERROR(_logger, "invalid batch entry");
+				return false;
+			}
+
+			return _coalescer->invoke(request, response, ec);
+		}
+	};
+
 	class HTTPConnection : public Connection, public HTTPCaller
 	{
 		HTTPConnectionOptions _options;
@@ -378,14 +593,16 @@ namespace SAS {
 		std::string _invoker;
 		std::string _module;
 		SessionID _session_id;
+		HTTPBatcher * _batcher;
 
 	public:
-		HTTPConnection(const HTTPConnectionOptions & options, const std::string & module, const std::string & invoker) : Connection(), HTTPCaller(module, invoker),
+		HTTPConnection(const HTTPConnectionOptions & options, const std::string & module, const std::string & invoker, HTTPBatcher * batcher) : Connection(), HTTPCaller(module, invoker),
 			_options(options),
 			_logger(Logging::getLogger("SAS.HTTPConnection." + module + "." + invoker)),
 			_invoker(invoker),
 			_module(module),
-			_session_id(0)
+			_session_id(0),
+			_batcher(batcher)
 		{ }
 
 
@@ -437,8 +654,24 @@ namespace SAS {
 		{
 			SAS_LOG_NDC();
 			
-			std::string out_topic;
-			std::vector<std::string> out_args;
+			if (_batcher)
+			{
+				HTTPBatchRequest request;
+				request.module = _module;
+				request.sid = _session_id;
+				request.invoker = _invoker;
+				request.input = input;
+
+				HTTPBatchResponse response;
+				if (!_batcher->invoke(request, response, ec))
+					return Status::Error;
+
+				_session_id = response.sid;
+				output = std::move(response.output);
+				for (auto & e : response.errors)
+					ec.add(e.first, e.second);
+				return response.status;
+			}
 
 			Status status;
 
@@ -450,10 +683,23 @@ namespace SAS {
 
 			return status;
 		}
-		
-	private:
-		bool endSession(ErrorCollector & ec)
+
+		virtual bool setSessionId(SessionID sid) final
 		{
+			_session_id = sid;
+			return true;
+		}
+
+		virtual SessionID sessionId() const final
+		{
+			return _session_id;
+		}
+
+		virtual bool endSession(ErrorCollector & ec) final
+		{
+			if (!_session_id)
+				return true;
+
 			std::vector<char> output;
 			Status status;
 			if (!msg_exchange(_options.method_control, _session_id, std::string(), "end_session", std::vector<char>(), output, status, ec))
@@ -496,6 +742,13 @@ namespace SAS {
 
 		long disconnect_timeout = 0;
 		HTTPConnectionOptions options;
+		std::unique_ptr<HTTPBatcher> batcher;
+
+		bool init_batcher(ErrorCollector & ec)
+		{
+			batcher.reset(new HTTPBatcher(name));
+			return batcher->init(options, ec);
+		}
 	};
 
 	HTTPConnector::HTTPConnector(const std::string & name, Application * app) : Connector(),
@@ -518,7 +771,7 @@ namespace SAS {
         if(!priv->options.build(cfgPath, priv->app->configReader(), ec))
 			return false;
 
-		return true;
+		return priv->init_batcher(ec);
 	}
 
     bool HTTPConnector::init(const std::string & connectionString, const std::string & cfgPath, ErrorCollector & ec)
@@ -527,7 +780,7 @@ namespace SAS {
         if(!priv->options.build(connectionString, cfgPath, priv->app->configReader(), ec))
             return false;
 
-        return true;
+        return priv->init_batcher(ec);
     }
 
 	bool HTTPConnector::connect(ErrorCollector & ec)
@@ -541,7 +794,7 @@ namespace SAS {
 	Connection * HTTPConnector::createConnection(const std::string & module_name, const std::string & invoker_name, ErrorCollector & ec)
 	{
 		SAS_LOG_NDC();
-		auto conn = new HTTPConnection(priv->options, module_name, invoker_name);
+		auto conn = new HTTPConnection(priv->options, module_name, invoker_name, priv->options.batch ? priv->batcher.get() : nullptr);
 		if (!conn->init(priv->options, ec) || !conn->connect(ec))
 		{
 			delete conn;
@@ -550,6 +803,23 @@ namespace SAS {
 		return conn;
 	}
 
+	bool HTTPConnector::invokeBatch(const std::vector<HTTPBatchRequest> & requests, std::vector<HTTPBatchResponse> & responses, ErrorCollector & ec)
+	{
+		SAS_LOG_NDC();
+		if (!priv->batcher)
+		{
+			auto err = ec.add(-1, "connector is not initialized");
+			SAS_LOG_ERROR(priv->logger, err);
+			return false;
+		}
+
+		std::vector<const HTTPBatchRequest *> refs;
+		refs.reserve(requests.size());
+		for (auto & r : requests)
+			refs.push_back(&r);
+		return priv->batcher->exchange(refs, responses, ec);
+	}
+
 	bool HTTPConnector::getModuleInfo(const std::string & moduleName, std::string & description, std::string & version, ErrorCollector & ec)
 	{
 		SAS_LOG_NDC();
@@ -19,6 +19,7 @@ along with sasHTTP.  If not, see <http://www.gnu.org/licenses/>
 #define sasHTTP__httpconnector_h
 
 #include "config.h"
+#include "httpbatch.h"
 
 #include <sasCore/connector.h>
 
@@ -50,6 +51,9 @@ namespace SAS {
 
         bool getModuleInfo(const std::string & moduleName, std::string & description, std::string & version, ErrorCollector & ec) final override;
 
+        // sends all requests in one 'batch' message; responses are in the order of the requests
+        bool invokeBatch(const std::vector<HTTPBatchRequest> & requests, std::vector<HTTPBatchResponse> & responses, ErrorCollector & ec);
+
 	};
 
 }
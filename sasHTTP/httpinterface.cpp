@@ -20,9 +20,13 @@ along with sasHTTP.  If not, see <http://www.gnu.org/licenses/>
 #ifdef SAS_HTTP__HAVE_MICROHTTPD
 
 #include "httpcommon.h"
+#include "httpbatch.h"
+#include "httpcompression.h"
+#include "httpunixsocket.h"
 
 #include <sasCore/logging.h>
 #include <sasCore/errorcollector.h>
+#include <sasCore/errorcodes.h>
 #include <sasJSON/jsonerrorcollector.h>
 #include <sasCore/module.h>
 #include <sasCore/application.h>
@@ -32,17 +36,36 @@ along with sasHTTP.  If not, see <http://www.gnu.org/licenses/>
 #include <sasCore/thread.h>
 #include <sasCore/controlledthread.h>
 #include <sasCore/notifier.h>
+#include <sasCore/threadpool.h>
 
 #include <rapidjson/document.h>
 #include <rapidjson/writer.h>
 
 #include <list>
 #include <deque>
+#include <map>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <mutex>
+#include <condition_variable>
 #include <limits>
 
 #include <microhttpd.h>
 
+// older versions of libmicrohttpd know only the former name
+#ifndef MHD_HTTP_PAYLOAD_TOO_LARGE
+#  define MHD_HTTP_PAYLOAD_TOO_LARGE MHD_HTTP_REQUEST_ENTITY_TOO_LARGE
+#endif
+
+#ifdef SAS_HTTP__HAVE_UNIX_SOCKET
+#  include <sys/socket.h>
+#  include <sys/stat.h>
+#  include <sys/un.h>
+#  include <unistd.h>
+#  include <cerrno>
+#endif
+
 namespace SAS {
 
 	struct HTTPInterface::Priv
@@ -58,6 +81,7 @@ namespace SAS {
 		std::string name;
 
 		MHD_Daemon *daemon = nullptr;
+		MHD_Daemon *unix_daemon = nullptr;
 
 		Notifier runner_not;
 
@@ -66,8 +90,55 @@ namespace SAS {
             unsigned short port = 0;
 			std::string responseContentType;
             unsigned connectionTimeout = 60; //seconds
+			HTTPCompressionOptions compression;
+			bool listenTCP = true;
+			std::string unixSocket;
+			std::string unixSocketMode;
 		} options;
 
+#ifdef SAS_HTTP__HAVE_UNIX_SOCKET
+		int bind_unix_socket(ErrorCollector & ec)
+		{
+			SAS_LOG_NDC();
+
+			sockaddr_un addr = {};
+			if (options.unixSocket.length() >= sizeof(addr.sun_path))
+			{
+				auto err = ec.add(-1, "unix socket path is too long: '" + options.unixSocket + "'");
+				SAS_LOG_ERROR(logger, err);
+				return -1;
+			}
+			addr.sun_family = AF_UNIX;
+			memcpy(addr.sun_path, options.unixSocket.c_str(), options.unixSocket.length() + 1);
+
+			// stale socket of a previous run
+			struct stat st;
+			if (lstat(options.unixSocket.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+				unlink(options.unixSocket.c_str());
+
+			int fd;
+			if ((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+			{
+				auto err = ec.add(-1, std::string() + "could not create unix socket: '" + strerror(errno) + "'");
+				SAS_LOG_ERROR(logger, err);
+				return -1;
+			}
+			if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0)
+			{
+				auto err = ec.add(-1, "could not listen on unix socket '" + options.unixSocket + "': '" + strerror(errno) + "'");
+				SAS_LOG_ERROR(logger, err);
+				close(fd);
+				return -1;
+			}
+			if (options.unixSocketMode.length() && chmod(options.unixSocket.c_str(), static_cast<mode_t>(strtol(options.unixSocketMode.c_str(), nullptr, 8))) != 0)
+			{
+				auto err = ec.add(-1, "could not set mode of unix socket '" + options.unixSocket + "': '" + strerror(errno) + "'");
+				SAS_LOG_WARN(logger, err);
+			}
+			return fd;
+		}
+#endif
+
 		struct connection_info_struct
 		{
 			connection_info_struct(Priv * priv_) : priv(priv_)
@@ -81,7 +152,7 @@ namespace SAS {
 			MHD_PostProcessor *postprocessor = nullptr;
 		};
 
-		int send_data (struct MHD_Connection *connection, const char * data, size_t size, const char * sid, const char * content_type, int status_code)
+		int send_data (struct MHD_Connection *connection, const char * data, size_t size, const char * sid, const char * content_type, int status_code, const char * content_encoding = nullptr)
 		{
 			SAS_LOG_NDC();
 
@@ -99,6 +170,12 @@ namespace SAS {
 				SAS_LOG_TRACE(logger, "MHD_add_response_header");
 				MHD_add_response_header(response, "SID", sid);
 			}
+			if(content_encoding)
+			{
+				SAS_LOG_TRACE(logger, "MHD_add_response_header");
+				MHD_add_response_header(response, "Content-Encoding", content_encoding);
+				MHD_add_response_header(response, "Vary", "Accept-Encoding");
+			}
 
 			SAS_LOG_TRACE(logger, "MHD_queue_response");
 			auto ret = MHD_queue_response (connection, status_code, response);
@@ -108,9 +185,9 @@ namespace SAS {
 			return ret;
 		}
 
-		int send_data (struct MHD_Connection *connection, const std::vector<char> & data, const char * sid, const char * content_type, int status_code)
+		int send_data (struct MHD_Connection *connection, const std::vector<char> & data, const char * sid, const char * content_type, int status_code, const char * content_encoding = nullptr)
 		{
-			return send_data(connection, data.data(), data.size(), sid, content_type, status_code);
+			return send_data(connection, data.data(), data.size(), sid, content_type, status_code, content_encoding);
 		}
 
 		int send_data(struct MHD_Connection *connection, const std::list<std::vector<char>> & buffer, const char * sid, const char * content_type, int status_code)
@@ -136,245 +213,507 @@ namespace SAS {
 			con_info->in_buffer.push_back(buff);
 		}
 
-		int complete(connection_info_struct *con_info, MHD_Connection *connection, const char * url)
+		std::vector<char> input_data(connection_info_struct *con_info)
 		{
-			SAS_LOG_NDC();
+			if (con_info->in_buffer.size() == 1)
+				return std::move(con_info->in_buffer.front());
 
-			rapidjson::Document out_doc;
-			out_doc.SetObject();
-			JSONErrorCollector ec(out_doc.GetAllocator());
+			size_t size = 0;
+			for (auto & p : con_info->in_buffer)
+				size += p.size();
 
-			enum OutType
+			std::vector<char> input(size);
+			size_t idx = 0;
+			for (auto & p : con_info->in_buffer)
 			{
-				Out_OK, Out_JSon, Out_Error
-			} outType = Out_OK;
-
-			std::vector<char> output;
-			SessionID sid = 0;
-			int answercode = MHD_HTTP_OK;
+				memcpy(input.data() + idx, p.data(), p.size());
+				idx += p.size();
+			}
+			return input;
+		}
 
+		bool request_data(connection_info_struct *con_info, MHD_Connection *connection, std::vector<char> & input, int & answercode, ErrorCollector & ec)
+		{
 			SAS_LOG_TRACE(logger, "MHD_lookup_connection_value");
-			auto _mode = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "mode");
-			if(!_mode)
+			auto content_encoding = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Content-Encoding");
+			if (!content_encoding)
 			{
-				auto err = ec.add(-1, std::string() + "mode is not specified");
+				input = input_data(con_info);
+				return true;
+			}
+
+			HTTPEncoding encoding;
+			if (!HTTPCompression::fromString(content_encoding, encoding))
+			{
+				auto err = ec.add(-1, std::string() + "not supported content encoding: '" + content_encoding + "'");
 				SAS_LOG_ERROR(logger, err);
-				outType = Out_Error;
-				answercode = MHD_HTTP_BAD_REQUEST;
+				answercode = MHD_HTTP_UNSUPPORTED_MEDIA_TYPE;
+				return false;
+			}
+			if (encoding == HTTPEncoding::Identity)
+			{
+				input = input_data(con_info);
+				return true;
+			}
+
+			bool limit_exceeded;
+			if (!HTTPCompression::decompress(encoding, input_data(con_info), options.compression.maxDecompressedSize, input, limit_exceeded, ec))
+			{
+				SAS_LOG_ERROR(logger, "could not decompress request body");
+				answercode = limit_exceeded ? MHD_HTTP_PAYLOAD_TOO_LARGE : MHD_HTTP_BAD_REQUEST;
+				return false;
+			}
+			return true;
+		}
+
+		const char * compress_output(MHD_Connection *connection, std::vector<char> & output)
+		{
+			if (!options.compression.encodings.size() || output.size() < options.compression.threshold)
+				return nullptr;
+
+			SAS_LOG_TRACE(logger, "MHD_lookup_connection_value");
+			auto encoding = HTTPCompression::negotiate(MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Accept-Encoding"), options.compression.encodings);
+			if (encoding == HTTPEncoding::Identity)
+				return nullptr;
+
+			std::vector<char> compressed;
+			NullEC nec;
+			if (!HTTPCompression::compress(encoding, options.compression.level, output, compressed, nec))
+			{
+				SAS_LOG_WARN(logger, "could not compress response, it is sent uncompressed");
+				return nullptr;
 			}
-			else
+			if (compressed.size() >= output.size())
+				return nullptr;
+
+			output.swap(compressed);
+			return HTTPCompression::toString(encoding);
+		}
+
+		// entries of the same session are executed sequentially (in order) under one session lock,
+		// entries of different sessions are executed in parallel on the threads of the application pool
+		bool run_batch(const std::vector<char> & input, std::vector<char> & output, ErrorCollector & ec)
+		{
+			SAS_LOG_NDC();
+
+			std::vector<HTTPBatchRequest> requests;
+			if (!HTTPBatch::decode(input, requests, ec))
 			{
-				std::string _url(url);
-				while (_url.front() == '/')
-					_url =_url.substr(1, -1);
-				while (_url.back() == '/')
-					_url.pop_back();
+				SAS_LOG_ERROR(logger, "could not decode batch request");
+				return false;
+			}
 
-				std::stringstream ss(_url);
-			    std::string item;
-			    std::vector<std::string> splittedUrl;
-			    while (std::getline(ss, item, '/'))
-			    	if(item.length())
-			    		splittedUrl.push_back(item);
+			std::vector<HTTPBatchResponse> responses(requests.size());
 
+			std::vector<Module *> request_modules(requests.size(), nullptr);
+			std::map<std::pair<Module *, SessionID>, size_t> session_groups;
+			std::vector<std::vector<size_t>> groups;
+			for (size_t i = 0, l = requests.size(); i < l; ++i)
+			{
+				auto & req = requests[i];
+				auto & resp = responses[i];
+				resp.sid = req.sid;
 
-                auto get_session_id = [&](SessionID & sid) -> bool
+				HTTPBatch::EntryErrorCollector entry_ec(resp);
+				if (!(request_modules[i] = find_module(req.module.data(), req.module.size(), entry_ec)))
 				{
-					SAS_LOG_TRACE(logger, "MHD_lookup_connection_value");
-					auto sid_str = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "SID");
-					if(!sid_str)
-						if(!(sid_str = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "sid")))
-							if(splittedUrl.size() >= 2)
-								sid_str = splittedUrl[1].c_str();
-
-					if(sid_str)
-					{
-						try
-						{
-							sid = std::stoull(sid_str);
-						}
-						catch(std::exception & e)
-						{
-							auto err = ec.add(-1, std::string() + "could not convert session ID '" + sid_str + "': '" + e.what() + "'" );
-							SAS_LOG_ERROR(logger, err);
-							return false;
-						}
-					}
-					else
-						sid = 0;
-					return true;
-				};
+					if (!resp.errors.size())
+						resp.errors.push_back(std::make_pair(-1L, "module '" + req.module + "' is not found"));
+					continue;
+				}
 
-				auto get_module = [&]() -> Module *
+				if (!req.sid)
 				{
-					if(!splittedUrl.size())
-					{
-						auto err = ec.add(-1, "module name is nor specified in URL");
-						SAS_LOG_ERROR(logger, err);
-						return nullptr;
-					}
+					groups.push_back(std::vector<size_t>(1, i));
+					continue;
+				}
+
+				auto key = std::make_pair(request_modules[i], req.sid);
+				auto g_it = session_groups.find(key);
+				if (g_it == session_groups.end())
+				{
+					session_groups[key] = groups.size();
+					groups.push_back(std::vector<size_t>(1, i));
+				}
+				else
+					groups[g_it->second].push_back(i);
+			}
 
-					return app->objectRegistry()->getObject<Module>(SAS_OBJECT_TYPE__MODULE, splittedUrl[0], ec);
-				};
+			SAS_LOG_DEBUG(logger, "batch of " + std::to_string(requests.size()) + " entries in " + std::to_string(groups.size()) + " session group(s)");
 
-				std::string mode(_mode);
-				if (mode == "invoke")
+			auto run_group = [&](const std::vector<size_t> & group)
+			{
+				auto module = request_modules[group.front()];
+				HTTPBatchResponse session_error;
+				HTTPBatch::EntryErrorCollector session_ec(session_error);
+				auto session = module->getSession(requests[group.front()].sid, session_ec);
+				for (auto idx : group)
 				{
-					Module * module;
-					if (!get_session_id(sid) || !(module = get_module()))
+					auto & resp = responses[idx];
+					if (!session)
 					{
-						answercode = MHD_HTTP_BAD_REQUEST;
-						outType = Out_Error;
+						resp.status = Invoker::Status::Error;
+						resp.errors = session_error.errors;
+						continue;
 					}
-					else
-					{
-						SAS_LOG_TRACE(logger, "MHD_lookup_connection_value");
-						auto invoker_name = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Invoker");
-						if (!invoker_name)
-							if (!(invoker_name = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "invoker")))
-								if(splittedUrl.size() >= 3)
-									invoker_name = splittedUrl[2].c_str();
-
-						if (!invoker_name)
-						{
-							auto err = ec.add(-1, std::string() + "invoker is not specified");
-							SAS_LOG_ERROR(logger, err);
-							outType = Out_Error;
-							answercode = MHD_HTTP_BAD_REQUEST;
-						}
+					resp.sid = session->id();
+					HTTPBatch::EntryErrorCollector entry_ec(resp);
+					resp.status = session->invoke(requests[idx].invoker, requests[idx].input, resp.output, entry_ec);
+				}
+				if (session)
+					session->unlock();
+			};
 
-						auto session = module->getSession(sid, ec);
-						if (!session)
-						{
-							outType = Out_Error;
-							answercode = MHD_HTTP_INTERNAL_SERVER_ERROR;
-						}
+			std::mutex pending_mut;
+			std::condition_variable pending_cv;
+			size_t pending = 0;
 
-						if(answercode == MHD_HTTP_OK)
-						{
-							sid = session->id();
-							size_t size = 0;
-							for (auto & p : con_info->in_buffer)
-								size += p.size();
-
-							std::vector<char> input(size);
-							size_t idx = 0;
-							for (auto & p : con_info->in_buffer)
-							{
-								memcpy(input.data() + idx, p.data(), p.size());
-								idx += p.size();
-							}
-
-							switch (session->invoke(invoker_name, input, output, ec))
-							{
-							case Invoker::Status::OK:
-								outType = Out_OK;
-								answercode = MHD_HTTP_OK;
-								break;
-							case Invoker::Status::NotImplemented:
-								outType = Out_Error;
-								answercode = MHD_HTTP_NOT_IMPLEMENTED;
-								break;
-							case Invoker::Status::Error:
-							case Invoker::Status::FatalError:
-								outType = Out_Error;
-								answercode = MHD_HTTP_INTERNAL_SERVER_ERROR;
-								break;
-							}
-							session->unlock();
-						}
-					}
+			auto pool = app->threadPool();
+			for (size_t i = 1, l = groups.size(); i < l; ++i)
+			{
+				auto th = pool->allocate();
+				if (!th)
+				{
+					run_group(groups[i]);
+					continue;
 				}
-				else if(mode == "get_session")
 				{
-					Module * module;
-					if (!get_session_id(sid) || !(module = get_module()))
-					{
-						answercode = MHD_HTTP_BAD_REQUEST;
-						outType = Out_Error;
-					}
-					else
+					std::unique_lock<std::mutex> __locker(pending_mut);
+					++pending;
+				}
+				auto & group = groups[i];
+				th->run([&run_group, &group]() { run_group(group); },
+					[&pending_mut, &pending_cv, &pending, pool, th]()
 					{
-						auto session = module->getSession(sid, ec);
-						if (!session)
-							outType = Out_Error;
-						else
 						{
-							sid = session->id();
-							session->unlock();
-							outType = Out_OK;
+							std::unique_lock<std::mutex> __locker(pending_mut);
+							--pending;
+							pending_cv.notify_all();
 						}
-					}
+						pool->release(th);
+					});
+			}
+			if (groups.size())
+				run_group(groups.front());
+
+			{
+				std::unique_lock<std::mutex> __locker(pending_mut);
+				pending_cv.wait(__locker, [&pending]() { return pending == 0; });
+			}
+
+			HTTPBatch::encode(responses, output);
+			return true;
+		}
+
+		enum class Mode
+		{
+			None, Invoke, Batch, GetSession, EndSession, GetModuleInfo
+		};
+
+		static Mode parse_mode(const char * mode)
+		{
+			switch (mode[0])
+			{
+			case 'i':
+				if (!strcmp(mode, "invoke"))
+					return Mode::Invoke;
+				break;
+			case 'b':
+				if (!strcmp(mode, "batch"))
+					return Mode::Batch;
+				break;
+			case 'g':
+				if (!strcmp(mode, "get_session"))
+					return Mode::GetSession;
+				if (!strcmp(mode, "get_module_info"))
+					return Mode::GetModuleInfo;
+				break;
+			case 'e':
+				if (!strcmp(mode, "end_session"))
+					return Mode::EndSession;
+				break;
+			}
+			return Mode::None;
+		}
+
+		// part of the URL, referenced in place
+		struct StrRef
+		{
+			StrRef(const char * data_ = nullptr, size_t size_ = 0) : data(data_), size(size_)
+			{ }
+
+			const char * data;
+			size_t size;
+		};
+
+		// URL: /<module>[/<session id>[/<invoker>]]
+		enum { URL_Module, URL_SessionID, URL_Invoker, URL_SegmentCount };
+
+		static void split_url(const char * url, StrRef (&segments)[URL_SegmentCount])
+		{
+			size_t i = 0;
+			while (*url && i < URL_SegmentCount)
+			{
+				while (*url == '/')
+					++url;
+				auto begin = url;
+				while (*url && *url != '/')
+					++url;
+				if (url != begin)
+				{
+					segments[i].data = begin;
+					segments[i].size = static_cast<size_t>(url - begin);
+					++i;
 				}
-				else if (mode == "end_session")
+			}
+		}
+
+		static bool parse_sid(const char * str, size_t size, SessionID & sid)
+		{
+			if (!size)
+				return false;
+			unsigned long long ret = 0;
+			for (size_t i = 0; i < size; ++i)
+			{
+				if (str[i] < '0' || str[i] > '9')
+					return false;
+				auto digit = static_cast<unsigned long long>(str[i] - '0');
+				if (ret > (std::numeric_limits<unsigned long long>::max() - digit) / 10)
+					return false;
+				ret = ret * 10 + digit;
+			}
+			sid = static_cast<SessionID>(ret);
+			return true;
+		}
+
+		// modules by name, sorted; built when the interface starts
+		std::vector<std::pair<std::string, Module *>> modules;
+
+		Module * find_module(const char * name, size_t size, ErrorCollector & ec)
+		{
+			auto it = std::lower_bound(modules.begin(), modules.end(), StrRef(name, size), [](const std::pair<std::string, Module *> & m, const StrRef & n)
+			{
+				return m.first.compare(0, std::string::npos, n.data, n.size) < 0;
+			});
+			if (it != modules.end() && it->first.size() == size && !memcmp(it->first.data(), name, size))
+				return it->second;
+
+			// registered after start
+			return app->objectRegistry()->getObject<Module>(SAS_OBJECT_TYPE__MODULE, std::string(name, size), ec);
+		}
+
+		// keeps the errors of a request; the JSON document is created only if there is any
+		class ErrorList : public ErrorCollector
+		{
+		public:
+			std::vector<std::pair<long, std::string>> errors;
+		protected:
+			virtual void append(long errorCode, const std::string & errorText) final
+			{
+				errors.push_back(std::make_pair(errorCode, errorText));
+			}
+		};
+
+		static void write_json(const rapidjson::Document & doc, std::vector<char> & output)
+		{
+			rapidjson::StringBuffer sb;
+			rapidjson::Writer<rapidjson::StringBuffer> w(sb);
+			doc.Accept(w);
+			output.resize(sb.GetSize());
+			memcpy(output.data(), sb.GetString(), sb.GetSize());
+		}
+
+		int complete(connection_info_struct *con_info, MHD_Connection *connection, const char * url)
+		{
+			SAS_LOG_NDC();
+
+			ErrorList ec;
+			std::vector<char> output;
+			SessionID sid = 0;
+			int answercode = MHD_HTTP_OK;
+			const char * content_type = options.responseContentType.c_str();
+
+			auto process = [&]() -> bool
+			{
+				SAS_LOG_TRACE(logger, "MHD_lookup_connection_value");
+				auto _mode = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "mode");
+				if (!_mode)
+				{
+					auto err = ec.add(-1, "mode is not specified");
+					SAS_LOG_ERROR(logger, err);
+					answercode = MHD_HTTP_BAD_REQUEST;
+					return false;
+				}
+
+				auto mode = parse_mode(_mode);
+				if (mode == Mode::None)
+				{
+					auto err = ec.add(-1, std::string() + "not supported mode '" + _mode + "'");
+					SAS_LOG_ERROR(logger, err);
+					answercode = MHD_HTTP_BAD_REQUEST;
+					return false;
+				}
+
+				std::vector<char> input;
+				if (!request_data(con_info, connection, input, answercode, ec))
+					return false;
+
+				if (mode == Mode::Batch)
 				{
-					Module * module;
-					if(!get_session_id(sid) || !(module = get_module()))
+					if (!run_batch(input, output, ec))
 					{
 						answercode = MHD_HTTP_BAD_REQUEST;
-						outType = Out_Error;
+						return false;
 					}
-					else
+					return true;
+				}
+
+				StrRef segments[URL_SegmentCount];
+				split_url(url, segments);
+
+				if (!segments[URL_Module].size)
+				{
+					auto err = ec.add(-1, "module name is not specified in URL");
+					SAS_LOG_ERROR(logger, err);
+					answercode = MHD_HTTP_BAD_REQUEST;
+					return false;
+				}
+
+				auto module = find_module(segments[URL_Module].data, segments[URL_Module].size, ec);
+				if (!module)
+				{
+					answercode = MHD_HTTP_BAD_REQUEST;
+					return false;
+				}
+
+				if (mode == Mode::GetModuleInfo)
+				{
+					if (!module->isReady())
 					{
-						module->endSession(sid);
-						answercode = MHD_HTTP_OK;
-						outType = Out_OK;
+						auto err = ec.add(SAS_CORE__ERROR__MODULE__NOT_READY, "module '" + module->name() + "' is not ready");
+						SAS_LOG_WARN(logger, err);
+						answercode = MHD_HTTP_SERVICE_UNAVAILABLE;
+						return false;
 					}
+					rapidjson::Document out_doc;
+					out_doc.SetObject();
+					rapidjson::Value description(rapidjson::kStringType), version(rapidjson::kStringType);
+					description.SetString(module->description().c_str(), out_doc.GetAllocator());
+					version.SetString(module->version().c_str(), out_doc.GetAllocator());
+					out_doc.AddMember("description", description, out_doc.GetAllocator());
+					out_doc.AddMember("version", version, out_doc.GetAllocator());
+					write_json(out_doc, output);
+					content_type = "application/json";
+					return true;
 				}
-				else if(mode == "get_module_info")
+
+				SAS_LOG_TRACE(logger, "MHD_lookup_connection_value");
+				const char * sid_str = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "SID");
+				if (!sid_str)
+					sid_str = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "sid");
+				if (sid_str || segments[URL_SessionID].size)
 				{
-					Module * module;
-					if(!(module = get_module()))
+					auto & seg = segments[URL_SessionID];
+					if (!(sid_str ? parse_sid(sid_str, strlen(sid_str), sid) : parse_sid(seg.data, seg.size, sid)))
 					{
+						auto err = ec.add(-1, "could not convert session ID '" + (sid_str ? std::string(sid_str) : std::string(seg.data, seg.size)) + "'");
+						SAS_LOG_ERROR(logger, err);
 						answercode = MHD_HTTP_BAD_REQUEST;
-						outType = Out_Error;
+						return false;
 					}
-					else
+				}
+
+				switch (mode)
+				{
+				case Mode::EndSession:
+					module->endSession(sid);
+					return true;
+				case Mode::GetSession:
 					{
-						auto create_string = [](rapidjson::Document & doc, const char * str) -> rapidjson::Value
+						auto session = module->getSession(sid, ec);
+						if (!session)
 						{
-							rapidjson::Value v(rapidjson::kStringType);
-							v.SetString(str, doc.GetAllocator());
-							return v;
-						};
-
-						out_doc.AddMember("description", create_string(out_doc, module->description().c_str()), out_doc.GetAllocator());
-						out_doc.AddMember("version", create_string(out_doc, module->version().c_str()), out_doc.GetAllocator());
-						answercode = MHD_HTTP_OK;
-						outType = Out_JSon;
+							sid = 0;
+							answercode = MHD_HTTP_INTERNAL_SERVER_ERROR;
+							return false;
+						}
+						sid = session->id();
+						session->unlock();
 					}
+					return true;
+				case Mode::Invoke:
+					break;
+				case Mode::None:
+				case Mode::Batch:
+				case Mode::GetModuleInfo:
+					return false;
 				}
+
+				std::string invoker_name;
+				SAS_LOG_TRACE(logger, "MHD_lookup_connection_value");
+				auto _invoker_name = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Invoker");
+				if (!_invoker_name)
+					_invoker_name = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "invoker");
+				if (_invoker_name)
+					invoker_name = _invoker_name;
+				else if (segments[URL_Invoker].size)
+					invoker_name.assign(segments[URL_Invoker].data, segments[URL_Invoker].size);
 				else
 				{
-					auto err = ec.add(-1, std::string() + "not supported mode '" + mode + "'");
+					auto err = ec.add(-1, "invoker is not specified");
 					SAS_LOG_ERROR(logger, err);
 					answercode = MHD_HTTP_BAD_REQUEST;
-					outType = Out_Error;
+					return false;
 				}
-			}
 
-			auto content_type = options.responseContentType.c_str();
+				auto session = module->getSession(sid, ec);
+				if (!session)
+				{
+					answercode = MHD_HTTP_INTERNAL_SERVER_ERROR;
+					return false;
+				}
 
-			switch (outType)
-			{
-			case Out_OK:
-				break;
-			case Out_Error:
-				out_doc.AddMember("errors", ec.errors(), out_doc.GetAllocator());
-                // fall through
-			case Out_JSon:
+				sid = session->id();
+				auto status = session->invoke(invoker_name, input, output, ec);
+				session->unlock();
+
+				switch (status)
 				{
-					rapidjson::StringBuffer sb;
-					rapidjson::Writer<rapidjson::StringBuffer> w(sb);
-					out_doc.Accept(w);
-					output.resize(sb.GetSize());
-					memcpy(output.data(), sb.GetString(), sb.GetSize());
-					content_type = "application/json";
+				case Invoker::Status::OK:
+					return true;
+				case Invoker::Status::NotImplemented:
+					answercode = MHD_HTTP_NOT_IMPLEMENTED;
+					return false;
+				case Invoker::Status::Error:
+				case Invoker::Status::FatalError:
+					answercode = MHD_HTTP_INTERNAL_SERVER_ERROR;
+					return false;
 				}
-				break;
+				return false;
+			};
+
+			if (!process())
+			{
+				if (answercode == MHD_HTTP_OK)
+					answercode = MHD_HTTP_INTERNAL_SERVER_ERROR;
+
+				rapidjson::Document out_doc;
+				out_doc.SetObject();
+				JSONErrorCollector jec(out_doc.GetAllocator());
+				for (auto & e : ec.errors)
+					jec.add(e.first, e.second);
+				out_doc.AddMember("errors", jec.errors(), out_doc.GetAllocator());
+				write_json(out_doc, output);
+				content_type = "application/json";
 			}
 
-			return send_data(connection, output, sid ? std::to_string(sid).c_str() : nullptr, content_type, answercode);
+			auto content_encoding = compress_output(connection, output);
+
+			char sid_str[24];
+			if (sid)
+				snprintf(sid_str, sizeof(sid_str), "%llu", static_cast<unsigned long long>(sid));
+
+			return send_data(connection, output, sid ? sid_str : nullptr, content_type, answercode, content_encoding);
 		}
 
 		static int iterate_post (void *coninfo_cls, enum MHD_ValueKind kind, const char *key, const char *filename, const char *content_type,
@@ -513,15 +852,68 @@ namespace SAS {
 	{
 		SAS_LOG_NDC();
 
-		SAS_LOG_TRACE(priv->logger, "MHD_start_daemon");
-        if(!(priv->daemon = MHD_start_daemon (MHD_USE_THREAD_PER_CONNECTION,
-                                 priv->options.port, nullptr, nullptr,
-                                 &Priv::answer_to_connection, static_cast<void*>(priv),
-                                 MHD_OPTION_NOTIFY_COMPLETED, &Priv::request_completed, static_cast<void*>(priv),
-                                 MHD_OPTION_CONNECTION_TIMEOUT, priv->options.connectionTimeout,
-								 MHD_OPTION_END)))
+		NullEC nec;
+		priv->modules.clear();
+		for (auto module : priv->app->objectRegistry()->getObjects<Module>(SAS_OBJECT_TYPE__MODULE, nec))
+			priv->modules.push_back(std::make_pair(module->name(), module));
+		std::sort(priv->modules.begin(), priv->modules.end(), [](const std::pair<std::string, Module *> & a, const std::pair<std::string, Module *> & b)
 		{
-			auto err = ec.add(-1, std::string() + "could not start HTTP daemon");
+			return a.first < b.first;
+		});
+
+		if (priv->options.listenTCP)
+		{
+			SAS_LOG_TRACE(priv->logger, "MHD_start_daemon");
+			if(!(priv->daemon = MHD_start_daemon (MHD_USE_THREAD_PER_CONNECTION,
+									 priv->options.port, nullptr, nullptr,
+									 &Priv::answer_to_connection, static_cast<void*>(priv),
+									 MHD_OPTION_NOTIFY_COMPLETED, &Priv::request_completed, static_cast<void*>(priv),
+									 MHD_OPTION_CONNECTION_TIMEOUT, priv->options.connectionTimeout,
+									 MHD_OPTION_END)))
+			{
+				auto err = ec.add(-1, std::string() + "could not start HTTP daemon");
+				SAS_LOG_ERROR(priv->logger, err);
+				return Status::CannotStart;
+			}
+		}
+
+#ifdef SAS_HTTP__HAVE_UNIX_SOCKET
+		if (priv->options.unixSocket.length())
+		{
+			int fd = priv->bind_unix_socket(ec);
+			if (fd >= 0)
+			{
+				SAS_LOG_TRACE(priv->logger, "MHD_start_daemon");
+				if (!(priv->unix_daemon = MHD_start_daemon (MHD_USE_THREAD_PER_CONNECTION,
+										 0, nullptr, nullptr,
+										 &Priv::answer_to_connection, static_cast<void*>(priv),
+										 MHD_OPTION_LISTEN_SOCKET, fd,
+										 MHD_OPTION_NOTIFY_COMPLETED, &Priv::request_completed, static_cast<void*>(priv),
+										 MHD_OPTION_CONNECTION_TIMEOUT, priv->options.connectionTimeout,
+										 MHD_OPTION_END)))
+				{
+					auto err = ec.add(-1, "could not start HTTP daemon on unix socket '" + priv->options.unixSocket + "'");
+					SAS_LOG_ERROR(priv->logger, err);
+					close(fd);
+					unlink(priv->options.unixSocket.c_str());
+				}
+			}
+			if (!priv->unix_daemon)
+			{
+				if (priv->daemon)
+				{
+					SAS_LOG_TRACE(priv->logger, "MHD_stop_daemon");
+					MHD_stop_daemon(priv->daemon);
+					priv->daemon = nullptr;
+				}
+				return Status::CannotStart;
+			}
+		}
+#endif
+
+		if (!priv->daemon && !priv->unix_daemon)
+		{
+			auto err = ec.add(-1, "neither TCP nor unix socket listener is configured");
 			SAS_LOG_ERROR(priv->logger, err);
 			return Status::CannotStart;
 		}
@@ -537,9 +929,21 @@ namespace SAS {
         (void)ec;
         SAS_LOG_NDC();
 
-		SAS_LOG_TRACE(priv->logger, "MHD_stop_daemon");
-		MHD_stop_daemon(priv->daemon);
-		priv->daemon = nullptr;
+		if (priv->daemon)
+		{
+			SAS_LOG_TRACE(priv->logger, "MHD_stop_daemon");
+			MHD_stop_daemon(priv->daemon);
+			priv->daemon = nullptr;
+		}
+		if (priv->unix_daemon)
+		{
+			SAS_LOG_TRACE(priv->logger, "MHD_stop_daemon");
+			MHD_stop_daemon(priv->unix_daemon);
+			priv->unix_daemon = nullptr;
+#ifdef SAS_HTTP__HAVE_UNIX_SOCKET
+			unlink(priv->options.unixSocket.c_str());
+#endif
+		}
 
 		priv->runner_not.notify();
 
@@ -561,6 +965,27 @@ namespace SAS {
 		if(!priv->app->configReader()->getStringEntry(config_path + "/RESPONSE_CONTENT_TYPE", priv->options.responseContentType, "application/octet-stream", ec))
 			return false;
 
+		if(!priv->options.compression.build(config_path, priv->app->configReader(), ec))
+			return false;
+
+		if(!priv->app->configReader()->getStringEntry(config_path + "/UNIX_SOCKET", priv->options.unixSocket, std::string(), ec))
+			return false;
+
+		if(!priv->app->configReader()->getStringEntry(config_path + "/UNIX_SOCKET_MODE", priv->options.unixSocketMode, std::string(), ec))
+			return false;
+
+#ifndef SAS_HTTP__HAVE_UNIX_SOCKET
+		if (priv->options.unixSocket.length())
+		{
+			auto err = ec.add(-1, "unix socket is not supported on this platform: '" + priv->options.unixSocket + "'");
+			SAS_LOG_ERROR(priv->logger, err);
+			return false;
+		}
+#endif
+
+		if(!priv->app->configReader()->getBoolEntry(config_path + "/LISTEN_TCP", priv->options.listenTCP, true, ec))
+			return false;
+
 		return true;
 	}
 
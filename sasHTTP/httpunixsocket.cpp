@@ -0,0 +1,320 @@
+/*
+This file is part of sasHTTP.
+
+sasHTTP is free software: you can redistribute it and/or modify
+it under the terms of the Lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+sasHTTP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with sasHTTP.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "httpunixsocket.h"
+
+#ifdef SAS_HTTP__HAVE_UNIX_SOCKET
+
+#include <sasCore/errorcollector.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace SAS {
+
+	namespace {
+
+		bool iequals(const std::string & a, const char * b)
+		{
+			size_t l = strlen(b);
+			if (a.length() != l)
+				return false;
+			for (size_t i = 0; i < l; ++i)
+				if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i])))
+					return false;
+			return true;
+		}
+
+		const std::string * find_header(const HTTPHeaders & headers, const char * name)
+		{
+			for (auto & h : headers)
+				if (iequals(h.first, name))
+					return &h.second;
+			return nullptr;
+		}
+
+		std::string sys_error(const char * what)
+		{
+			return std::string() + what + ": '" + strerror(errno) + "'";
+		}
+
+	}
+
+	HTTPUnixSocketClient::HTTPUnixSocketClient(const std::string & path, std::chrono::seconds timeout) : _path(path), _timeout(timeout)
+	{ }
+
+	HTTPUnixSocketClient::~HTTPUnixSocketClient()
+	{
+		close();
+	}
+
+	//static
+	bool HTTPUnixSocketClient::isUnixURL(const std::string & url)
+	{
+		return url.compare(0, 5, "unix:") == 0;
+	}
+
+	//static
+	std::string HTTPUnixSocketClient::socketPath(const std::string & url)
+	{
+		auto path = url.substr(5);
+		if (path.compare(0, 3, "///") == 0)
+			path = path.substr(2);
+		return path;
+	}
+
+	void HTTPUnixSocketClient::close()
+	{
+		if (_fd >= 0)
+		{
+			::close(_fd);
+			_fd = -1;
+		}
+		_buffer.clear();
+	}
+
+	bool HTTPUnixSocketClient::connect(ErrorCollector & ec)
+	{
+		sockaddr_un addr = {};
+		if (_path.length() >= sizeof(addr.sun_path))
+		{
+			ec.add(-1, "unix socket path is too long: '" + _path + "'");
+			return false;
+		}
+		addr.sun_family = AF_UNIX;
+		memcpy(addr.sun_path, _path.c_str(), _path.length() + 1);
+
+		if ((_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+		{
+			ec.add(-1, sys_error("could not create unix socket"));
+			return false;
+		}
+		if (_timeout.count() > 0)
+		{
+			timeval tv = {};
+			tv.tv_sec = static_cast<time_t>(_timeout.count());
+			if (setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) != 0 ||
+				setsockopt(_fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) != 0)
+			{
+				ec.add(-1, sys_error("could not set timeout of unix socket"));
+				close();
+				return false;
+			}
+		}
+		if (::connect(_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+		{
+			ec.add(-1, sys_error(("could not connect to unix socket '" + _path + "'").c_str()));
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	bool HTTPUnixSocketClient::send_all(const char * data, size_t size, ErrorCollector & ec)
+	{
+		while (size)
+		{
+			auto ret = ::send(_fd, data, size, MSG_NOSIGNAL);
+			if (ret < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				if (errno == EAGAIN || errno == EWOULDBLOCK)
+					ec.add(-1, "sending data to unix socket is timed out");
+				else
+				{
+					_stale = !_received && (errno == EPIPE || errno == ECONNRESET);
+					ec.add(-1, sys_error("could not send data to unix socket"));
+				}
+				return false;
+			}
+			data += ret;
+			size -= static_cast<size_t>(ret);
+		}
+		return true;
+	}
+
+	bool HTTPUnixSocketClient::receive(ErrorCollector & ec)
+	{
+		char buff[16 * 1024];
+		ssize_t ret;
+		while ((ret = ::recv(_fd, buff, sizeof(buff), 0)) < 0 && errno == EINTR)
+			;
+		if (ret < 0)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				ec.add(-1, "receiving data from unix socket is timed out");
+			else
+			{
+				_stale = !_received && errno == ECONNRESET;
+				ec.add(-1, sys_error("could not receive data from unix socket"));
+			}
+			return false;
+		}
+		if (ret == 0)
+		{
+			_stale = !_received;
+			ec.add(-1, "connection is closed by the peer");
+			return false;
+		}
+		_buffer.insert(_buffer.end(), buff, buff + ret);
+		_received = true;
+		return true;
+	}
+
+	bool HTTPUnixSocketClient::read_response(int & status, HTTPHeaders & headers, std::vector<char> & body, bool & keep_alive, ErrorCollector & ec)
+	{
+		static const char crlf2[] = "\r\n\r\n";
+		std::vector<char>::iterator head_end;
+		while ((head_end = std::search(_buffer.begin(), _buffer.end(), crlf2, crlf2 + 4)) == _buffer.end())
+			if (!receive(ec))
+				return false;
+
+		std::string head(_buffer.begin(), head_end);
+		_buffer.erase(_buffer.begin(), head_end + 4);
+
+		size_t line_end = head.find("\r\n");
+		auto status_line = head.substr(0, line_end);
+		auto sp = status_line.find(' ');
+		if (status_line.compare(0, 5, "HTTP/") != 0 || sp == std::string::npos)
+		{
+			ec.add(-1, "invalid HTTP status line: '" + status_line + "'");
+			return false;
+		}
+		status = atoi(status_line.c_str() + sp + 1);
+		keep_alive = status_line.compare(0, 8, "HTTP/1.0") != 0;
+
+		headers.clear();
+		while (line_end != std::string::npos)
+		{
+			auto b = line_end + 2;
+			line_end = head.find("\r\n", b);
+			auto line = head.substr(b, line_end == std::string::npos ? std::string::npos : line_end - b);
+			auto colon = line.find(':');
+			if (colon == std::string::npos)
+				continue;
+			auto value_b = line.find_first_not_of(" \t", colon + 1);
+			auto value_e = line.find_last_not_of(" \t");
+			headers.push_back(std::make_pair(line.substr(0, colon),
+				value_b == std::string::npos ? std::string() : line.substr(value_b, value_e - value_b + 1)));
+		}
+
+		if (auto connection = find_header(headers, "Connection"))
+			keep_alive = !iequals(*connection, "close");
+
+		body.clear();
+		auto transfer_encoding = find_header(headers, "Transfer-Encoding");
+		if (transfer_encoding && iequals(*transfer_encoding, "chunked"))
+		{
+			while (true)
+			{
+				static const char crlf[] = "\r\n";
+				std::vector<char>::iterator size_end;
+				while ((size_end = std::search(_buffer.begin(), _buffer.end(), crlf, crlf + 2)) == _buffer.end())
+					if (!receive(ec))
+						return false;
+				size_t chunk_size = strtoul(std::string(_buffer.begin(), size_end).c_str(), nullptr, 16);
+				_buffer.erase(_buffer.begin(), size_end + 2);
+				while (_buffer.size() < chunk_size + 2)
+					if (!receive(ec))
+						return false;
+				if (!chunk_size)
+				{
+					// no trailers are sent by the interface
+					_buffer.erase(_buffer.begin(), _buffer.begin() + 2);
+					break;
+				}
+				body.insert(body.end(), _buffer.begin(), _buffer.begin() + chunk_size);
+				_buffer.erase(_buffer.begin(), _buffer.begin() + chunk_size + 2);
+			}
+		}
+		else if (auto content_length = find_header(headers, "Content-Length"))
+		{
+			size_t size = strtoull(content_length->c_str(), nullptr, 10);
+			while (_buffer.size() < size)
+				if (!receive(ec))
+					return false;
+			body.assign(_buffer.begin(), _buffer.begin() + size);
+			_buffer.erase(_buffer.begin(), _buffer.begin() + size);
+		}
+		else
+		{
+			// body is terminated by closing the connection
+			NullEC nec;
+			while (receive(nec))
+				;
+			body.swap(_buffer);
+			keep_alive = false;
+		}
+
+		return true;
+	}
+
+	bool HTTPUnixSocketClient::request(const std::string & method, const std::string & target, const HTTPHeaders & headers, const char * body, size_t body_size,
+		int & status, HTTPHeaders & response_headers, std::vector<char> & response_body, ErrorCollector & ec)
+	{
+		std::string head = method + " " + target + " HTTP/1.1\r\nHost: localhost\r\nUser-Agent: SAS/1.0\r\n";
+		for (auto & h : headers)
+			head += h.first + ": " + h.second + "\r\n";
+		head += "\r\n";
+
+		// a kept-alive connection may have been closed by the server meanwhile, then it is tried once more on a new connection;
+		// only when the server could not have got the request: the write or the first read failed as the peer had closed the connection
+		for (int attempt = 0; attempt < 2; ++attempt)
+		{
+			bool reused = _fd >= 0;
+			if (!reused && !connect(ec))
+				return false;
+			_received = false;
+			_stale = false;
+
+			NullEC nec;
+			ErrorCollector & _ec = reused ? static_cast<ErrorCollector&>(nec) : ec;
+
+			bool keep_alive = false;
+			if (send_all(head.data(), head.length(), _ec) &&
+				(!body_size || send_all(body, body_size, _ec)) &&
+				read_response(status, response_headers, response_body, keep_alive, _ec))
+			{
+				if (!keep_alive)
+					close();
+				return true;
+			}
+
+			close();
+			if (!reused)
+				return false;
+			if (!_stale)
+			{
+				ec.add(-1, "connection is broken while sending the request or receiving the response");
+				return false;
+			}
+		}
+		return false;
+	}
+
+}
+
+#endif // SAS_HTTP__HAVE_UNIX_SOCKET
@@ -0,0 +1,75 @@
+/*
+This file is part of sasHTTP.
+
+sasHTTP is free software: you can redistribute it and/or modify
+it under the terms of the Lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+sasHTTP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with sasHTTP.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef sasHTTP__httpunixsocket_h
+#define sasHTTP__httpunixsocket_h
+
+#include "config.h"
+#include "httpcommon.h"
+
+#include <sasCore/defines.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#if SAS_OS == SAS_OS_LINUX
+#  define SAS_HTTP__HAVE_UNIX_SOCKET
+#endif
+
+#ifdef SAS_HTTP__HAVE_UNIX_SOCKET
+
+namespace SAS {
+
+	class ErrorCollector;
+
+	// minimal HTTP/1.1 client over a Unix domain socket (neon supports TCP only)
+	class HTTPUnixSocketClient
+	{
+		SAS_COPY_PROTECTOR(HTTPUnixSocketClient)
+
+		std::string _path;
+		std::chrono::seconds _timeout;
+		int _fd = -1;
+		std::vector<char> _buffer; // received but not processed data
+		bool _received = false; // any data has been received for the current request
+		bool _stale = false; // the connection has been found closed by the peer before anything was received
+
+		bool connect(ErrorCollector & ec);
+		bool send_all(const char * data, size_t size, ErrorCollector & ec);
+		bool receive(ErrorCollector & ec);
+		bool read_response(int & status, HTTPHeaders & headers, std::vector<char> & body, bool & keep_alive, ErrorCollector & ec);
+	public:
+		// zero timeout means blocking without limit
+		HTTPUnixSocketClient(const std::string & path, std::chrono::seconds timeout);
+		~HTTPUnixSocketClient();
+
+		// 'unix:<path>' or 'unix://<path>'
+		static bool isUnixURL(const std::string & url);
+		static std::string socketPath(const std::string & url);
+
+		bool request(const std::string & method, const std::string & target, const HTTPHeaders & headers, const char * body, size_t body_size,
+			int & status, HTTPHeaders & response_headers, std::vector<char> & response_body, ErrorCollector & ec);
+
+		void close();
+	};
+
+}
+
+#endif // SAS_HTTP__HAVE_UNIX_SOCKET
+
+#endif // sasHTTP__httpunixsocket_h
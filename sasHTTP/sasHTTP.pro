@@ -13,8 +13,14 @@ CONFIG(SAS_LOG4CXX_ENABLED) {
     DEFINES += SAS_LOG4CXX_ENABLED
 }
 
+CONFIG(SAS_HTTP_ZSTD) {
+    LIBS += -lzstd
+    DEFINES += SAS_HTTP__HAVE_ZSTD
+}
+
 LIBS += -lneon
 LIBS += -lmicrohttpd
+LIBS += -lz
 LIBS += -L../sasCore -lsasCore
 LIBS += -L../sasJSON -lsasJSON
 
@@ -22,11 +28,17 @@ SOURCES += \
     httpcomponent.cpp \
     httpconnector.cpp \
     httpinterface.cpp \
-    httpconnectorfactory.cpp
+    httpconnectorfactory.cpp \
+    httpbatch.cpp \
+    httpcompression.cpp \
+    httpunixsocket.cpp
 
 HEADERS += \
     config.h \
     httpcommon.h \
     httpconnector.h \
     httpinterface.h \
-    httpconnectorfactory.h
+    httpconnectorfactory.h \
+    httpbatch.h \
+    httpcompression.h \
+    httpunixsocket.h
@@ -15,11 +15,52 @@
 
 #include <memory>
 #include <vector>
+#include <string>
+#include <utility>
+#include <functional>
 
 namespace SAS {
 
 class ErrorCollector;
 
+// MQTT 5 properties of a message, they are ignored by earlier protocol versions
+struct MQTTMessageProperties
+{
+	std::string responseTopic;
+	std::vector<char> correlationData;
+	std::vector<std::pair<std::string, std::string>> userProperties;
+};
+
+// received message, its payload is kept in the buffer of the MQTT library until the last reference is released
+class SAS_MQTT__CLASS MQTTMessage
+{
+	SAS_COPY_PROTECTOR(MQTTMessage);
+
+	std::string _topic;
+	const char * _payload;
+	size_t _payload_size;
+	int _qos;
+	MQTTMessageProperties _properties;
+	std::function<void()> _release;
+public:
+	MQTTMessage(std::string topic, const char * payload, size_t payload_size, int qos, MQTTMessageProperties properties, std::function<void()> release);
+	~MQTTMessage();
+
+	// the message owns a copy of the payload
+	static std::shared_ptr<MQTTMessage> create(const std::string & topic, const std::vector<char> & payload, int qos, const MQTTMessageProperties & properties);
+
+	// the buffer is not released by this object
+	void detach();
+
+	inline const std::string & topic() const { return _topic; }
+	inline const char * payload() const { return _payload; }
+	inline size_t payloadSize() const { return _payload_size; }
+	inline int qos() const { return _qos; }
+	inline const MQTTMessageProperties & properties() const { return _properties; }
+};
+
+typedef std::shared_ptr<MQTTMessage> MQTTMessagePtr;
+
 class SAS_MQTT__CLASS MQTTAsync
 {
 	friend struct MQTTAsync_priv;
@@ -47,13 +88,22 @@ public:
     bool unsubscribe(ErrorCollector & ec);
 
 	bool send(const std::string & topic, const std::vector<char> & payload, int qos, ErrorCollector & ec);
+	bool send(const std::string & topic, const std::vector<char> & payload, int qos, const MQTTMessageProperties & properties, ErrorCollector & ec);
+	// sends exactly 'payload_size' bytes, the vector based variants above drop the last byte (terminating zero) of the payload
+	bool send(const std::string & topic, const char * payload, size_t payload_size, int qos, const MQTTMessageProperties & properties, ErrorCollector & ec);
 
 	bool run(ErrorCollector & ec);
 	bool shutdown(ErrorCollector & ec);
 
 	const MQTTConnectionOptions & connectOptions() const;
+	const std::string & clientId() const;
 protected:
 	virtual bool messageArrived(const std::string & topic, const std::vector<char> & payload, int qos) = 0;
+	// called for every message, the default implementation ignores the properties
+	virtual bool messageArrived(const std::string & topic, const std::vector<char> & payload, int qos, const MQTTMessageProperties & properties);
+	// called for every message without copying its payload, the default implementation copies it for the variants above
+	// if false is returned, the message is redelivered, then no reference may be kept
+	virtual bool messageArrived(const MQTTMessagePtr & message);
 
 };
 
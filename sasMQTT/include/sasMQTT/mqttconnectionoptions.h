@@ -69,6 +69,10 @@ namespace SAS {
         std::chrono::milliseconds publishTimeout() const;
         void setPublishTimeout(std::chrono::milliseconds v) const;
 
+        // 0: default of the MQTT library, 3: 3.1, 4: 3.1.1, 5: 5.0
+        int mqttVersion() const;
+        void setMqttVersion(int v) const;
+
 
 		bool build(const std::string & config_path, ConfigReader * cr, ErrorCollector & ec);
         bool build(const std::string & connection_str, const std::string & config_path, ConfigReader * cr, ErrorCollector & ec);
@@ -89,21 +89,38 @@ struct MQTTAsync::Priv
 		return true;
     }
 
+	bool isV5() const
+	{
+		return options.mqttVersion() == MQTTVERSION_5;
+	}
+
 	bool connect(ErrorCollector & ec)
 	{
 		SAS_LOG_NDC();
 
 		std::unique_lock<std::mutex> __locker(mut);
 
-		MQTTAsync_connectOptions conn_opts = MQTTAsync_connectOptions_initializer;
+		MQTTAsync_connectOptions v3_opts = MQTTAsync_connectOptions_initializer;
+		MQTTAsync_connectOptions v5_opts = MQTTAsync_connectOptions_initializer5;
+		MQTTAsync_connectOptions & conn_opts = isV5() ? v5_opts : v3_opts;
         conn_opts.keepAliveInterval = static_cast<int>(options.keepalive().count());
 		conn_opts.automaticReconnect = 0;
-        conn_opts.cleansession = static_cast<int>(options.cleanSession());
+		if (isV5())
+		{
+			conn_opts.cleanstart = static_cast<int>(options.cleanSession());
+			conn_opts.onSuccess5 = Priv::_onConnected5;
+			conn_opts.onFailure5 = Priv::_onConnectionFailed5;
+		}
+		else
+		{
+			conn_opts.MQTTVersion = options.mqttVersion();
+			conn_opts.cleansession = static_cast<int>(options.cleanSession());
+			conn_opts.onSuccess = Priv::_onConnected;
+			conn_opts.onFailure = Priv::_onConnectionFailed;
+		}
         conn_opts.username = options.username().c_str();
         conn_opts.password = options.password().c_str();
 		conn_opts.context = this;
-		conn_opts.onSuccess = Priv::_onConnected;
-		conn_opts.onFailure = Priv::_onConnectionFailed;
 		conn_opts.maxInflight = 100;
         conn_opts.connectTimeout = static_cast<int>(options.connectTimeout().count());
 		int rc;
@@ -145,19 +162,47 @@ struct MQTTAsync::Priv
 		auto priv = (Priv*)context;
 		SAS_LOG_ASSERT(priv->logger, message, "'message' must be not NULL");
 
-		std::string _topic;
-		_topic.append((const char *) topicName, topicLen);
-		std::vector<char> _payload(message->payloadlen);
-		memcpy(_payload.data(), message->payload, message->payloadlen);
-        auto _qos = message->qos;
+		// topicLen is 0 if the topic is zero terminated
+		std::string _topic(topicName, topicLen > 0 ? static_cast<size_t>(topicLen) : strlen(topicName));
 
-        if(!priv->that->messageArrived(_topic, _payload, _qos))
-            return 0; //_messageArrived will be reinvoked, do not destroy here!
+		MQTTMessageProperties _properties;
+		for (int i = 0; i < message->properties.count; ++i)
+		{
+			auto & prop = message->properties.array[i];
+			switch (prop.identifier)
+			{
+			case MQTTPROPERTY_CODE_RESPONSE_TOPIC:
+				_properties.responseTopic.assign(prop.value.data.data, prop.value.data.len);
+				break;
+			case MQTTPROPERTY_CODE_CORRELATION_DATA:
+				_properties.correlationData.assign(prop.value.data.data, prop.value.data.data + prop.value.data.len);
+				break;
+			case MQTTPROPERTY_CODE_USER_PROPERTY:
+				_properties.userProperties.push_back(std::make_pair(
+					std::string(prop.value.data.data, prop.value.data.len),
+					std::string(prop.value.value.data, prop.value.value.len)));
+				break;
+			default:
+				break;
+			}
+		}
 
-		SAS_LOG_TRACE(priv->logger, "MQTTAsync_freeMessage");
-		MQTTAsync_freeMessage(&message);
-		SAS_LOG_TRACE(priv->logger, "MQTTAsync_free");
-		MQTTAsync_free(topicName);
+		// the payload is released with the last reference of the message, it can be later than this callback returns
+		auto logger = priv->logger;
+		auto _message = std::make_shared<MQTTMessage>(std::move(_topic), static_cast<const char *>(message->payload), static_cast<size_t>(message->payloadlen),
+			message->qos, std::move(_properties), [logger, message, topicName]() mutable
+			{
+				SAS_LOG_TRACE(logger, "MQTTAsync_freeMessage");
+				MQTTAsync_freeMessage(&message);
+				SAS_LOG_TRACE(logger, "MQTTAsync_free");
+				MQTTAsync_free(topicName);
+			});
+
+        if(!priv->that->messageArrived(_message))
+		{
+			_message->detach();
+            return 0; //_messageArrived will be reinvoked, do not destroy here!
+		}
 
         return 1;
 	}
@@ -180,6 +225,21 @@ struct MQTTAsync::Priv
 		priv->conn_not.notify();
 	}
 
+	static void _onConnected5(void* context, MQTTAsync_successData5* response)
+	{
+        (void)response;
+		_onConnected(context, nullptr);
+	}
+
+	static void _onConnectionFailed5(void* context, MQTTAsync_failureData5* response)
+	{
+		MQTTAsync_failureData data = {};
+		data.token = response->token;
+		data.code = response->code;
+		data.message = response->message;
+		_onConnectionFailed(context, &data);
+	}
+
 	static void _onConnectionFailed(void* context, MQTTAsync_failureData* response)
 	{
 		SAS_LOG_NDC();
@@ -200,6 +260,21 @@ struct MQTTAsync::Priv
 		priv->disconn_not.notify();
 	}
 
+	static void _onDisconnected5(void* context, MQTTAsync_successData5* response)
+	{
+        (void)response;
+		_onDisconnected(context, nullptr);
+	}
+
+	static void _onDisconnectFailed5(void * context, MQTTAsync_failureData5* response)
+	{
+		MQTTAsync_failureData data = {};
+		data.token = response->token;
+		data.code = response->code;
+		data.message = response->message;
+		_onDisconnectFailed(context, &data);
+	}
+
 	static void _onDisconnectFailed(void * context, MQTTAsync_failureData* response)
 	{
 		SAS_LOG_NDC();
@@ -265,8 +340,11 @@ bool MQTTAsync::init(const MQTTConnectionOptions & conn_opts, ErrorCollector & e
 	SAS_LOG_VAR(priv->logger, priv->client_id);
 
 	int rc;
-	SAS_LOG_TRACE(priv->logger, "MQTTAsync_create");
-    if ((rc = MQTTAsync_create(&priv->mqtt_handle, conn_opts.serverUri().c_str(), priv->client_id.c_str(), MQTTCLIENT_PERSISTENCE_NONE, NULL)) != MQTTASYNC_SUCCESS)
+	MQTTAsync_createOptions create_opts = MQTTAsync_createOptions_initializer;
+	if (conn_opts.mqttVersion() == MQTTVERSION_5)
+		create_opts.MQTTVersion = MQTTVERSION_5;
+	SAS_LOG_TRACE(priv->logger, "MQTTAsync_createWithOptions");
+    if ((rc = MQTTAsync_createWithOptions(&priv->mqtt_handle, conn_opts.serverUri().c_str(), priv->client_id.c_str(), MQTTCLIENT_PERSISTENCE_NONE, NULL, &create_opts)) != MQTTASYNC_SUCCESS)
 	{
 		auto err = ec.add(-1, "could not initialize MQTT ("+std::to_string(rc)+")");
 		SAS_LOG_ERROR(priv->logger, err);
@@ -318,11 +396,21 @@ bool MQTTAsync::disconnect(ErrorCollector & ec)
 
 	int rc;
 	SAS_LOG_TRACE(priv->logger, "MQTTAsync_disconnect");
-	MQTTAsync_disconnectOptions ops = MQTTAsync_disconnectOptions_initializer;
+	MQTTAsync_disconnectOptions v3_ops = MQTTAsync_disconnectOptions_initializer;
+	MQTTAsync_disconnectOptions v5_ops = MQTTAsync_disconnectOptions_initializer5;
+	MQTTAsync_disconnectOptions & ops = priv->isV5() ? v5_ops : v3_ops;
 	priv->ec = &ec;
 	ops.context = priv;
-	ops.onSuccess = Priv::_onDisconnected;
-	ops.onFailure = Priv::_onDisconnectFailed;
+	if (priv->isV5())
+	{
+		ops.onSuccess5 = Priv::_onDisconnected5;
+		ops.onFailure5 = Priv::_onDisconnectFailed5;
+	}
+	else
+	{
+		ops.onSuccess = Priv::_onDisconnected;
+		ops.onFailure = Priv::_onDisconnectFailed;
+	}
 	if ((rc = MQTTAsync_disconnect(priv->mqtt_handle, &ops)) != MQTTASYNC_SUCCESS)
 	{
 		auto err = ec.add(-1, "could not disconnect from MQTT server (" + std::to_string(rc) + ")");
@@ -480,6 +568,116 @@ bool MQTTAsync::send(const std::string & topic, const std::vector<char> & payloa
 	return true;
 }
 
+bool MQTTAsync::send(const std::string & topic, const std::vector<char> & payload, int qos, const MQTTMessageProperties & properties, ErrorCollector & ec)
+{
+	return send(topic, payload.data(), payload.size() ? payload.size() - 1 : 0, qos, properties, ec);
+}
+
+bool MQTTAsync::send(const std::string & topic, const char * payload, size_t payload_size, int qos, const MQTTMessageProperties & properties, ErrorCollector & ec)
+{
+	SAS_LOG_NDC();
+
+	MQTTAsync_message msg = MQTTAsync_message_initializer;
+	msg.payload = (void*)payload;
+	msg.payloadlen = static_cast<int>(payload_size);
+	msg.qos = qos;
+
+	auto add_property = [&msg](enum MQTTPropertyCodes id, const std::string & data, const std::string & value)
+	{
+		MQTTProperty prop;
+		prop.identifier = id;
+		prop.value.data.data = (char*)data.data();
+		prop.value.data.len = static_cast<int>(data.length());
+		prop.value.value.data = (char*)value.data();
+		prop.value.value.len = static_cast<int>(value.length());
+		return MQTTProperties_add(&msg.properties, &prop) == 0;
+	};
+
+	// the properties are referenced until the message is sent
+	std::string correlation_data(properties.correlationData.begin(), properties.correlationData.end());
+	static const std::string none;
+	bool props_ok = true;
+	if (priv->isV5())
+	{
+		if (properties.responseTopic.length())
+			props_ok &= add_property(MQTTPROPERTY_CODE_RESPONSE_TOPIC, properties.responseTopic, none);
+		if (correlation_data.length())
+			props_ok &= add_property(MQTTPROPERTY_CODE_CORRELATION_DATA, correlation_data, none);
+		for (auto & p : properties.userProperties)
+			props_ok &= add_property(MQTTPROPERTY_CODE_USER_PROPERTY, p.first, p.second);
+	}
+	if (!props_ok)
+	{
+		MQTTProperties_free(&msg.properties);
+		auto err = ec.add(-1, "could not set MQTT message properties");
+		SAS_LOG_ERROR(priv->logger, err);
+		return false;
+	}
+
+	MQTTAsync_responseOptions resp = MQTTAsync_responseOptions_initializer;
+
+	int rc;
+	SAS_LOG_TRACE(priv->logger, "MQTTAsync_sendMessage");
+	rc = MQTTAsync_sendMessage(priv->mqtt_handle, topic.c_str(), &msg, &resp);
+	MQTTProperties_free(&msg.properties);
+	if (rc != MQTTASYNC_SUCCESS)
+	{
+		auto err = ec.add(-1, "could not send MQTT message ("+std::to_string(rc)+")");
+		SAS_LOG_ERROR(priv->logger, err);
+		return false;
+	}
+    if (priv->options.publishTimeout().count() > 0)
+	{
+		SAS_LOG_TRACE(priv->logger, "MQTTAsync_waitForCompletion");
+        if ((rc = MQTTAsync_waitForCompletion(priv->mqtt_handle, resp.token, static_cast<unsigned long>(priv->options.publishTimeout().count())) != MQTTASYNC_SUCCESS))
+		{
+			auto err = ec.add(-1, "MQTT message is lost (" + std::to_string(rc) + ")");
+			SAS_LOG_ERROR(priv->logger, err);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+MQTTMessage::MQTTMessage(std::string topic, const char * payload, size_t payload_size, int qos, MQTTMessageProperties properties, std::function<void()> release) :
+	_topic(std::move(topic)),
+	_payload(payload),
+	_payload_size(payload_size),
+	_qos(qos),
+	_properties(std::move(properties)),
+	_release(std::move(release))
+{ }
+
+MQTTMessage::~MQTTMessage()
+{
+	if (_release)
+		_release();
+}
+
+//static
+MQTTMessagePtr MQTTMessage::create(const std::string & topic, const std::vector<char> & payload, int qos, const MQTTMessageProperties & properties)
+{
+	auto buffer = std::make_shared<std::vector<char>>(payload);
+	return std::make_shared<MQTTMessage>(topic, buffer->data(), buffer->size(), qos, properties, [buffer]() { });
+}
+
+void MQTTMessage::detach()
+{
+	_release = nullptr;
+}
+
+bool MQTTAsync::messageArrived(const MQTTMessagePtr & message)
+{
+	return messageArrived(message->topic(), std::vector<char>(message->payload(), message->payload() + message->payloadSize()), message->qos(), message->properties());
+}
+
+bool MQTTAsync::messageArrived(const std::string & topic, const std::vector<char> & payload, int qos, const MQTTMessageProperties & properties)
+{
+	(void)properties;
+	return messageArrived(topic, payload, qos);
+}
+
 bool MQTTAsync::run(ErrorCollector & ec)
 {
 	//SAS_LOG_NDC();
@@ -503,4 +701,9 @@ const MQTTConnectionOptions & MQTTAsync::connectOptions() const
 	return priv->options;
 }
 
+const std::string & MQTTAsync::clientId() const
+{
+	return priv->client_id;
+}
+
 }
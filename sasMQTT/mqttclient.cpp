@@ -124,18 +124,15 @@ namespace SAS {
 		protected:
 			virtual bool messageArrived(const std::string & topic, const std::vector<char> & payload, int qos) override
 			{
-				if (!ticket_mut.try_lock())
-					return false;
+				std::unique_lock<std::mutex> __ticket_locker(ticket_mut);
 				if (ticket)
 				{
 					ticket->topic = topic;
 					ticket->payload = payload;
 					ticket->qos = qos;
 					ticket->notifier.notify();
-					ticket_mut.unlock();
 					return true;
 				}
-				ticket_mut.unlock();
 				return false;
 			}
 		} async;
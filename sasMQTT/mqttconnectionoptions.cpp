@@ -49,6 +49,7 @@ namespace SAS {
         std::chrono::milliseconds receive_timeout;
         std::chrono::milliseconds publish_timeout;
 
+        int mqttVersion = 0;
     };
 
     MQTTConnectionOptions::MQTTConnectionOptions() : p(new Priv)
@@ -166,6 +167,17 @@ namespace SAS {
     }
 
 
+    int MQTTConnectionOptions::mqttVersion() const
+    {
+        return p->mqttVersion;
+    }
+
+    void MQTTConnectionOptions::setMqttVersion(int v) const
+    {
+        p->mqttVersion = v;
+    }
+
+
     bool MQTTConnectionOptions::build(const std::string & config_path, ConfigReader * cr, ErrorCollector & ec)
     {
         SAS_LOG_NDC();
@@ -302,6 +314,15 @@ namespace SAS {
 			return false;
         p->receive_timeout = std::chrono::milliseconds(ll_tmp);
 
+        if(!cr->getNumberEntry(config_path + "/MQTT_VERSION", ll_tmp, p->mqttVersion, ec))
+			return false;
+        if(ll_tmp != 0 && ll_tmp != 3 && ll_tmp != 4 && ll_tmp != 5)
+        {
+            ec.add(-1, "invalid value of 'MQTT_VERSION': " + std::to_string(ll_tmp));
+            return false;
+        }
+        p->mqttVersion = static_cast<int>(ll_tmp);
+
 		return true;
 	}
 
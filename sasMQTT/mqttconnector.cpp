@@ -23,127 +23,332 @@ along with sasMQTT.  If not, see <http://www.gnu.org/licenses/>
 #include <sasCore/tools.h>
 #include <sasCore/configreader.h>
 #include <sasCore/session.h>
+#include <sasCore/notifier.h>
 
-#include "include/sasMQTT/mqttclient.h"
+#include "include/sasMQTT/mqttasync.h"
 #include "include/sasMQTT/mqttconnectionoptions.h"
 
 #include <rapidjson/document.h>
 
-#include <sstream>
+#include <atomic>
 #include <mutex>
+#include <unordered_map>
 
 namespace SAS {
 
-	class MQTTCaller
+	// one persistent response subscription per connector, responses are matched to the pending calls by their sequence number
+	class MQTTResponseDispatcher : public MQTTAsync
 	{
+		struct Waiter
+		{
+			std::string result;
+			std::vector<std::string> arguments;
+			std::vector<char> payload;
+
+			Notifier notifier;
+		};
+
+		enum { ShardCount = 16 };
+		struct Shard
+		{
+			std::mutex mut;
+			std::unordered_map<unsigned long long, Waiter*> waiters;
+		} shards[ShardCount];
+
 		Logging::LoggerPtr _logger;
-		std::string _module;
-		std::string _clientId;
-		MQTTClient _client;
-		std::mutex mut;
-		long _rec_count = 0;
+		std::atomic<unsigned long long> _seq;
+		std::string _reply_key;
+		std::string _response_prefix;
+		std::string _response_topic;
+		std::string _legacy_prefix;
+		bool _v5 = false;
+		bool _shared_topic = false;
+
+		std::mutex _subscribe_mut;
+		bool _subscribed = false;
+
+		Shard & shard(unsigned long long seq)
+		{
+			return shards[seq % ShardCount];
+		}
+
 	public:
-		MQTTCaller(const std::string & module, const std::string & name) :
-			_logger(Logging::getLogger("SAS.MQTTCaller." + module + "." + name)),
-			_module(module),
-			_client(name)
+		MQTTResponseDispatcher(const std::string & name) : MQTTAsync(name),
+			_logger(Logging::getLogger("SAS.MQTTResponseDispatcher." + name)),
+			_seq(0)
 		{ }
 
-		~MQTTCaller()
+		virtual ~MQTTResponseDispatcher() override
 		{
-			_client.deinit();
+			deinit();
 		}
 
-		bool init(const MQTTConnectionOptions & options, ErrorCollector & ec)
+		bool init(const MQTTConnectionOptions & options, bool shared_topic, ErrorCollector & ec)
 		{
 			SAS_LOG_NDC();
-			std::unique_lock<std::mutex> __locker(mut);
-			if (!_client.init(options, ec))
+			if (!MQTTAsync::init(options, ec))
 				return false;
-            _clientId = options.clientId();
-			return _client.connect(ec);
+			_reply_key = clientId();
+			if (_reply_key.find_first_of("/+#@") != std::string::npos)
+			{
+				auto err = ec.add(-1, "client id cannot be used as reply key: '" + _reply_key + "'");
+				SAS_LOG_ERROR(_logger, err);
+				return false;
+			}
+			_response_topic = "sas/response/" + _reply_key;
+			_response_prefix = _response_topic + "/";
+			_legacy_prefix = "sas/response/" + _reply_key + "_";
+			_v5 = options.mqttVersion() == 5;
+			_shared_topic = shared_topic;
+			return true;
 		}
 
-		bool connect(ErrorCollector & ec)
+		bool subscribeResponses(ErrorCollector & ec)
 		{
-			return _client.connect(ec);
+			std::unique_lock<std::mutex> __locker(_subscribe_mut);
+			// legacy responses are subscribed call by call
+			if (_subscribed || (!_v5 && !_shared_topic))
+				return true;
+			SAS_LOG_VAR(_logger, _response_prefix);
+			if (!subscribe(_response_prefix + "#", SAS_MQTT__QOS, ec))
+				return false;
+			_subscribed = true;
+			return true;
 		}
 
-		bool disconnect(long timeout, ErrorCollector & ec)
+		// the message id is '<seq>@<reply_key>', then the response is published to 'sas/response/<reply_key>/<seq>/<result>[/<arguments>]'
+		// without shared response topic the message id is '<reply_key>_<seq>', which every interface answers on 'sas/response/<reply_key>_<seq>/<result>[/<arguments>]'
+		// with MQTT 5 the request is published to '<module>/v5' and the response to 'sas/response/<reply_key>', the sequence number is the correlation data
+		bool exchange(const std::string & module, const std::string & func, const std::vector<std::string> & arguments, const std::vector<char> & input,
+			std::string & result, std::vector<std::string> & out_arguments, std::vector<char> & output, long receive_count, ErrorCollector & ec)
 		{
-			return _client.disconnect(timeout * 1000, ec);
+			SAS_LOG_NDC();
+			if (!subscribeResponses(ec))
+				return false;
+
+			unsigned long long seq = ++_seq;
+
+			std::string send_topic;
+			std::string legacy_topic;
+			MQTTMessageProperties properties;
+			if (_v5)
+			{
+				// MQTT 5: short fixed request topic, everything else is carried by properties
+				send_topic.reserve(module.length() + 3);
+				send_topic.append(module).append("/v5");
+				properties.responseTopic = _response_topic;
+				properties.correlationData.resize(sizeof(seq));
+				for (size_t i = 0; i < sizeof(seq); ++i)
+					properties.correlationData[i] = static_cast<char>((seq >> (8 * (sizeof(seq) - 1 - i))) & 0xff);
+				properties.userProperties.reserve(arguments.size() + 1);
+				properties.userProperties.push_back(std::make_pair(std::string("function"), func));
+				for (auto & a : arguments)
+					properties.userProperties.push_back(std::make_pair(std::string("argument"), a));
+			}
+			else if (_shared_topic)
+			{
+				auto seq_str = std::to_string(seq);
+				send_topic.reserve(module.length() + func.length() + seq_str.length() + _reply_key.length() + 3 + arguments.size() * 16);
+				send_topic.append(module).append(1, '/').append(func).append(1, '/').append(seq_str).append(1, '@').append(_reply_key);
+				for (auto & a : arguments)
+					send_topic.append(1, '/').append(a);
+			}
+			else
+			{
+				auto seq_str = std::to_string(seq);
+				send_topic.reserve(module.length() + func.length() + seq_str.length() + _reply_key.length() + 3 + arguments.size() * 16);
+				send_topic.append(module).append(1, '/').append(func).append(1, '/').append(_reply_key).append(1, '_').append(seq_str);
+				for (auto & a : arguments)
+					send_topic.append(1, '/').append(a);
+				legacy_topic = _legacy_prefix + seq_str + "/#";
+			}
+
+			Waiter w;
+			auto & sh = shard(seq);
+			{
+				std::unique_lock<std::mutex> __locker(sh.mut);
+				sh.waiters[seq] = &w;
+			}
+
+			if (legacy_topic.length())
+			{
+				SAS_LOG_VAR(_logger, legacy_topic);
+				if (!subscribe(legacy_topic, SAS_MQTT__QOS, ec))
+				{
+					std::unique_lock<std::mutex> __locker(sh.mut);
+					sh.waiters.erase(seq);
+					return false;
+				}
+			}
+
+			bool ret = wait(seq, w, send_topic, input, properties, receive_count, ec);
+
+			if (legacy_topic.length())
+			{
+				NullEC ec2;
+				unsubscribe(legacy_topic, ec2);
+			}
+
+			if (!ret)
+				return false;
+
+			result = std::move(w.result);
+			out_arguments = std::move(w.arguments);
+			output = std::move(w.payload);
+			return true;
 		}
 
-		void deinit()
+	protected:
+		virtual bool messageArrived(const std::string & topic, const std::vector<char> & payload, int qos) override
 		{
-			std::unique_lock<std::mutex> __locker(mut);
-			_client.deinit();
+			return messageArrived(MQTTMessage::create(topic, payload, qos, MQTTMessageProperties()));
 		}
 
-		bool msg_exchange(const std::string & topic, const std::vector<std::string> & arguments, const std::vector<char> & input, std::string & out_topic, std::vector<std::string> & out_arguments, std::vector<char> & output, long receive_count, ErrorCollector & ec)
+		// the payload is copied only once, directly into the waiting call
+		virtual bool messageArrived(const MQTTMessagePtr & message) override
 		{
 			SAS_LOG_NDC();
-			std::unique_lock<std::mutex> __locker(mut);
-			std::stringstream ss;
-			ss << Thread::getThreadId();
+			auto & properties = message->properties();
+			if (properties.correlationData.size() == sizeof(unsigned long long))
+			{
+				unsigned long long seq = 0;
+				for (auto c : properties.correlationData)
+					seq = (seq << 8) | static_cast<unsigned char>(c);
+
+				std::string result;
+				std::vector<std::string> arguments;
+				for (auto & p : properties.userProperties)
+				{
+					if (p.first == "result")
+						result = p.second;
+					else if (p.first == "argument")
+						arguments.push_back(p.second);
+				}
 
-			std::string msg_id = this->_clientId + "_" + std::to_string((unsigned long) this) + "_" + ss.str();
-			std::string send_topic = _module + "/" + topic + "/" + msg_id;
-			for (auto & a : arguments)
-				send_topic += "/" + a;
+				deliver(seq, result, arguments, message->payload(), message->payloadSize());
+				return true;
+			}
+
+			auto & topic = message->topic();
+
+			size_t b;
+			if (topic.compare(0, _response_prefix.length(), _response_prefix) == 0)
+				b = _response_prefix.length();
+			else if (topic.compare(0, _legacy_prefix.length(), _legacy_prefix) == 0)
+				b = _legacy_prefix.length();
+			else
+			{
+				SAS_LOG_WARN(_logger, "unexpected topic: '" + topic + "'");
+				return true;
+			}
+
+			auto e = topic.find('/', b);
+			if (e == std::string::npos || e == b)
+			{
+				SAS_LOG_WARN(_logger, "unexpected topic: '" + topic + "'");
+				return true;
+			}
+			unsigned long long seq = 0;
+			for (auto i = b; i < e; ++i)
+			{
+				if (topic[i] < '0' || topic[i] > '9')
+				{
+					SAS_LOG_WARN(_logger, "unexpected topic: '" + topic + "'");
+					return true;
+				}
+				seq = seq * 10 + static_cast<unsigned long long>(topic[i] - '0');
+			}
 
-			std::vector<char> _input(input.size()+1);
-			std::copy(input.begin(), input.end(), _input.begin());
+			std::vector<std::string> arguments;
+			b = e + 1;
+			e = topic.find('/', b);
+			auto result = topic.substr(b, e == std::string::npos ? std::string::npos : e - b);
+			while (e != std::string::npos)
+			{
+				b = e + 1;
+				e = topic.find('/', b);
+				arguments.push_back(topic.substr(b, e == std::string::npos ? std::string::npos : e - b));
+			}
 
-			std::vector<std::string> rec_subs_topic(1);
-			rec_subs_topic[0] = "sas/response/" + msg_id + "/#";
+			deliver(seq, result, arguments, message->payload(), message->payloadSize());
+			return true;
+		}
 
-			std::string rec_topic;
+	private:
+		bool wait(unsigned long long seq, Waiter & w, const std::string & send_topic, const std::vector<char> & input, const MQTTMessageProperties & properties, long receive_count, ErrorCollector & ec)
+		{
+			auto & sh = shard(seq);
 
 			SAS_LOG_VAR(_logger, send_topic);
-			SAS_LOG_VAR(_logger, rec_subs_topic[0]);
-			SAS_LOG_TRACE(_logger, "_client.exchange");
-			if (!_client.exchange(send_topic, _input, SAS_MQTT__QOS, rec_subs_topic, SAS_MQTT__QOS, rec_topic, output, receive_count, ec))
+			if (!send(send_topic, input.data(), input.size(), SAS_MQTT__QOS, properties, ec))
+			{
+				std::unique_lock<std::mutex> __locker(sh.mut);
+				sh.waiters.erase(seq);
 				return false;
+			}
 
-			SAS_LOG_VAR(_logger, rec_topic);
+			for (long i = 0; receive_count < 0 || i < receive_count; ++i)
+			{
+				if (w.notifier.wait(connectOptions().receiveTimeout()))
+					return true;
+			}
 
-			auto lst = str_split(rec_topic, '/');
-			if (lst.size() < 3)
 			{
-				auto err = ec.add(-1, "unexpected topic: '" + rec_topic + "'");
-				SAS_LOG_ERROR(_logger, err);
-				return false;
+				std::unique_lock<std::mutex> __locker(sh.mut);
+				// the response can arrive while the lock is acquired
+				if (!sh.waiters.erase(seq) && w.notifier.tryWait())
+					return true;
 			}
-			std::list<std::string> args;
-			size_t i(0);
-			for (auto & t : lst)
+
+			auto err = ec.add(-1, "could not get MQTT message: timeout reached");
+			SAS_LOG_ERROR(_logger, err);
+			return false;
+		}
+
+		void deliver(unsigned long long seq, std::string & result, std::vector<std::string> & arguments, const char * payload, size_t payload_size)
+		{
+			auto & sh = shard(seq);
+			std::unique_lock<std::mutex> __locker(sh.mut);
+			auto it = sh.waiters.find(seq);
+			if (it == sh.waiters.end())
 			{
-				switch (i++)
-				{
-				case 0:
-				case 1:
-					break;
-				case 2:
-					if (t != msg_id)
-					{
-						auto err = ec.add(-1, "unexpected error: caught an invalid message: '" + rec_topic + "'");
-						SAS_LOG_ERROR(_logger, err);
-						return false;
-					}
-					break;
-				case 3:
-					out_topic = t;
-					break;
-				default:
-					args.push_back(t);
-				}
+				SAS_LOG_DEBUG(_logger, "response without a pending call (late or duplicated): " + std::to_string(seq));
+				return;
 			}
+			auto w = it->second;
+			sh.waiters.erase(it);
+
+			// filled under the lock, the waiter may give up meanwhile
+			w->result.swap(result);
+			w->arguments.swap(arguments);
+			w->payload.assign(payload, payload + payload_size);
+			w->notifier.notify();
+		}
+	};
 
-			out_arguments.resize(args.size());
-			std::copy(args.begin(), args.end(), out_arguments.begin());
 
-			return true;
+	class MQTTCaller
+	{
+		Logging::LoggerPtr _logger;
+		std::string _module;
+		std::shared_ptr<MQTTResponseDispatcher> _dispatcher;
+	public:
+		MQTTCaller(const std::shared_ptr<MQTTResponseDispatcher> & dispatcher, const std::string & module, const std::string & name) :
+			_logger(Logging::getLogger("SAS.MQTTCaller." + module + "." + name)),
+			_module(module),
+			_dispatcher(dispatcher)
+		{ }
+
+		bool connect(ErrorCollector & ec)
+		{
+			return _dispatcher->subscribeResponses(ec);
+		}
+
+		bool msg_exchange(const std::string & topic, const std::vector<std::string> & arguments, const std::vector<char> & input, std::string & out_topic, std::vector<std::string> & out_arguments, std::vector<char> & output, long receive_count, ErrorCollector & ec)
+		{
+			SAS_LOG_NDC();
+			SAS_LOG_TRACE(_logger, "_dispatcher->exchange");
+			return _dispatcher->exchange(_module, topic, arguments, input, out_topic, out_arguments, output, receive_count, ec);
 		}
 
 		bool error_to_ec(const std::vector<char> & payload, ErrorCollector & ec)
@@ -199,7 +404,7 @@ namespace SAS {
 		long _receive_count = 0;
 
 	public:
-		MQTTConnection(const std::string & module, const std::string & invoker) : Connection(), MQTTCaller(module, invoker),
+		MQTTConnection(const std::shared_ptr<MQTTResponseDispatcher> & dispatcher, const std::string & module, const std::string & invoker) : Connection(), MQTTCaller(dispatcher, module, invoker),
 			_logger(Logging::getLogger("SAS.MQTTConnection." + module + "." + invoker)),
 			_invoker(invoker),
 			_module(module),
@@ -214,13 +419,9 @@ namespace SAS {
 			endSession(ec);
 		}
 
-		bool init(MQTTConnectionOptions & options, long receive_count, ErrorCollector & ec)
+		void init(long receive_count)
 		{
-			SAS_LOG_NDC();
-			if (!MQTTCaller::init(options, ec))
-				return false;
 			_receive_count = receive_count;
-			return true;
 		}
 
 		virtual bool getSession(ErrorCollector & ec) override
@@ -298,10 +499,23 @@ namespace SAS {
 			SAS_LOG_ERROR(_logger, err);
 			return Status::Error;
 		}
-		
-	private:
-		bool endSession(ErrorCollector & ec)
+
+		virtual bool setSessionId(SessionID sid) final
+		{
+			_session_id = sid;
+			return true;
+		}
+
+		virtual SessionID sessionId() const final
 		{
+			return _session_id;
+		}
+
+		virtual bool endSession(ErrorCollector & ec) final
+		{
+			if (!_session_id)
+				return true;
+
 			std::vector<std::string> in_args(1);
 			in_args[0] = std::to_string(_session_id);
 			std::string out_topic;
@@ -341,7 +555,9 @@ namespace SAS {
 
 		long rec_count = 10;
 		long disconnect_timeout = 0;
+		bool shared_response_topic = false;
 		MQTTConnectionOptions options;
+		std::shared_ptr<MQTTResponseDispatcher> dispatcher;
 	};
 
 	MQTTConnector::MQTTConnector(const std::string & name, Application * app) : Connector(),
@@ -369,24 +585,27 @@ namespace SAS {
         long long ll_tmp;
         if(!priv->app->configReader()->getNumberEntry(cfgPath + "/RECEIVE_COUNT", ll_tmp, priv->rec_count, ec))
             return false;
-        ll_tmp = priv->rec_count;
+        priv->rec_count = static_cast<long>(ll_tmp);
 
-        return true;
+        if(!priv->app->configReader()->getBoolEntry(cfgPath + "/SHARED_RESPONSE_TOPIC", priv->shared_response_topic, priv->shared_response_topic, ec))
+            return false;
+
+        priv->dispatcher = std::make_shared<MQTTResponseDispatcher>(priv->name);
+        return priv->dispatcher->init(priv->options, priv->shared_response_topic, ec);
     }
 
 	bool MQTTConnector::connect(ErrorCollector & ec)
 	{
-        (void)ec;
 		SAS_LOG_NDC();
-		// nothing to do
-		return true;
+		return priv->dispatcher->subscribeResponses(ec);
 	}
 
 	Connection * MQTTConnector::createConnection(const std::string & module_name, const std::string & invoker_name, ErrorCollector & ec)
 	{
 		SAS_LOG_NDC();
-		auto conn = new MQTTConnection(module_name, invoker_name);
-		if (!conn->init(priv->options, priv->rec_count, ec) || !conn->connect(ec))
+		auto conn = new MQTTConnection(priv->dispatcher, module_name, invoker_name);
+		conn->init(priv->rec_count);
+		if (!conn->connect(ec))
 		{
 			delete conn;
 			return nullptr;
@@ -398,9 +617,7 @@ namespace SAS {
 	{
 		SAS_LOG_NDC();
 		SAS_LOG_VAR(priv->logger, moduleName);
-		MQTTCaller caller(moduleName, priv->name);
-		if (!caller.init(priv->options, ec))
-			return false;
+		MQTTCaller caller(priv->dispatcher, moduleName, priv->name);
 		std::vector<std::string> in_args(1);
 		in_args[0] = moduleName;
 		std::string out_topic;
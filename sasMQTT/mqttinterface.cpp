@@ -18,6 +18,7 @@ along with sasMQTT.  If not, see <http://www.gnu.org/licenses/>
 #include "mqttinterface.h"
 #include <sasCore/logging.h>
 #include <sasCore/errorcollector.h>
+#include <sasCore/errorcodes.h>
 #include <sasJSON/jsonerrorcollector.h>
 #include <sasCore/module.h>
 #include <sasCore/application.h>
@@ -34,85 +35,329 @@ along with sasMQTT.  If not, see <http://www.gnu.org/licenses/>
 
 #include <list>
 #include <deque>
+#include <set>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
 
 namespace SAS {
 
+	struct MQTTRunnerOptions
+	{
+		size_t workers = 0;
+		size_t queueSize = 0;
+		std::chrono::milliseconds enqueueTimeout;
+		std::string sharedGroup;
+		size_t priorityWorkers = 0;
+		size_t priorityQueueSize = 0;
+		std::set<std::string> priority; // '<module>' or '<module>/<invoker>'
+		size_t dedupSize = 0;
+		std::chrono::milliseconds dedupTTL{0};
+
+		bool build(const std::string & path, ConfigReader * cr, ErrorCollector & ec)
+		{
+			long long tmp;
+			auto cores = std::thread::hardware_concurrency();
+			if (!cr->getNumberEntry(path + "/WORKERS", tmp, cores ? cores : 4, ec))
+				return false;
+			workers = tmp > 0 ? static_cast<size_t>(tmp) : 1;
+
+			if (!cr->getNumberEntry(path + "/QUEUE_SIZE", tmp, 1024, ec))
+				return false;
+			queueSize = tmp > 0 ? static_cast<size_t>(tmp) : 1;
+
+			if (!cr->getNumberEntry(path + "/ENQUEUE_TIMEOUT", tmp, 100, ec))
+				return false;
+			enqueueTimeout = std::chrono::milliseconds(tmp > 0 ? tmp : 0);
+
+			if (!cr->getStringEntry(path + "/SHARED_GROUP", sharedGroup, std::string(), ec))
+				return false;
+			if (sharedGroup.find_first_of("/+#") != std::string::npos)
+			{
+				ec.add(-1, "invalid value of 'SHARED_GROUP': '" + sharedGroup + "'");
+				return false;
+			}
+
+			if (!cr->getNumberEntry(path + "/PRIORITY_WORKERS", tmp, 1, ec))
+				return false;
+			priorityWorkers = tmp > 0 ? static_cast<size_t>(tmp) : 1;
+
+			if (!cr->getNumberEntry(path + "/PRIORITY_QUEUE_SIZE", tmp, 64, ec))
+				return false;
+			priorityQueueSize = tmp > 0 ? static_cast<size_t>(tmp) : 1;
+
+			std::vector<std::string> tmp_list;
+			if (!cr->getStringListEntry(path + "/PRIORITY", tmp_list, std::vector<std::string>(), ec))
+				return false;
+			priority.clear();
+			priority.insert(tmp_list.begin(), tmp_list.end());
+
+			if (!cr->getNumberEntry(path + "/DEDUP_TTL", tmp, 0, ec))
+				return false;
+			dedupTTL = std::chrono::milliseconds(tmp > 0 ? tmp : 0);
+
+			if (!cr->getNumberEntry(path + "/DEDUP_SIZE", tmp, 10000, ec))
+				return false;
+			dedupSize = tmp > 0 ? static_cast<size_t>(tmp) : 0;
+
+			return true;
+		}
+	};
+
+	// responses of the recently served requests, a request redelivered by the broker is answered from here instead of being executed again
+	class MQTTResponseCache
+	{
+	public:
+		struct Response
+		{
+			std::string topic;
+			std::vector<char> payload;
+			MQTTMessageProperties properties;
+		};
+
+		enum class Lookup
+		{
+			Miss, // the request is registered as in progress
+			InProgress,
+			Hit
+		};
+
+		void setLimits(size_t max_size, std::chrono::milliseconds ttl)
+		{
+			std::unique_lock<std::mutex> __locker(_mut);
+			_max_size = max_size;
+			_ttl = ttl;
+		}
+
+		bool enabled() const
+		{
+			return _max_size && _ttl.count() > 0;
+		}
+
+		Lookup begin(const std::string & key, Response & response)
+		{
+			std::unique_lock<std::mutex> __locker(_mut);
+			auto now = std::chrono::steady_clock::now();
+			expire(now);
+
+			auto it = _entries.find(key);
+			if (it == _entries.end())
+			{
+				_entries[key].time = now;
+				_order.push_back(std::make_pair(now, key));
+				++_misses;
+				return Lookup::Miss;
+			}
+			if (!it->second.done)
+			{
+				++_in_progress_hits;
+				return Lookup::InProgress;
+			}
+			++_hits;
+			response = it->second.response;
+			return Lookup::Hit;
+		}
+
+		void complete(const std::string & key, const Response & response)
+		{
+			std::unique_lock<std::mutex> __locker(_mut);
+			auto it = _entries.find(key);
+			if (it == _entries.end())
+				return;
+			it->second.done = true;
+			it->second.response = response;
+		}
+
+		// the request has failed without response, it can be executed again
+		void abort(const std::string & key)
+		{
+			std::unique_lock<std::mutex> __locker(_mut);
+			_entries.erase(key);
+		}
+
+		unsigned long long hits() const { return _hits; }
+		unsigned long long inProgressHits() const { return _in_progress_hits; }
+		unsigned long long misses() const { return _misses; }
+
+	private:
+		struct Entry
+		{
+			std::chrono::steady_clock::time_point time;
+			bool done = false;
+			Response response;
+		};
+
+		void expire(std::chrono::steady_clock::time_point now)
+		{
+			while (_order.size() && (_order.size() > _max_size || now - _order.front().first > _ttl))
+			{
+				auto it = _entries.find(_order.front().second);
+				if (it != _entries.end() && it->second.time == _order.front().first)
+					_entries.erase(it);
+				_order.pop_front();
+			}
+		}
+
+		std::mutex _mut;
+		size_t _max_size = 0;
+		std::chrono::milliseconds _ttl{0};
+		std::unordered_map<std::string, Entry> _entries;
+		std::deque<std::pair<std::chrono::steady_clock::time_point, std::string>> _order;
+
+		std::atomic<unsigned long long> _hits{0};
+		std::atomic<unsigned long long> _in_progress_hits{0};
+		std::atomic<unsigned long long> _misses{0};
+	};
+
 	class MQTTRunner : public MQTTAsync
 	{
 		Logging::LoggerPtr logger;
 		Application * app;
 		std::string name;
+		MQTTRunnerOptions options;
+		MQTTResponseCache responses;
 	public:
 		MQTTRunner(Application * app_, const std::string & name_) :
 			MQTTAsync(name_),
 			logger(Logging::getLogger("MQTTRunner." + name_)),
 			app(app_),
 			name(name_),
-			threadPool(app, logger)
+			workers(app, logger, &responses),
+			priority_workers(app, logger, &responses)
 		{ }
 
-         virtual ~MQTTRunner() override = default;
+		virtual ~MQTTRunner() override
+		{
+			priority_workers.stop();
+			workers.stop();
+		}
+
+		bool init(const MQTTConnectionOptions & conn_opts, const MQTTRunnerOptions & runner_opts, ErrorCollector & ec)
+		{
+			options = runner_opts;
+			responses.setLimits(options.dedupSize, options.dedupTTL);
+			return MQTTAsync::init(conn_opts, ec);
+		}
 
 	private:
 		struct RunnerTask
 		{
 			 MQTTAsync * mqtt;
-			 std::string topic;
-			 std::vector<char> payload;
-             int qos;
+			 MQTTMessagePtr message; // the received buffer is kept until the request is completed
 		};
 
-		class RunnerThread : public ThreadInPool<RunnerTask>
+		class RunnerPool : public WorkerPool<RunnerTask>
 		{
 			Application * _app;
 			Logging::LoggerPtr _logger;
+			MQTTResponseCache * _responses;
 		public:
-			 RunnerThread(Application * app, const Logging::LoggerPtr & logger) :
-                 ThreadInPool(app->threadPool()), _app(app), _logger(logger)
+			RunnerPool(Application * app, const Logging::LoggerPtr & logger, MQTTResponseCache * responses) :
+				WorkerPool(app->threadPool()), _app(app), _logger(logger), _responses(responses)
 			{ }
+
+			virtual ~RunnerPool() override
+			{
+				stop();
+			}
 		protected:
 			virtual bool complete(RunnerTask * task) override
 			{
 				SAS_LOG_NDC();
 				SAS_LOG_ASSERT(_logger, task, "the 'task' cannot be null");
 
+				// pooled tasks must not hold the received buffer
+				struct MessageReleaser
+				{
+					RunnerTask * task;
+					~MessageReleaser() { task->message.reset(); }
+				} releaser{ task };
+				const MQTTMessage & message = *task->message;
+
+				std::string dedup_key;
 				try
 				{
 					std::vector<char> output;
 
-					SAS_LOG_VAR(_logger, task->topic);
+					SAS_LOG_VAR(_logger, message.topic());
 
 					rapidjson::Document out_doc;
 					out_doc.Parse("{}");
 					JSONErrorCollector ec(out_doc.GetAllocator());
 
-					auto lst = str_split(task->topic, '/');
-					if (lst.size() < 3)
+					std::string module, func, msg_id;
+					std::vector<std::string> args;
+
+					// MQTT 5 request: '<module>/v5', the function and its arguments are user properties
+					bool v5 = message.properties().responseTopic.length() > 0;
+					if (v5)
 					{
-						auto err = ec.add(-1, "unknown topic: '" + task->topic + "'");
-						SAS_LOG_ERROR(_logger, err);
-						return false;
+						module = message.topic().substr(0, message.topic().find('/'));
+						for (auto & p : message.properties().userProperties)
+						{
+							if (p.first == "function")
+								func = p.second;
+							else if (p.first == "argument")
+								args.push_back(p.second);
+						}
 					}
+					else
+					{
+						auto lst = str_split(message.topic(), '/');
+						if (lst.size() < 3)
+						{
+							auto err = ec.add(-1, "unknown topic: '" + message.topic() + "'");
+							SAS_LOG_ERROR(_logger, err);
+							return false;
+						}
 
-					std::string module, func, msg_id;
+						size_t i(0);
+						for (auto & t : lst)
+						{
+							switch (i++)
+							{
+							case 0:
+								module = t;
+								break;
+							case 1:
+								func = t;
+								break;
+							case 2:
+								msg_id = t;
+								break;
+							default:
+								args.push_back(t);
+								break;
+							}
+						}
+					}
 
-					std::vector<std::string> args;
-					size_t i(0);
-					for (auto & t : lst)
+					// only QoS 1/2 messages can be redelivered, and only the unique message ids can be recognized
+					if (message.qos() > 0 && _responses->enabled())
 					{
-						switch (i++)
+						if (v5)
 						{
-						case 0:
-							module = t;
-							break;
-						case 1:
-							func = t;
-							break;
-						case 2:
-							msg_id = t;
-							break;
-						default:
-							args.push_back(t);
+							dedup_key = message.properties().responseTopic;
+							dedup_key.append(1, '\0').append(message.properties().correlationData.begin(), message.properties().correlationData.end());
+						}
+						else if (msg_id.find('@') != std::string::npos)
+							dedup_key = msg_id;
+					}
+					if (dedup_key.length())
+					{
+						MQTTResponseCache::Response cached;
+						switch (_responses->begin(dedup_key, cached))
+						{
+						case MQTTResponseCache::Lookup::Hit:
+							{
+								SAS_LOG_DEBUG(_logger, "redelivered request is answered from cache: '" + message.topic() + "'");
+								NullEC ec2;
+								return task->mqtt->send(cached.topic, cached.payload.data(), cached.payload.size(), SAS_MQTT__QOS, cached.properties, ec2);
+							}
+						case MQTTResponseCache::Lookup::InProgress:
+							SAS_LOG_DEBUG(_logger, "redelivered request is still in progress: '" + message.topic() + "'");
+							return true;
+						case MQTTResponseCache::Lookup::Miss:
 							break;
 						}
 					}
@@ -193,6 +438,13 @@ namespace SAS {
 							resp_res = "error";
 							outType = Out_Error;
 						}
+						else if (!_module->isReady())
+						{
+							auto err = ec.add(SAS_CORE__ERROR__MODULE__NOT_READY, "module '" + module + "' is not ready");
+							SAS_LOG_WARN(_logger, err);
+							resp_res = "error";
+							outType = Out_Error;
+						}
 						else
 						{
 							out_doc.AddMember("description", rapidjson::StringRef(_module->description().c_str()), out_doc.GetAllocator());
@@ -225,7 +477,7 @@ namespace SAS {
 									resp_res = "result";
 									outType = Out_JSon;
 
-									switch (session->invoke(args[1], task->payload, resp_payload, ec))
+									switch (session->invoke(args[1], message.payload(), message.payloadSize(), resp_payload, ec))
 									{
 									case Invoker::Status::FatalError:
 										resp_res = "fatal";
@@ -257,7 +509,7 @@ namespace SAS {
 					}
 					else
 					{
-						auto err = ec.add(-1, "unsupported topic: '" + task->topic + "'");
+						auto err = ec.add(-1, "unsupported topic: '" + message.topic() + "'");
 						SAS_LOG_ERROR(_logger, err);
 						outType = Out_Error;
 					}
@@ -275,58 +527,164 @@ namespace SAS {
 							rapidjson::StringBuffer sb;
 							rapidjson::Writer<rapidjson::StringBuffer> w(sb);
 							out_doc.Accept(w);
-							resp_payload.resize(sb.GetSize()+1);
-							memcpy(resp_payload.data(), sb.GetString(), sb.GetSize());
+							resp_payload.assign(sb.GetString(), sb.GetString() + sb.GetSize());
 						}
 						break;
 					}
 
-					std::string resp_topic;
-					resp_topic = "sas/response/" + msg_id + "/" + resp_res;
-					for (auto & a : resp_args)
-						resp_topic += "/" + a;
+					MQTTResponseCache::Response resp;
+					resp.payload.swap(resp_payload);
+
+					if (v5)
+					{
+						resp.topic = message.properties().responseTopic;
+						resp.properties.correlationData = message.properties().correlationData;
+						resp.properties.userProperties.reserve(resp_args.size() + 1);
+						resp.properties.userProperties.push_back(std::make_pair(std::string("result"), resp_res));
+						for (auto & a : resp_args)
+							resp.properties.userProperties.push_back(std::make_pair(std::string("argument"), a));
+					}
+					else
+					{
+						auto at = msg_id.find('@');
+						if (at == std::string::npos)
+							resp.topic = "sas/response/" + msg_id + "/" + resp_res;
+						else // '<seq>@<reply_key>': the caller has one subscription for all of its responses
+							resp.topic = "sas/response/" + msg_id.substr(at + 1) + "/" + msg_id.substr(0, at) + "/" + resp_res;
+						for (auto & a : resp_args)
+							resp.topic += "/" + a;
+					}
+
+					if (dedup_key.length())
+						_responses->complete(dedup_key, resp);
+
 					NullEC ec2;
-					resp_payload.push_back('\0');
-					return task->mqtt->send(resp_topic, resp_payload, SAS_MQTT__QOS, ec2);
+					return task->mqtt->send(resp.topic, resp.payload.data(), resp.payload.size(), SAS_MQTT__QOS, resp.properties, ec2);
 				}
 				catch(std::exception & e)
 				{
+					if (dedup_key.length())
+						_responses->abort(dedup_key);
 					SAS_LOG_ERROR(_logger, e.what());
 					return false;
 				}
 				catch(...)
 				{
+					if (dedup_key.length())
+						_responses->abort(dedup_key);
 					SAS_LOG_FATAL(_logger, "unknown exception");
 					return false;
 				}
 			}
+		} workers;
+
+		RunnerPool priority_workers;
+
+		struct Route
+		{
+			std::string module;
+			std::string func;
+			std::string invoker;
+			SessionID sid = 0; // 0 if the request has no session (yet)
 		};
 
-		class RunnerThreadPool : public AbstractThreadPool<RunnerThread>
+		static void route(const std::string & topic, const MQTTMessageProperties & properties, Route & r)
 		{
-			Application * _app;
-			Logging::LoggerPtr _logger;
-		public:
-			RunnerThreadPool(Application * app, const Logging::LoggerPtr & logger) :
-				 AbstractThreadPool(), _app(app), _logger(logger)
-			{ }
-		protected:
-			virtual std::shared_ptr<RunnerThread> newThread()
+			std::string sid;
+			if (properties.responseTopic.length())
 			{
-				return std::make_shared<RunnerThread>(_app, _logger);
+				r.module = topic.substr(0, topic.find('/'));
+				int arg = 0;
+				for (auto & p : properties.userProperties)
+				{
+					if (p.first == "function")
+						r.func = p.second;
+					else if (p.first == "argument")
+					{
+						if (arg == 0)
+							sid = p.second;
+						else if (arg == 1)
+							r.invoker = p.second;
+						++arg;
+					}
+				}
+			}
+			else
+			{
+				// '<module>/<func>/<msg_id>/<sid>/<invoker>[/...]'
+				size_t b = 0;
+				for (int level = 0; level < 5 && b <= topic.length(); ++level)
+				{
+					auto e = topic.find('/', b);
+					if (e == std::string::npos)
+						e = topic.length();
+					switch (level)
+					{
+					case 0:
+						r.module.assign(topic, b, e - b);
+						break;
+					case 1:
+						r.func.assign(topic, b, e - b);
+						break;
+					case 3:
+						sid.assign(topic, b, e - b);
+						break;
+					case 4:
+						r.invoker.assign(topic, b, e - b);
+						break;
+					}
+					b = e + 1;
+				}
 			}
-		} threadPool;
+
+			r.sid = 0;
+			for (auto c : sid)
+			{
+				if (c < '0' || c > '9')
+				{
+					r.sid = 0;
+					break;
+				}
+				r.sid = r.sid * 10 + (c - '0');
+			}
+		}
+
+		bool is_priority(const Route & r) const
+		{
+			// end_session stays on the lane of its session, so it is served after the invocations queued before it
+			if (r.func == "get_session" || r.func == "get_module_info")
+				return true;
+			if (!options.priority.size())
+				return false;
+			return options.priority.count(r.module) || options.priority.count(r.module + "/" + r.invoker);
+		}
 
 	protected:
-        virtual bool messageArrived(const std::string & topic, const std::vector<char> & payload, int qos) override
+		virtual bool messageArrived(const std::string & topic, const std::vector<char> & payload, int qos) override
+		{
+			return messageArrived(MQTTMessage::create(topic, payload, qos, MQTTMessageProperties()));
+		}
+
+		// the payload is not copied, the message is passed to the invoker as it is received from the MQTT client
+		virtual bool messageArrived(const MQTTMessagePtr & message) override
 		{
-			auto th = threadPool.get();
-			auto task = new RunnerTask;
+			auto & topic = message->topic();
+			Route r;
+			route(topic, message->properties(), r);
+			// requests of the same session are served by the same worker, so they do not wait for each other's session lock
+			// control messages and the configured modules/invokers have their own workers, they are not queued behind long invocations
+			auto & pool = is_priority(r) ? priority_workers : workers;
+			auto task = pool.acquire();
 			task->mqtt = this;
-			task->payload = payload;
-			task->topic = topic;
-            task->qos = qos;
-			th->add(task);
+			task->message = message;
+			if (!pool.post(task, static_cast<unsigned long long>(r.sid), options.enqueueTimeout))
+			{
+				// the message is kept and redelivered by the MQTT client, so its acknowledgement is delayed
+				task->message.reset();
+				pool.release(task);
+				SAS_LOG_WARN(logger, "request queue is full, message is not accepted: '" + topic + "'");
+				return false;
+			}
 			return true;
 		}
 	public:
@@ -336,13 +694,41 @@ namespace SAS {
 
 			auto mods = app->objectRegistry()->getObjects(SAS_OBJECT_TYPE__MODULE, ec);
 			std::vector<std::string> topics(mods.size());
+			// with a shared subscription the broker delivers every request to only one of the subscribed instances
+			std::string prefix = options.sharedGroup.length() ? "$share/" + options.sharedGroup + "/" : std::string();
 			for (int i(0), l(mods.size()); i < l; ++i)
-				topics[i] = mods[i]->name() + "/#";
+				topics[i] = prefix + mods[i]->name() + "/#";
+
+			if (!workers.start(options.workers, options.queueSize) ||
+				!priority_workers.start(options.priorityWorkers, options.priorityQueueSize))
+			{
+				workers.stop();
+				priority_workers.stop();
+				auto err = ec.add(-1, "could not start worker threads");
+				SAS_LOG_ERROR(logger, err);
+				return MQTTInterface::Status::CannotStart;
+			}
 
 			if(!subscribe(topics, SAS_MQTT__QOS, ec))
+			{
+				priority_workers.stop();
+				workers.stop();
 				return MQTTInterface::Status::CannotStart;
+			}
+
+			auto ret = MQTTAsync::run(ec);
 
-			return MQTTAsync::run(ec) ? MQTTInterface::Status::Ended : MQTTInterface::Status::Crashed;
+			NullEC nec;
+			unsubscribe(nec);
+			priority_workers.stop();
+			workers.stop();
+
+			if (responses.enabled())
+				SAS_LOG_INFO(logger, "redelivered requests answered from cache: " + std::to_string(responses.hits()) +
+					", dropped while in progress: " + std::to_string(responses.inProgressHits()) +
+					", cached requests: " + std::to_string(responses.misses()));
+
+			return ret ? MQTTInterface::Status::Ended : MQTTInterface::Status::Crashed;
 
 		}
 
@@ -410,7 +796,11 @@ namespace SAS {
 		if(!options.build(config_path, priv->app->configReader(), ec))
 			return false;
 
-		return priv->runner->init(options, ec);
+		MQTTRunnerOptions runner_options;
+		if (!runner_options.build(config_path, priv->app->configReader(), ec))
+			return false;
+
+		return priv->runner->init(options, runner_options, ec);
 	}
 
 	Logging::LoggerPtr MQTTInterface::logger() const
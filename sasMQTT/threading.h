@@ -14,120 +14,242 @@ GNU Lesser General Public License for more details.
 You should have received a copy of the GNU Lesser General Public License
 along with sasMQTT.  If not, see <http://www.gnu.org/licenses/>
 */
-
 #ifndef sasMQTT__threading_h
 #define sasMQTT__threading_h
 
 #include "include/sasMQTT/config.h"
 
-#include <sasCore/controlledthread.h>
+#include <sasCore/thread.h>
 
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
 #include <memory>
-#include <deque>
-#include <list>
+#include <vector>
 
 namespace SAS {
 
-	template <typename T_Task>
-	class TaskQueue
+	// bounded multi-producer/multi-consumer FIFO
+	template<typename T>
+	class BoundedQueue
 	{
 		std::mutex mut;
-		std::deque<T_Task * > data;
+		std::condition_variable not_empty;
+		std::condition_variable not_full;
+		std::vector<T> ring;
+		size_t head = 0;
+		size_t count = 0;
+		bool closed = false;
 	public:
-		void add(T_Task * run)
+		BoundedQueue(size_t capacity) : ring(capacity ? capacity : 1)
+		{ }
+
+		// waits for free space at most 'timeout', returns false if the queue is still full or it is closed
+		bool push(T item, std::chrono::milliseconds timeout)
 		{
 			std::unique_lock<std::mutex> __locker(mut);
 
-			data.push_back(run);
+			if (!not_full.wait_for(__locker, timeout, [this]() { return closed || count < ring.size(); }) || closed)
+				return false;
+			ring[(head + count++) % ring.size()] = std::move(item);
+			__locker.unlock();
+			not_empty.notify_one();
+			return true;
 		}
 
-		T_Task * take()
+		// blocks until an item is available, returns false if the queue is closed and drained
+		bool pop(T & item)
 		{
 			std::unique_lock<std::mutex> __locker(mut);
 
-			if (!data.size())
-				return nullptr;
-			auto d = data.front();
-			data.pop_front();
-			return d;
+			not_empty.wait(__locker, [this]() { return closed || count > 0; });
+			if (!count)
+				return false;
+			item = std::move(ring[head]);
+			head = (head + 1) % ring.size();
+			--count;
+			__locker.unlock();
+			not_full.notify_one();
+			return true;
+		}
+
+		void close()
+		{
+			std::unique_lock<std::mutex> __locker(mut);
+			closed = true;
+			__locker.unlock();
+			not_empty.notify_all();
+			not_full.notify_all();
 		}
+	};
+
 
-		std::list<T_Task *> takeAll()
+	// keeps released objects for reuse, so their buffers are not reallocated for every task
+	template<typename T>
+	class ObjectPool
+	{
+		std::mutex mut;
+		std::vector<std::unique_ptr<T>> free_objects;
+	public:
+		T * acquire()
 		{
 			std::unique_lock<std::mutex> __locker(mut);
 
-			std::list<T_Task *> tmp;
-			std::copy(data.begin(), data.end(), tmp.begin());
-			data.clear();
-			return tmp;
+			if (!free_objects.size())
+				return new T;
+			auto obj = free_objects.back().release();
+			free_objects.pop_back();
+			return obj;
+		}
+
+		void release(T * obj)
+		{
+			std::unique_lock<std::mutex> __locker(mut);
+			free_objects.emplace_back(obj);
 		}
 	};
 
 
-	template<typename T_task>
-	class ThreadInPool : public ControlledThread
+	// fixed number of worker threads, each of them is fed by its own bounded queue (lane) of pooled tasks
+	// tasks posted with the same non-zero key are completed by the same worker in order
+	// derived classes have to call stop() in their destructor
+	template<typename T_Task>
+	class WorkerPool
 	{
+		SAS_COPY_PROTECTOR(WorkerPool)
+
+		typedef BoundedQueue<T_Task*> Lane;
+
+		class Worker : public Thread
+		{
+			WorkerPool * _pool;
+			Lane * _lane;
+		public:
+			Worker(ThreadPool * thread_pool, WorkerPool * pool, Lane * lane) : Thread(thread_pool), _pool(pool), _lane(lane)
+			{ }
+		protected:
+			virtual void execute() final
+			{
+				T_Task * task;
+				while (_lane->pop(task))
+				{
+					_pool->complete(task);
+					_pool->_tasks.release(task);
+				}
+			}
+
+			// the last virtual call of the thread, but the runner still accesses the worker after it until th_mutex is released (see stop())
+			virtual void ended() final
+			{
+				std::unique_lock<std::mutex> __locker(_pool->_mut);
+				if (!--_pool->_running)
+					_pool->_stopped.notify_all();
+			}
+		};
+
+		ThreadPool * _thread_pool;
+		std::vector<std::unique_ptr<Lane>> _lanes;
+		ObjectPool<T_Task> _tasks;
+		std::vector<std::unique_ptr<Worker>> _workers;
+		std::atomic<size_t> _next_lane;
+
+		std::mutex _mut;
+		std::condition_variable _stopped;
+		size_t _running = 0;
 	public:
-        ThreadInPool(ThreadPool * pool) : ControlledThread(pool)
+		WorkerPool(ThreadPool * thread_pool) : _thread_pool(thread_pool), _next_lane(0)
 		{ }
 
-		virtual ~ThreadInPool() { }
-
-		void add(T_task * task)
+		virtual ~WorkerPool()
 		{
-			_tasks.add(task);
-			resume();
+			stop();
 		}
 
-	protected:
-		virtual void execute() final
+		// 'queue_size' is shared by the lanes
+		bool start(size_t workers, size_t queue_size)
 		{
-			while(enterContolledSection())
+			if (_workers.size())
+				return true;
+
+			if (!workers)
+				workers = 1;
+			std::vector<std::unique_ptr<Lane>> lanes(workers);
+			for (auto & lane : lanes)
+				lane.reset(new Lane((queue_size + workers - 1) / workers));
+			_lanes.swap(lanes);
+
+			for (size_t i = 0; i < workers; ++i)
 			{
-				auto task = _tasks.take();
-				if(!task)
+				std::unique_ptr<Worker> worker(new Worker(_thread_pool, this, _lanes[i].get()));
+				{
+					std::unique_lock<std::mutex> __locker(_mut);
+					++_running;
+				}
+				if (!worker->start())
 				{
-					suspend();
-					continue;
+					std::unique_lock<std::mutex> __locker(_mut);
+					--_running;
+					__locker.unlock();
+					stop();
+					return false;
 				}
-				complete(task);
-				delete task;
+				_workers.push_back(std::move(worker));
 			}
+			return true;
 		}
 
-		virtual bool complete(T_task * task) = 0;
+		// the queued tasks are completed before the workers exit, later posts are refused
+		void stop()
+		{
+			for (auto & lane : _lanes)
+				lane->close();
 
-	private:
-		TaskQueue<T_task> _tasks;
-	};
+			std::unique_lock<std::mutex> __locker(_mut);
+			_stopped.wait(__locker, [this]() { return !_running; });
+			__locker.unlock();
 
+			// the workers can be destroyed only when their runners have returned
+			for (auto & worker : _workers)
+				while (!worker->wait(std::chrono::milliseconds(100)))
+					;
+			_workers.clear();
+		}
 
-	template<typename T_Thread>
-	class AbstractThreadPool
-	{
-		std::mutex mut;
-		std::list<std::shared_ptr<T_Thread>> threads;
-	public:
-		virtual ~AbstractThreadPool() { }
+		T_Task * acquire()
+		{
+			return _tasks.acquire();
+		}
 
-		std::shared_ptr<T_Thread> get()
+		void release(T_Task * task)
 		{
-			std::unique_lock<std::mutex> __locker(mut);
+			_tasks.release(task);
+		}
+
+		// key 0: any lane, the first one with free space is chosen
+		// returns false if the queue is full for 'timeout' or the pool is stopped, then the task still belongs to the caller
+		bool post(T_Task * task, unsigned long long key, std::chrono::milliseconds timeout)
+		{
+			auto count = _lanes.size();
+			if (!count)
+				return false;
 
-			for (auto & th : threads)
+			if (key)
 			{
-				if (th->reserveSuspended())
-					return th;
+				// spread the keys (e.g. time based session ids) evenly
+				key *= 0x9E3779B97F4A7C15ull;
+				return _lanes[static_cast<size_t>(key >> 32) % count]->push(task, timeout);
 			}
-			std::shared_ptr<T_Thread> th;
-			threads.push_back(th = newThread());
-			th->start();
-			//th->suspend();
-			return th;
+
+			auto first = _next_lane++ % count;
+			for (size_t i = 0; i < count; ++i)
+				if (_lanes[(first + i) % count]->push(task, std::chrono::milliseconds(0)))
+					return true;
+			return _lanes[first]->push(task, timeout);
 		}
+
 	protected:
-		virtual std::shared_ptr<T_Thread> newThread() = 0;
+		virtual bool complete(T_Task * task) = 0;
 	};
 
 }
@@ -0,0 +1,137 @@
+#include "cache_test.h"
+
+#include <cppunit/config/SourcePrefix.h>
+
+#include <invokercache.h>
+
+#include <thread>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Cache_Test);
+
+using namespace SAS;
+
+namespace {
+
+    std::vector<char> toVector(const std::string & str)
+    {
+        return std::vector<char>(str.begin(), str.end());
+    }
+
+    std::chrono::steady_clock::time_point later()
+    {
+        return std::chrono::steady_clock::now() + std::chrono::hours(1);
+    }
+
+}
+
+void Cache_Test::setUp()
+{
+}
+
+void Cache_Test::tearDown()
+{
+}
+
+void Cache_Test::hit_and_miss()
+{
+    InvokerCache cache(4, 1024 * 1024, std::chrono::hours(1));
+    std::vector<char> output;
+    CPPUNIT_ASSERT(!cache.get(toVector("input"), output));
+
+    cache.put(toVector("input"), toVector("output"));
+    CPPUNIT_ASSERT(cache.get(toVector("input"), output));
+    CPPUNIT_ASSERT(output == toVector("output"));
+    CPPUNIT_ASSERT(!cache.get(toVector("other input"), output));
+
+    cache.put(toVector("input"), toVector("new output"));
+    CPPUNIT_ASSERT(cache.get(toVector("input"), output));
+    CPPUNIT_ASSERT(output == toVector("new output"));
+}
+
+void Cache_Test::lru_eviction()
+{
+    auto a = toVector("a"), b = toVector("b"), c = toVector("c"), value = toVector(std::string(100, 'v'));
+
+    size_t entry_size = 0;
+    {
+        CacheShard probe;
+        probe.setMaxSize(1024 * 1024);
+        probe.put(hashInput(a), a, value, later());
+        unsigned long long hits(0), misses(0), evictions(0);
+        probe.stats(hits, misses, evictions, entry_size);
+    }
+
+    CacheShard shard;
+    shard.setMaxSize(entry_size * 2 + entry_size / 2);
+    shard.put(hashInput(a), a, value, later());
+    shard.put(hashInput(b), b, value, later());
+
+    std::vector<char> output;
+    CPPUNIT_ASSERT(shard.get(hashInput(a), a, output));
+    shard.put(hashInput(c), c, value, later());
+
+    // 'b' is the least recently used one
+    CPPUNIT_ASSERT(shard.get(hashInput(a), a, output));
+    CPPUNIT_ASSERT(!shard.get(hashInput(b), b, output));
+    CPPUNIT_ASSERT(shard.get(hashInput(c), c, output));
+
+    unsigned long long hits(0), misses(0), evictions(0);
+    size_t size(0);
+    shard.stats(hits, misses, evictions, size);
+    CPPUNIT_ASSERT(hits == 3);
+    CPPUNIT_ASSERT(misses == 1);
+    CPPUNIT_ASSERT(evictions == 1);
+    CPPUNIT_ASSERT(size <= entry_size * 2 + entry_size / 2);
+}
+
+void Cache_Test::ttl_expiry()
+{
+    InvokerCache cache(1, 1024 * 1024, std::chrono::milliseconds(50));
+    std::vector<char> output;
+    cache.put(toVector("input"), toVector("output"));
+    CPPUNIT_ASSERT(cache.get(toVector("input"), output));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CPPUNIT_ASSERT(!cache.get(toVector("input"), output));
+
+    CacheShard shard;
+    shard.setMaxSize(1024 * 1024);
+    shard.put(1, toVector("input"), toVector("output"), std::chrono::steady_clock::now());
+    CPPUNIT_ASSERT(!shard.get(1, toVector("input"), output));
+}
+
+void Cache_Test::hash_collision()
+{
+    CacheShard shard;
+    shard.setMaxSize(1024 * 1024);
+    shard.put(42, toVector("input 1"), toVector("output 1"), later());
+
+    std::vector<char> output;
+    CPPUNIT_ASSERT(!shard.get(42, toVector("input 2"), output));
+    CPPUNIT_ASSERT(shard.get(42, toVector("input 1"), output));
+    CPPUNIT_ASSERT(output == toVector("output 1"));
+}
+
+void Cache_Test::oversized_entry()
+{
+    CacheShard shard;
+    shard.setMaxSize(100);
+    shard.put(1, toVector("input"), toVector(std::string(200, 'v')), later());
+
+    std::vector<char> output;
+    CPPUNIT_ASSERT(!shard.get(1, toVector("input"), output));
+}
+
+void Cache_Test::shard_count()
+{
+    CPPUNIT_ASSERT(InvokerCache(16, 16 * 1024 * 1024, std::chrono::hours(1)).shardCount() == 16);
+    CPPUNIT_ASSERT(InvokerCache(16, 4 * InvokerCache::min_shard_size, std::chrono::hours(1)).shardCount() == 4);
+    CPPUNIT_ASSERT(InvokerCache(0, 16 * 1024 * 1024, std::chrono::hours(1)).shardCount() == 1);
+
+    // a small cache has one shard instead of ones without capacity
+    InvokerCache cache(16, 1000, std::chrono::hours(1));
+    CPPUNIT_ASSERT(cache.shardCount() == 1);
+    std::vector<char> output;
+    cache.put(toVector("input"), toVector("output"));
+    CPPUNIT_ASSERT(cache.get(toVector("input"), output));
+}
@@ -0,0 +1,31 @@
+#ifndef __cache_test_h__
+#define __cache_test_h__
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class Cache_Test : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(Cache_Test);
+    CPPUNIT_TEST(hit_and_miss);
+    CPPUNIT_TEST(lru_eviction);
+    CPPUNIT_TEST(ttl_expiry);
+    CPPUNIT_TEST(hash_collision);
+    CPPUNIT_TEST(oversized_entry);
+    CPPUNIT_TEST(shard_count);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+	virtual void setUp() override;
+
+	virtual void tearDown() override;
+
+protected:
+    void hit_and_miss();
+    void lru_eviction();
+    void ttl_expiry();
+    void hash_collision();
+    void oversized_entry();
+    void shard_count();
+};
+
+#endif //__cache_test_h__
@@ -0,0 +1,196 @@
+
+#include "loopback_test.h"
+
+#include <cppunit/config/SourcePrefix.h>
+
+#include <sasCore/application.h>
+#include <sasCore/configreader.h>
+#include <sasCore/errorcollector.h>
+#include <sasCore/errorcodes.h>
+#include <sasCore/module.h>
+#include <sasCore/session.h>
+
+#include <loopbackconnector.h>
+
+#include <atomic>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Loopback_Test);
+
+namespace {
+
+    std::atomic<int> alive_sessions(0);
+
+    class EchoInvoker : public SAS::Invoker
+    {
+    public:
+        virtual Status invoke(const std::vector<char> & input, std::vector<char> & output, SAS::ErrorCollector &) override
+        {
+            output = input;
+            return Status::OK;
+        }
+    };
+
+    class EchoSession : public SAS::Session
+    {
+    public:
+        EchoSession(SAS::SessionID id) : SAS::Session(id)
+        {
+            ++alive_sessions;
+        }
+
+        virtual ~EchoSession() override
+        {
+            --alive_sessions;
+        }
+
+    protected:
+        virtual SAS::Invoker * getInvoker(const std::string & name, SAS::ErrorCollector & ec) override
+        {
+            if (name != "echo")
+            {
+                ec.add(-1, "invoker is not found: '" + name + "'");
+                return nullptr;
+            }
+            return &invoker;
+        }
+
+    private:
+        EchoInvoker invoker;
+    };
+
+    class EchoModule : public SAS::Module
+    {
+    public:
+        EchoModule(SAS::Application * app) : SAS::Module(app)
+        { }
+
+        virtual std::string name() const override
+        {
+            return "echo";
+        }
+
+    protected:
+        virtual SAS::Session * createSession(SAS::SessionID id, SAS::ErrorCollector &) override
+        {
+            return new EchoSession(id);
+        }
+    };
+
+    class EmptyConfigReader : public SAS::ConfigReader
+    {
+    public:
+        virtual bool getEntryAsStringList(const std::string & path, std::vector<std::string> &, SAS::ErrorCollector & ec) override
+        {
+            ec.add(SAS_CORE__ERROR__CONFIG_READER__ENTRY_NOT_FOUND, "entry is not found: '" + path + "'");
+            return false;
+        }
+
+        virtual bool getEntryAsStringList(const std::string &, std::vector<std::string> & ret, const std::vector<std::string> & defaultValue, SAS::ErrorCollector &) override
+        {
+            ret = defaultValue;
+            return true;
+        }
+    };
+
+    class TestApplication : public SAS::Application
+    {
+    public:
+        virtual SAS::ConfigReader * configReader() override
+        {
+            return &config_reader;
+        }
+
+    private:
+        EmptyConfigReader config_reader;
+    };
+
+    std::vector<char> toVector(const std::string & str)
+    {
+        return std::vector<char>(str.begin(), str.end());
+    }
+}
+
+void Loopback_Test::setUp()
+{
+}
+
+void Loopback_Test::tearDown()
+{
+}
+
+void Loopback_Test::invoke()
+{
+    SAS::NullEC ec;
+    TestApplication app;
+    CPPUNIT_ASSERT(app.init(ec));
+    {
+        EchoModule module(&app);
+        SAS::LoopbackConnection conn(&app, &module, "echo");
+
+        std::vector<char> output;
+        CPPUNIT_ASSERT(conn.invoke(toVector("first"), output, ec) == SAS::Invoker::Status::OK);
+        CPPUNIT_ASSERT(output == toVector("first"));
+        auto sid = conn.sessionId();
+        CPPUNIT_ASSERT(sid != 0);
+
+        CPPUNIT_ASSERT(conn.invoke(toVector("second"), output, ec) == SAS::Invoker::Status::OK);
+        CPPUNIT_ASSERT(output == toVector("second"));
+        CPPUNIT_ASSERT_EQUAL(sid, conn.sessionId());
+        CPPUNIT_ASSERT_EQUAL(1, alive_sessions.load());
+
+        SAS::LoopbackConnection missing(&app, &module, "missing");
+        CPPUNIT_ASSERT(missing.invoke(toVector("x"), output, ec) == SAS::Invoker::Status::FatalError);
+    }
+    CPPUNIT_ASSERT_EQUAL(0, alive_sessions.load());
+}
+
+// the session is ended by another client while the connection still holds it
+void Loopback_Test::end_pinned_session()
+{
+    SAS::NullEC ec;
+    TestApplication app;
+    CPPUNIT_ASSERT(app.init(ec));
+    {
+        EchoModule module(&app);
+        SAS::LoopbackConnection conn(&app, &module, "echo");
+
+        std::vector<char> output;
+        CPPUNIT_ASSERT(conn.invoke(toVector("first"), output, ec) == SAS::Invoker::Status::OK);
+        auto sid = conn.sessionId();
+
+        module.endSession(sid);
+        // still pinned by the connection
+        CPPUNIT_ASSERT_EQUAL(1, alive_sessions.load());
+
+        // the ended session is released and a new one is created for the same ID
+        CPPUNIT_ASSERT(conn.invoke(toVector("second"), output, ec) == SAS::Invoker::Status::OK);
+        CPPUNIT_ASSERT(output == toVector("second"));
+        CPPUNIT_ASSERT_EQUAL(sid, conn.sessionId());
+        CPPUNIT_ASSERT_EQUAL(1, alive_sessions.load());
+
+        CPPUNIT_ASSERT(conn.endSession(ec));
+        CPPUNIT_ASSERT_EQUAL(0, alive_sessions.load());
+    }
+    CPPUNIT_ASSERT_EQUAL(0, alive_sessions.load());
+}
+
+void Loopback_Test::unpin_ended_session()
+{
+    SAS::NullEC ec;
+    TestApplication app;
+    CPPUNIT_ASSERT(app.init(ec));
+
+    EchoModule module(&app);
+    auto first = module.pinSession(0, ec);
+    CPPUNIT_ASSERT(first);
+    auto second = module.pinSession(first->id(), ec);
+    CPPUNIT_ASSERT(first == second);
+
+    module.endSession(first->id());
+    CPPUNIT_ASSERT(first->isEnded());
+
+    module.unpinSession(first);
+    CPPUNIT_ASSERT_EQUAL(1, alive_sessions.load());
+    module.unpinSession(second);
+    CPPUNIT_ASSERT_EQUAL(0, alive_sessions.load());
+}
@@ -0,0 +1,26 @@
+
+#ifndef __loopback_test_h__
+#define __loopback_test_h__
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class Loopback_Test : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(Loopback_Test);
+    CPPUNIT_TEST(invoke);
+    CPPUNIT_TEST(end_pinned_session);
+    CPPUNIT_TEST(unpin_ended_session);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+	virtual void setUp() override;
+
+	virtual void tearDown() override;
+
+protected:
+    void invoke();
+    void end_pinned_session();
+    void unpin_ended_session();
+};
+
+#endif //__loopback_test_h__
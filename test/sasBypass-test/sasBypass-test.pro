@@ -0,0 +1,34 @@
+
+include("../../global.pri")
+
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+CONFIG -= qt
+#TARGET =
+
+#QMAKE_CXXFLAGS += -std=c++17
+
+SOURCES += main.cpp \
+           cache_test.cpp \
+           loopback_test.cpp \
+           singleflight_test.cpp \
+           ../../sasBypass/loopbackconnector.cpp
+
+HEADERS += \
+           cache_test.h \
+           loopback_test.h \
+           singleflight_test.h
+
+LIBS += -L../../sasCore -lsasCore
+LIBS += -L../../sasBasics -lsasBasics
+INCLUDEPATH += ../../sasCore/include
+INCLUDEPATH += ../../sasBasics/include
+INCLUDEPATH += ../../sasBypass
+
+CONFIG(SAS_LOG4CXX_ENABLED) {
+    LIBS += -llog4cxx
+    DEFINES += SAS_LOG4CXX_ENABLED
+}
+
+LIBS += -lcppunit -lcrypto -lpthread
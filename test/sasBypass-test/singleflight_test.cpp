@@ -0,0 +1,194 @@
+#include "singleflight_test.h"
+
+#include <cppunit/config/SourcePrefix.h>
+
+#include <singleflight.h>
+
+#include <thread>
+#include <list>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(SingleFlight_Test);
+
+using namespace SAS;
+
+namespace {
+
+    std::vector<char> toVector(const std::string & str)
+    {
+        return std::vector<char>(str.begin(), str.end());
+    }
+
+    // the leader waits until the followers have joined
+    struct Gate
+    {
+        std::mutex mut;
+        std::condition_variable cv;
+        bool open = false;
+
+        void wait()
+        {
+            std::unique_lock<std::mutex> __locker(mut);
+            cv.wait(__locker, [&]() { return open; });
+        }
+
+        void release()
+        {
+            {
+                std::unique_lock<std::mutex> __locker(mut);
+                open = true;
+            }
+            cv.notify_all();
+        }
+    };
+
+}
+
+void SingleFlight_Test::setUp()
+{
+}
+
+void SingleFlight_Test::tearDown()
+{
+}
+
+void SingleFlight_Test::enabled()
+{
+    SingleFlight sf;
+    CPPUNIT_ASSERT(!sf.enabled("inv"));
+    sf.setInvokers({ "inv", "other" });
+    CPPUNIT_ASSERT(sf.enabled("inv"));
+    CPPUNIT_ASSERT(sf.enabled("other"));
+    CPPUNIT_ASSERT(!sf.enabled("third"));
+}
+
+void SingleFlight_Test::single_call()
+{
+    SingleFlight sf;
+    NullEC ec;
+    std::vector<char> output;
+    int calls = 0;
+    auto status = sf.invoke("inv", toVector("input"), output, ec, [&](std::vector<char> & output_, ErrorCollector &)
+    {
+        ++calls;
+        output_ = toVector("output");
+        return Invoker::Status::OK;
+    });
+    CPPUNIT_ASSERT(status == Invoker::Status::OK);
+    CPPUNIT_ASSERT(output == toVector("output"));
+    CPPUNIT_ASSERT(calls == 1);
+    CPPUNIT_ASSERT(sf.coalesced() == 0);
+}
+
+void SingleFlight_Test::coalesced_calls()
+{
+    const int followers = 8;
+    SingleFlight sf;
+    Gate gate;
+    std::atomic<int> calls(0);
+
+    auto func = [&](std::vector<char> & output_, ErrorCollector &)
+    {
+        ++calls;
+        gate.wait();
+        output_ = toVector("output");
+        return Invoker::Status::OK;
+    };
+
+    std::vector<std::vector<char>> outputs(followers + 1);
+    std::vector<Invoker::Status> statuses(followers + 1, Invoker::Status::Error);
+    std::list<std::thread> threads;
+    for (int i = 0; i <= followers; ++i)
+        threads.emplace_back([&, i]()
+        {
+            NullEC ec;
+            statuses[i] = sf.invoke("inv", toVector("input"), outputs[i], ec, func);
+        });
+
+    for (int i = 0; i < 1000 && sf.coalesced() < static_cast<unsigned long long>(followers); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    gate.release();
+    for (auto & th : threads)
+        th.join();
+
+    CPPUNIT_ASSERT(calls == 1);
+    CPPUNIT_ASSERT(sf.coalesced() == static_cast<unsigned long long>(followers));
+    for (int i = 0; i <= followers; ++i)
+    {
+        CPPUNIT_ASSERT(statuses[i] == Invoker::Status::OK);
+        CPPUNIT_ASSERT(outputs[i] == toVector("output"));
+    }
+
+    // the finished call is not shared anymore
+    NullEC ec;
+    std::vector<char> output;
+    sf.invoke("inv", toVector("input"), output, ec, func);
+    CPPUNIT_ASSERT(calls == 2);
+}
+
+void SingleFlight_Test::different_inputs()
+{
+    SingleFlight sf;
+    Gate gate;
+    std::atomic<int> calls(0);
+
+    auto func = [&](std::vector<char> & output_, ErrorCollector &)
+    {
+        if (++calls == 2)
+            gate.release();
+        gate.wait();
+        output_ = toVector("output");
+        return Invoker::Status::OK;
+    };
+
+    // the same input of different invokers and different inputs of the same invoker are separate calls
+    std::vector<char> output1, output2;
+    std::thread th([&]()
+    {
+        NullEC ec;
+        sf.invoke("inv1", toVector("input"), output1, ec, func);
+    });
+    NullEC ec;
+    sf.invoke("inv2", toVector("input"), output2, ec, func);
+    th.join();
+    CPPUNIT_ASSERT(calls == 2);
+    CPPUNIT_ASSERT(sf.coalesced() == 0);
+}
+
+void SingleFlight_Test::errors()
+{
+    SingleFlight sf;
+    Gate gate;
+
+    auto func = [&](std::vector<char> &, ErrorCollector & ec_)
+    {
+        gate.wait();
+        ec_.add(-7, "backend error");
+        return Invoker::Status::Error;
+    };
+
+    std::vector<std::pair<long, std::string>> leader_errors, follower_errors;
+    Invoker::Status leader_status = Invoker::Status::OK, follower_status = Invoker::Status::OK;
+    std::thread leader([&]()
+    {
+        SimpleErrorCollector ec([&](long code, const std::string & text) { leader_errors.push_back(std::make_pair(code, text)); });
+        std::vector<char> output;
+        leader_status = sf.invoke("inv", toVector("input"), output, ec, func);
+    });
+    std::thread follower([&]()
+    {
+        SimpleErrorCollector ec([&](long code, const std::string & text) { follower_errors.push_back(std::make_pair(code, text)); });
+        std::vector<char> output;
+        follower_status = sf.invoke("inv", toVector("input"), output, ec, func);
+    });
+
+    while (!sf.coalesced())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    gate.release();
+    leader.join();
+    follower.join();
+
+    CPPUNIT_ASSERT(leader_status == Invoker::Status::Error);
+    CPPUNIT_ASSERT(follower_status == Invoker::Status::Error);
+    CPPUNIT_ASSERT(leader_errors.size() == 1 && leader_errors.front().first == -7);
+    CPPUNIT_ASSERT(follower_errors == leader_errors);
+}
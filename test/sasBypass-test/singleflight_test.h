@@ -0,0 +1,29 @@
+#ifndef __singleflight_test_h__
+#define __singleflight_test_h__
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class SingleFlight_Test : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(SingleFlight_Test);
+    CPPUNIT_TEST(enabled);
+    CPPUNIT_TEST(single_call);
+    CPPUNIT_TEST(coalesced_calls);
+    CPPUNIT_TEST(different_inputs);
+    CPPUNIT_TEST(errors);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+	virtual void setUp() override;
+
+	virtual void tearDown() override;
+
+protected:
+    void enabled();
+    void single_call();
+    void coalesced_calls();
+    void different_inputs();
+    void errors();
+};
+
+#endif //__singleflight_test_h__
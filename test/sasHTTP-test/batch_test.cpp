@@ -0,0 +1,213 @@
+#include "batch_test.h"
+
+#include <cppunit/config/SourcePrefix.h>
+
+#include <httpbatch.h>
+#include <sasCore/coalescer.h>
+
+#include <atomic>
+#include <thread>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Batch_Test);
+
+using namespace SAS;
+
+namespace {
+
+    HTTPBatchRequest makeRequest(const std::string & module, SessionID sid, const std::string & invoker, const std::string & input)
+    {
+        HTTPBatchRequest ret;
+        ret.module = module;
+        ret.sid = sid;
+        ret.invoker = invoker;
+        ret.input.assign(input.begin(), input.end());
+        return ret;
+    }
+
+}
+
+void Batch_Test::setUp()
+{
+}
+
+void Batch_Test::tearDown()
+{
+}
+
+void Batch_Test::request_round_trip()
+{
+    std::vector<HTTPBatchRequest> requests;
+    requests.push_back(makeRequest("module1", 0, "invoker1", "input1"));
+    requests.push_back(makeRequest("module2", 0xfedcba9876543210ULL, "invoker2", std::string("\0\xff binary", 9)));
+    requests.push_back(makeRequest("", 1, "", ""));
+    requests.push_back(makeRequest(std::string(65535, 'm'), 2, "invoker", std::string(100000, 'x')));
+
+    NullEC ec;
+    std::vector<char> data;
+    CPPUNIT_ASSERT(HTTPBatch::encode(requests, data, ec));
+
+    std::vector<HTTPBatchRequest> decoded;
+    CPPUNIT_ASSERT(HTTPBatch::decode(data, decoded, ec));
+    CPPUNIT_ASSERT(decoded.size() == requests.size());
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        CPPUNIT_ASSERT(decoded[i].module == requests[i].module);
+        CPPUNIT_ASSERT(decoded[i].sid == requests[i].sid);
+        CPPUNIT_ASSERT(decoded[i].invoker == requests[i].invoker);
+        CPPUNIT_ASSERT(decoded[i].input == requests[i].input);
+    }
+}
+
+void Batch_Test::response_round_trip()
+{
+    std::vector<HTTPBatchResponse> responses(3);
+    responses[0].sid = 12;
+    responses[0].status = Invoker::Status::OK;
+    responses[0].output = { 'o', 'k' };
+    responses[1].sid = 13;
+    responses[1].status = Invoker::Status::Error;
+    {
+        HTTPBatch::EntryErrorCollector ec(responses[1]);
+        ec.add(-5, "first error");
+        ec.add(42, "second error");
+    }
+    responses[2].status = Invoker::Status::NotImplemented;
+
+    std::vector<char> data;
+    HTTPBatch::encode(responses, data);
+
+    NullEC ec;
+    std::vector<HTTPBatchResponse> decoded;
+    CPPUNIT_ASSERT(HTTPBatch::decode(data, decoded, ec));
+    CPPUNIT_ASSERT(decoded.size() == responses.size());
+    for (size_t i = 0; i < responses.size(); ++i)
+    {
+        CPPUNIT_ASSERT(decoded[i].sid == responses[i].sid);
+        CPPUNIT_ASSERT(decoded[i].status == responses[i].status);
+        CPPUNIT_ASSERT(decoded[i].output == responses[i].output);
+        CPPUNIT_ASSERT(decoded[i].errors == responses[i].errors);
+    }
+    CPPUNIT_ASSERT(decoded[1].errors.size() == 2);
+    CPPUNIT_ASSERT(decoded[1].errors[0].first == -5);
+}
+
+void Batch_Test::empty_batch()
+{
+    NullEC ec;
+    std::vector<char> data;
+    CPPUNIT_ASSERT(HTTPBatch::encode(std::vector<HTTPBatchRequest>(), data, ec));
+    CPPUNIT_ASSERT(data.size() == 4);
+
+    std::vector<HTTPBatchRequest> decoded(1);
+    CPPUNIT_ASSERT(HTTPBatch::decode(data, decoded, ec));
+    CPPUNIT_ASSERT(decoded.empty());
+}
+
+void Batch_Test::long_name()
+{
+    NullEC ec;
+    std::vector<char> data;
+
+    std::vector<HTTPBatchRequest> requests;
+    requests.push_back(makeRequest(std::string(65536, 'm'), 0, "invoker", "input"));
+    CPPUNIT_ASSERT(!HTTPBatch::check(requests[0], ec));
+    CPPUNIT_ASSERT(!HTTPBatch::encode(requests, data, ec));
+
+    requests[0] = makeRequest("module", 0, std::string(70000, 'i'), "input");
+    CPPUNIT_ASSERT(!HTTPBatch::check(requests[0], ec));
+    CPPUNIT_ASSERT(!HTTPBatch::encode(requests, data, ec));
+}
+
+void Batch_Test::truncated()
+{
+    std::vector<HTTPBatchRequest> requests;
+    requests.push_back(makeRequest("module", 3, "invoker", "input"));
+    requests.push_back(makeRequest("module", 4, "invoker", "input"));
+
+    NullEC ec;
+    std::vector<char> data;
+    CPPUNIT_ASSERT(HTTPBatch::encode(requests, data, ec));
+
+    std::vector<HTTPBatchRequest> decoded;
+    for (size_t size = 0; size < data.size(); ++size)
+    {
+        std::vector<char> part(data.begin(), data.begin() + size);
+        CPPUNIT_ASSERT(!HTTPBatch::decode(part, decoded, ec));
+    }
+
+    data.push_back(0);
+    CPPUNIT_ASSERT(!HTTPBatch::decode(data, decoded, ec));
+
+    std::vector<char> huge_count = { '\x7f', '\xff', '\xff', '\xff' };
+    CPPUNIT_ASSERT(!HTTPBatch::decode(huge_count, decoded, ec));
+}
+
+void Batch_Test::coalesce()
+{
+    std::atomic<int> sends(0);
+    Coalescer<HTTPBatchRequest, HTTPBatchResponse> coalescer(Logging::getLogger("SAS.Batch_Test"),
+        [&sends](const std::vector<const HTTPBatchRequest *> & requests, std::vector<HTTPBatchResponse> & responses, ErrorCollector &)
+        {
+            ++sends;
+            for (auto r : requests)
+            {
+                HTTPBatchResponse resp;
+                resp.sid = r->sid;
+                resp.status = Invoker::Status::OK;
+                resp.output = r->input;
+                responses.push_back(resp);
+            }
+            return true;
+        }, std::chrono::microseconds(10000), 3);
+
+    const size_t count = 8;
+    std::vector<HTTPBatchRequest> requests(count);
+    std::vector<HTTPBatchResponse> responses(count);
+    std::vector<char> results(count, 0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < count; ++i)
+    {
+        requests[i] = makeRequest("module", i + 1, "invoker", "input" + std::to_string(i));
+        threads.push_back(std::thread([&, i]()
+        {
+            NullEC ec;
+            results[i] = coalescer.invoke(requests[i], responses[i], ec);
+        }));
+    }
+    for (auto & t : threads)
+        t.join();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        CPPUNIT_ASSERT(results[i]);
+        CPPUNIT_ASSERT_EQUAL(static_cast<SessionID>(i + 1), responses[i].sid);
+        CPPUNIT_ASSERT(responses[i].output == requests[i].input);
+    }
+    // at most 3 calls in one batch
+    CPPUNIT_ASSERT(sends >= 3);
+    CPPUNIT_ASSERT(sends <= static_cast<int>(count));
+}
+
+void Batch_Test::coalesce_error()
+{
+    Coalescer<HTTPBatchRequest, HTTPBatchResponse> coalescer(Logging::getLogger("SAS.Batch_Test"),
+        [](const std::vector<const HTTPBatchRequest *> & requests, std::vector<HTTPBatchResponse> & responses, ErrorCollector & ec)
+        {
+            // one response is missing
+            responses.resize(requests.size() - 1);
+            ec.add(-1, "partial");
+            return true;
+        }, std::chrono::microseconds(0), 64);
+
+    std::vector<std::string> errors;
+    SimpleErrorCollector ec([&errors](long, const std::string & errorText)
+    {
+        errors.push_back(errorText);
+    });
+
+    auto request = makeRequest("module", 1, "invoker", "input");
+    HTTPBatchResponse response;
+    CPPUNIT_ASSERT(!coalescer.invoke(request, response, ec));
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), errors.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("partial"), errors[0]);
+}
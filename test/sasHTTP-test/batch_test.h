@@ -0,0 +1,33 @@
+#ifndef __batch_test_h__
+#define __batch_test_h__
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class Batch_Test : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(Batch_Test);
+    CPPUNIT_TEST(request_round_trip);
+    CPPUNIT_TEST(response_round_trip);
+    CPPUNIT_TEST(empty_batch);
+    CPPUNIT_TEST(long_name);
+    CPPUNIT_TEST(truncated);
+    CPPUNIT_TEST(coalesce);
+    CPPUNIT_TEST(coalesce_error);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+	virtual void setUp() override;
+
+	virtual void tearDown() override;
+
+protected:
+    void request_round_trip();
+    void response_round_trip();
+    void empty_batch();
+    void long_name();
+    void truncated();
+    void coalesce();
+    void coalesce_error();
+};
+
+#endif //__batch_test_h__
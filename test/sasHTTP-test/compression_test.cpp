@@ -0,0 +1,124 @@
+#include "compression_test.h"
+
+#include <cppunit/config/SourcePrefix.h>
+
+#include <sasCore/errorcollector.h>
+
+#include <httpcompression.h>
+
+#include <zlib.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Compression_Test);
+
+using namespace SAS;
+
+namespace {
+
+    std::vector<char> testData(size_t size)
+    {
+        std::vector<char> ret(size);
+        for (size_t i = 0; i < size; ++i)
+            ret[i] = static_cast<char>('a' + (i * 7 + i / 13) % 26);
+        return ret;
+    }
+
+}
+
+void Compression_Test::setUp()
+{
+}
+
+void Compression_Test::tearDown()
+{
+}
+
+void Compression_Test::round_trip()
+{
+    NullEC ec;
+    for (auto encoding : { HTTPEncoding::Identity, HTTPEncoding::Deflate, HTTPEncoding::GZip })
+    {
+        for (size_t size : { 0, 1, 1000, 300 * 1024 })
+        {
+            auto data = testData(size);
+            std::vector<char> compressed, decompressed;
+            CPPUNIT_ASSERT(HTTPCompression::compress(encoding, -1, data, compressed, ec));
+            bool limit_exceeded = true;
+            CPPUNIT_ASSERT(HTTPCompression::decompress(encoding, compressed, 0, decompressed, limit_exceeded, ec));
+            CPPUNIT_ASSERT(!limit_exceeded);
+            CPPUNIT_ASSERT(decompressed == data);
+        }
+    }
+}
+
+void Compression_Test::raw_deflate()
+{
+    auto data = testData(10000);
+
+    z_stream strm = {};
+    CPPUNIT_ASSERT(deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+    std::vector<char> compressed(deflateBound(&strm, static_cast<uLong>(data.size())));
+    strm.next_in = reinterpret_cast<Bytef*>(data.data());
+    strm.avail_in = static_cast<uInt>(data.size());
+    strm.next_out = reinterpret_cast<Bytef*>(compressed.data());
+    strm.avail_out = static_cast<uInt>(compressed.size());
+    CPPUNIT_ASSERT(deflate(&strm, Z_FINISH) == Z_STREAM_END);
+    compressed.resize(strm.total_out);
+    deflateEnd(&strm);
+
+    NullEC ec;
+    std::vector<char> decompressed;
+    bool limit_exceeded;
+    CPPUNIT_ASSERT(HTTPCompression::decompress(HTTPEncoding::Deflate, compressed, 0, decompressed, limit_exceeded, ec));
+    CPPUNIT_ASSERT(decompressed == data);
+}
+
+void Compression_Test::max_size()
+{
+    NullEC ec;
+    std::vector<char> data(1024 * 1024, 0);
+    for (auto encoding : { HTTPEncoding::Deflate, HTTPEncoding::GZip })
+    {
+        std::vector<char> compressed, decompressed;
+        CPPUNIT_ASSERT(HTTPCompression::compress(encoding, 9, data, compressed, ec));
+        CPPUNIT_ASSERT(compressed.size() < 10000);
+
+        bool limit_exceeded = false;
+        CPPUNIT_ASSERT(!HTTPCompression::decompress(encoding, compressed, data.size() - 1, decompressed, limit_exceeded, ec));
+        CPPUNIT_ASSERT(limit_exceeded);
+        CPPUNIT_ASSERT(decompressed.size() <= data.size());
+
+        CPPUNIT_ASSERT(!HTTPCompression::decompress(encoding, compressed, 1000, decompressed, limit_exceeded, ec));
+        CPPUNIT_ASSERT(limit_exceeded);
+
+        CPPUNIT_ASSERT(HTTPCompression::decompress(encoding, compressed, data.size(), decompressed, limit_exceeded, ec));
+        CPPUNIT_ASSERT(!limit_exceeded);
+        CPPUNIT_ASSERT(decompressed == data);
+    }
+}
+
+void Compression_Test::invalid_input()
+{
+    NullEC ec;
+    std::vector<char> garbage = testData(100), decompressed;
+    bool limit_exceeded = true;
+    CPPUNIT_ASSERT(!HTTPCompression::decompress(HTTPEncoding::GZip, garbage, 0, decompressed, limit_exceeded, ec));
+    CPPUNIT_ASSERT(!limit_exceeded);
+
+    std::vector<char> compressed;
+    CPPUNIT_ASSERT(HTTPCompression::compress(HTTPEncoding::GZip, -1, testData(10000), compressed, ec));
+    compressed.resize(compressed.size() / 2);
+    CPPUNIT_ASSERT(!HTTPCompression::decompress(HTTPEncoding::GZip, compressed, 0, decompressed, limit_exceeded, ec));
+    CPPUNIT_ASSERT(!limit_exceeded);
+}
+
+void Compression_Test::negotiate()
+{
+    std::vector<HTTPEncoding> encodings = { HTTPEncoding::GZip, HTTPEncoding::Deflate };
+    CPPUNIT_ASSERT(HTTPCompression::negotiate(nullptr, encodings) == HTTPEncoding::Identity);
+    CPPUNIT_ASSERT(HTTPCompression::negotiate("deflate, gzip", encodings) == HTTPEncoding::GZip);
+    CPPUNIT_ASSERT(HTTPCompression::negotiate("gzip;q=0, deflate", encodings) == HTTPEncoding::Deflate);
+    CPPUNIT_ASSERT(HTTPCompression::negotiate("x-gzip", encodings) == HTTPEncoding::GZip);
+    CPPUNIT_ASSERT(HTTPCompression::negotiate("*", encodings) == HTTPEncoding::GZip);
+    CPPUNIT_ASSERT(HTTPCompression::negotiate("br", encodings) == HTTPEncoding::Identity);
+    CPPUNIT_ASSERT(HTTPCompression::acceptEncoding(encodings) == "gzip, deflate");
+}
@@ -0,0 +1,29 @@
+#ifndef __compression_test_h__
+#define __compression_test_h__
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class Compression_Test : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(Compression_Test);
+    CPPUNIT_TEST(round_trip);
+    CPPUNIT_TEST(raw_deflate);
+    CPPUNIT_TEST(max_size);
+    CPPUNIT_TEST(invalid_input);
+    CPPUNIT_TEST(negotiate);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+	virtual void setUp() override;
+
+	virtual void tearDown() override;
+
+protected:
+    void round_trip();
+    void raw_deflate();
+    void max_size();
+    void invalid_input();
+    void negotiate();
+};
+
+#endif //__compression_test_h__
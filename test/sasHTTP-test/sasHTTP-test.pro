@@ -0,0 +1,36 @@
+
+include("../../global.pri")
+
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+CONFIG -= qt
+#TARGET =
+
+#QMAKE_CXXFLAGS += -std=c++17
+
+SOURCES += main.cpp \
+           batch_test.cpp \
+           compression_test.cpp \
+           ../../sasHTTP/httpbatch.cpp \
+           ../../sasHTTP/httpcompression.cpp
+
+HEADERS += \
+           batch_test.h \
+           compression_test.h
+
+LIBS += -L../../sasCore -lsasCore
+INCLUDEPATH += ../../sasCore/include
+INCLUDEPATH += ../../sasHTTP
+
+CONFIG(SAS_LOG4CXX_ENABLED) {
+    LIBS += -llog4cxx
+    DEFINES += SAS_LOG4CXX_ENABLED
+}
+
+CONFIG(SAS_HTTP_ZSTD) {
+    LIBS += -lzstd
+    DEFINES += SAS_HTTP__HAVE_ZSTD
+}
+
+LIBS += -lcppunit -lz -lpthread
@@ -4,4 +4,6 @@ CONFIG += ordered
 
 SUBDIRS += \
     sasSQL-test \
+    sasBypass-test \
+    sasHTTP-test \
 